@@ -19,15 +19,86 @@
 // ============================================
 #define FIRMWARE_VERSION "2.0.0"
 #define PROTOCOL_VERSION "0.4"
-#define SPEEDUINO_SIGNATURE "speeduino 202310"
+#define SPEEDUINO_SIGNATURE "speeduino 202310"            // Legacy 79-byte output channels
+#define SPEEDUINO_SIGNATURE_EXTENDED "speeduino 202311"   // Extended output channels (OutputChannels.h)
 
 // ============================================
 // Serial Communication
 // ============================================
 #define SERIAL_BAUD_RATE 115200
 #define SERIAL_TIMEOUT_MS 100
+
+// Rates a client may switch to at runtime ('u'); the switch is undone unless
+// a valid request arrives at the new rate within SERIAL_BAUD_CONFIRM_MS
+#ifdef MINIMAL_FEATURES
+  #define SERIAL_BAUD_RATES 9600, 19200, 38400, 57600, 115200, 250000, 500000, 1000000
+#else
+  #define SERIAL_BAUD_RATES 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, \
+                            1000000, 1500000, 2000000
+#endif
+#define SERIAL_BAUD_CONFIRM_MS 1000
 #define SERIAL_BUFFER_SIZE 256
 
+// Software TX ring buffer for asynchronous (non-blocking) transmission
+#ifdef MINIMAL_FEATURES
+  #define SERIAL_TX_RING_SIZE 128
+#else
+  #define SERIAL_TX_RING_SIZE 512
+#endif
+
+// Framed ("new") protocol: 2-byte length + payload + CRC32
+#ifdef MINIMAL_FEATURES
+  #define PROTOCOL_RX_BUFFER_SIZE 64        // Largest framed payload / argument block
+  #define CRC32_NIBBLE_TABLE 1              // 64-byte CRC table (saves flash)
+#else
+  #define PROTOCOL_RX_BUFFER_SIZE SERIAL_BUFFER_SIZE
+  #define CRC32_NIBBLE_TABLE 0              // 1 KB CRC table (faster)
+#endif
+
+// Response gathering: replies of one processCommands() pass are handed to
+// the transport in one writeSpans() call, payloads referenced in place
+#ifdef MINIMAL_FEATURES
+  #define PROTOCOL_TX_SPANS 0               // Direct writes (the UART ring buffers anyway)
+#else
+  #define PROTOCOL_TX_SPANS 16              // Pieces per gathered write
+  #define PROTOCOL_TX_SCRATCH_SIZE 128      // Frame headers/trailers and built replies
+#endif
+
+// Per-command statistics slots in the protocol dispatch table
+#define PROTOCOL_COMMAND_SLOTS 16
+
+// Per-command latency histograms (log2 buckets, bucket 0 < 1 << SHIFT us)
+#ifdef MINIMAL_FEATURES
+  #define PROTOCOL_LATENCY_BUCKETS 6        // <64us ... >=1024us, 16-bit counters
+  #define PROTOCOL_LATENCY_SHIFT 6
+#else
+  #define PROTOCOL_LATENCY_BUCKETS 16       // <1us ... >=16384us, 32-bit counters
+  #define PROTOCOL_LATENCY_SHIFT 0
+#endif
+
+// Tune pages ('n' advertises them, 'p'/'M'/'b'/'B' access them)
+#define PAGE_COUNT 2
+#define PAGE_0_SIZE 32                      // Settings page
+#define PAGE_1_SIZE 256                     // Tuning page
+#define PAGE_STORAGE_SIZE (PAGE_0_SIZE + PAGE_1_SIZE + 1)  // Pages + validity marker
+#define PAGE_STORAGE_MAGIC 0xA5             // Marker value once a tune was burned
+#define PAGE_LOG_MAX_BYTES 4096             // LittleFS log size before compaction (ESP)
+
+// Onboard frame log (FrameLog, 'y' download; recorded on ESP/LittleFS only)
+#define FRAME_LOG_INTERVAL 10               // Simulator ticks between recorded frames
+#define FRAME_LOG_MAX_BYTES (768UL * 1024)  // About 80 minutes; recording stops when full
+#define FRAME_LOG_CHUNK_SIZE 256            // Log bytes per 'y' chunk
+#define FRAME_LOG_FLUSH_RECORDS 10          // Records between log file flushes (lost on power loss)
+
+// Concurrent protocol sessions besides the UART (ProtocolServer, e.g. TCP)
+#define PROTOCOL_SERVER_MAX_SESSIONS 3
+
+// Per-call budget for SpeeduinoProtocol::processCommands() drain mode
+#define PROTOCOL_MAX_COMMANDS_PER_CALL 16   // Commands handled per call (1 = legacy single byte)
+#define PROTOCOL_MAX_PROCESS_TIME_US 2000   // Time budget per call in us (0 = no limit)
+#define PROTOCOL_MAX_WEB_SKIPS 4            // loop() passes the web UI may yield to a backlog in a row
+#define PROTOCOL_LEGACY_FALLBACK_BYTES 16   // Without a clock: stray bytes before a framed session accepts legacy
+
 // ============================================
 // Engine Simulation Parameters
 // ============================================
@@ -90,10 +161,46 @@
 // ============================================
 // Simulation Timing
 // ============================================
-#define UPDATE_INTERVAL_MS 50          // 20Hz update rate
+#define UPDATE_INTERVAL_MS 50          // 20Hz ticks: one published snapshot each
+#ifdef MINIMAL_FEATURES
+  #define SIM_STEP_MS 50               // Base simulation step: every stage at 20Hz
+#else
+  #define SIM_STEP_MS 2                // Base simulation step: fastest stages at 500Hz
+#endif
+#define UPDATE_MAX_STEPS (250 / SIM_STEP_MS)  // Catch-up per update() call; older time is dropped
 #define STATE_TRANSITION_MS 5000       // 5 seconds between state changes
 #define WARMUP_TIME_MS 30000           // 30 seconds to warm up engine
 
+// Published status buffers (see EngineSimulator::getSnapshot())
+// Three buffers keep the previous frame intact for a full tick after it is
+// superseded, so readers on another core/task never see a torn frame.
+#ifdef MINIMAL_FEATURES
+  #define SNAPSHOT_BUFFER_COUNT 2
+#else
+  #define SNAPSHOT_BUFFER_COUNT 3
+#endif
+
+// Delta-compressed real-time data ('e'): full frame at least every N frames
+#define DELTA_KEYFRAME_INTERVAL 32
+
+// Extended output channel layout, selected per session with 's'
+#ifdef MINIMAL_FEATURES
+  #define OUTPUT_LAYOUT_EXTENDED 0          // Legacy layout only (saves RAM)
+#else
+  #define OUTPUT_LAYOUT_EXTENDED 1
+#endif
+
+// Tooth / composite logger (see ToothLog.h)
+#define TRIGGER_TEETH 36                    // Simulated crank wheel: 36-1
+#define TRIGGER_MISSING_TEETH 1
+#ifdef MINIMAL_FEATURES
+  #define TOOTH_LOG_SIZE 32                 // Entries per 'T'/'O' reply
+  #define TOOTH_LOG_BUFFER_SIZE 64          // Ring capacity (power of two)
+#else
+  #define TOOTH_LOG_SIZE 127                // Same as the real firmware
+  #define TOOTH_LOG_BUFFER_SIZE 512
+#endif
+
 #ifdef MINIMAL_FEATURES
   #define SENSOR_NOISE_ENABLED 0
   #define TRANSIENT_SIMULATION 0
@@ -104,6 +211,14 @@
   #define REALISTIC_CORRELATION 1
 #endif
 
+// Simulation randomness: 1 = inline xorshift32 (FastRandom.h) seeded from the
+// IRandomProvider at initialize(), 0 = every draw through IRandomProvider
+// (the provider's exact sequence, e.g. for recorded test runs)
+#ifndef FAST_RANDOM
+  #define FAST_RANDOM 1
+#endif
+#define NOISE_POOL_SIZE 32                  // Noise bytes generated per batch (~ one tick)
+
 // ============================================
 // WiFi Configuration (ESP32/ESP8266 only)
 // ============================================
@@ -113,6 +228,9 @@
   #define WIFI_TIMEOUT_MS 10000
   #define WEB_SERVER_PORT 80
   #define MDNS_HOSTNAME "speeduino-sim"
+  #define PROTOCOL_TCP_PORT 2000            // Speeduino protocol over TCP (ProtocolServer)
+  #define TCP_RX_BUFFER_SIZE 512            // Per client, power of two
+  #define TCP_TX_BUFFER_SIZE 1024           // Per client, sent once per loop() pass
 #endif
 
 // ============================================
@@ -0,0 +1,100 @@
+/**
+ * @file Crc32.h
+ * @brief Table-driven CRC32 for the framed ("new") Speeduino protocol
+ * 
+ * Standard CRC-32 (reflected polynomial 0xEDB88320, initial value and final
+ * XOR 0xFFFFFFFF), matching the Speeduino firmware and TunerStudio.
+ * 
+ * The lookup table lives in flash:
+ * - Byte table (1 KB, one lookup per byte) on ESP32/ESP8266
+ * - Nibble table (64 bytes, two lookups per byte) on AVR to save flash
+ */
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Config.h"
+
+/**
+ * @class Crc32
+ * @brief Incremental CRC32 calculation
+ * 
+ * Usage:
+ * @code
+ * uint32_t crc = Crc32::begin();
+ * crc = Crc32::update(crc, header, 3);
+ * crc = Crc32::update(crc, payload, length);
+ * uint32_t result = Crc32::finish(crc);
+ * @endcode
+ */
+class Crc32 {
+public:
+    /**
+     * @brief Get initial CRC state
+     * @return Initial register value
+     */
+    static constexpr uint32_t begin() { return 0xFFFFFFFFUL; }
+    
+    /**
+     * @brief Feed data into a running CRC
+     * @param crc Current CRC state (from begin() or a previous update())
+     * @param data Data to process
+     * @param length Number of bytes
+     * @return Updated CRC state
+     */
+    static uint32_t update(uint32_t crc, const uint8_t* data, size_t length);
+    
+    /**
+     * @brief Finalize CRC state into the transmitted value
+     * @param crc Current CRC state
+     * @return Final CRC32
+     */
+    static constexpr uint32_t finish(uint32_t crc) { return ~crc; }
+    
+    /**
+     * @brief Compute CRC32 of a single buffer
+     * @param data Data to process
+     * @param length Number of bytes
+     * @return Final CRC32
+     */
+    static uint32_t compute(const uint8_t* data, size_t length) {
+        return finish(update(begin(), data, length));
+    }
+    
+    /**
+     * @brief Compile-time counterpart of update() for constant data
+     * 
+     * Lets replies stored in flash carry a precomputed CRC, so they can be
+     * framed without reading the data back from flash.
+     * 
+     * @param crc Current CRC state
+     * @param data Constant data (any byte-sized element type)
+     * @param length Number of bytes
+     * @return Updated CRC state
+     */
+    template<typename T>
+    static constexpr uint32_t updateConstant(uint32_t crc, const T* data, size_t length) {
+        return length == 0 ? crc
+             : updateConstant(updateBits(crc ^ static_cast<uint8_t>(*data), 8), data + 1, length - 1);
+    }
+    
+    /**
+     * @brief Compile-time CRC update for a single byte
+     * @param crc Current CRC state
+     * @param byte Byte to process
+     * @return Updated CRC state
+     */
+    static constexpr uint32_t updateConstant(uint32_t crc, uint8_t byte) {
+        return updateBits(crc ^ byte, 8);
+    }
+    
+private:
+    static constexpr uint32_t updateBits(uint32_t crc, uint8_t bits) {
+        return bits == 0 ? crc
+             : updateBits((crc & 1) ? (crc >> 1) ^ 0xEDB88320UL : (crc >> 1), bits - 1);
+    }
+};
+
+#endif // CRC32_H
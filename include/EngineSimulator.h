@@ -13,8 +13,12 @@
 #define ENGINE_SIMULATOR_H
 
 #include "EngineStatus.h"
+#include "OutputChannels.h"
 #include "ITimeProvider.h"
 #include "IRandomProvider.h"
+#include "ToothLog.h"
+#include "Table3D.h"
+#include "FastRandom.h"
 #include "Config.h"
 
 /**
@@ -32,6 +36,83 @@ enum class EngineMode {
     WOT             ///< Wide open throttle (full load)
 };
 
+/**
+ * @enum ToothLogMode
+ * @brief What the simulated trigger wheel records into the tooth log
+ */
+enum class ToothLogMode : uint8_t {
+    OFF,            ///< No logging (trigger events are not generated)
+    TOOTH,          ///< Tooth logger: primary tooth gaps
+    COMPOSITE       ///< Composite logger: timestamped primary and cam events
+};
+
+/**
+ * @enum SimStage
+ * @brief Simulation stages, in the order they run within a step
+ * 
+ * Each stage runs at its own period (EngineSimulator::getStagePeriodMs()),
+ * a multiple of SIM_STEP_MS.
+ */
+enum SimStage : uint8_t {
+    STAGE_MODE,             ///< Operating mode state machine
+    STAGE_RPM,              ///< Engine speed
+    STAGE_TRIGGER,          ///< Tooth log events
+    STAGE_THERMAL,          ///< Coolant / intake temperatures
+    STAGE_THROTTLE,         ///< Throttle position and TPSdot
+    STAGE_MAP,              ///< Manifold pressure
+    STAGE_FUEL,             ///< VE, pulse width, enrichments
+    STAGE_IGNITION,         ///< Advance and dwell
+    STAGE_AFR,              ///< AFR target and O2 sensors
+    STAGE_CORRECTIONS,      ///< EGO / IAT / battery corrections
+    STAGE_SENSORS,          ///< Status flags, error codes
+    STAGE_VOLTAGE,          ///< Battery voltage
+    STAGE_CAN,              ///< CAN input data
+    STAGE_EXTENDED,         ///< Extended layout channels
+    STAGE_COUNT
+};
+
+/**
+ * @struct EngineSnapshot
+ * @brief Engine status published at the end of a finished simulation tick
+ */
+struct EngineSnapshot {
+    EngineStatus status;    ///< Consistent 'A' frame for one tick
+    uint32_t generation;    ///< Increments on every publish (0 = never published)
+#if OUTPUT_LAYOUT_EXTENDED
+    ExtendedStatus extended;    ///< Same tick in the extended layout
+#endif
+    
+    /**
+     * @brief Get the output channel buffer of a layout
+     * @param layout Layout (must be available in this build)
+     * @return Pointer to the layout's contiguous buffer
+     */
+    const uint8_t* getChannels(OutputLayout layout) const {
+        #if OUTPUT_LAYOUT_EXTENDED
+            if (layout == LAYOUT_EXTENDED) {
+                return reinterpret_cast<const uint8_t*>(&extended);
+            }
+        #endif
+        (void)layout;
+        return reinterpret_cast<const uint8_t*>(&status);
+    }
+    
+    /**
+     * @brief Get the size of a layout's buffer
+     * @param layout Layout
+     * @return Size in bytes (0 if the layout is not built)
+     */
+    static uint16_t getChannelsSize(OutputLayout layout) {
+        switch (layout) {
+            case LAYOUT_LEGACY: return sizeof(EngineStatus);
+            #if OUTPUT_LAYOUT_EXTENDED
+            case LAYOUT_EXTENDED: return sizeof(ExtendedStatus);
+            #endif
+            default: return 0;
+        }
+    }
+};
+
 /**
  * @class EngineSimulator
  * @brief Physics-based engine simulation
@@ -40,28 +121,46 @@ enum class EngineMode {
  * - Realistic parameter correlations (not random)
  * - Smooth transitions between states
  * - Thermal model (coolant/intake temps)
- * - Volumetric efficiency curves
+ * - 16x16 VE and spark tables (RPM x MAP, Speeduino layout)
  * - Fuel delivery calculations
- * - Ignition timing maps
  */
 class EngineSimulator {
 private:
     ITimeProvider* timeProvider;
     IRandomProvider* randomProvider;
-    EngineStatus status;
+#if FAST_RANDOM
+    FastRandom rng;             // Seeded from randomProvider at initialize()
+#if SENSOR_NOISE_ENABLED
+    uint8_t noisePool[NOISE_POOL_SIZE];     // Sensor noise, refilled in batches
+    uint8_t noiseIndex;                     // Next unused byte
+#endif
+#endif
+    EngineStatus status;        // Working copy, mutated field by field during a tick
+#if OUTPUT_LAYOUT_EXTENDED
+    ExtraChannels extra;        // Working copy of the extended-only channels
+#endif
+    
+    // Published snapshots (index swap, written round-robin)
+    EngineSnapshot snapshots[SNAPSHOT_BUFFER_COUNT];
+    volatile uint8_t publishedIndex;
+    uint32_t generation;
     
     // Simulation state
     EngineMode currentMode;
-    uint32_t lastUpdateTime;
-    uint32_t stateStartTime;
+    uint32_t simulatedTime;     // millis() the simulation has been stepped up to
+    uint32_t stepTime;          // Simulated millis() of the current step (dropped steps excluded)
+    uint8_t stepsToTick;        // Steps until the next snapshot is published
+    uint32_t stateStartTime;    // stepTime the current mode was entered
     uint32_t engineStartTime;
     
     // Dynamic state variables
     uint16_t targetRPM;
     uint16_t currentRPM;
     int16_t rpmAcceleration;    // RPM/s
+    int16_t rpmFraction;        // RPM / 1000 not yet applied (short stage periods)
     uint8_t targetThrottle;
     uint8_t currentThrottle;
+    uint8_t lastThrottle;       // currentThrottle at the previous throttle stage
     
     // Thermal state
     int16_t coolantTemp;        // Actual temp in °C * 10
@@ -72,9 +171,27 @@ private:
     uint16_t pulseWidth;        // 0.1ms units
     uint8_t injectorDutyCycle;
     
+    // Tune (flash), RPM x MAP
+    Table3D veTable;
+    Table3D sparkTable;
+    
     // Counters
-    uint32_t loopCounter;
+    uint32_t loopCounter;       // Steps
+    uint32_t tickCounter;       // Snapshot ticks ('loops' channel)
     uint16_t secondCounter;
+    uint32_t catchUpSteps;      // Extra steps run to make up for a late update()
+    uint32_t skippedSteps;      // Steps dropped beyond UPDATE_MAX_STEPS
+    uint32_t clampedUpdates;    // update() calls that dropped steps
+    
+    // Trigger wheel / tooth logger
+    ToothLog toothLog;
+    ToothLogMode toothLogMode;
+    bool triggerRunning;        // Tooth timing established since start / stall
+    bool triggerSync;           // Missing tooth seen
+    bool camPhase;              // Second crank revolution of the cycle
+    uint8_t toothIndex;         // Next tooth after the gap = 0
+    uint32_t nextToothTime;     // us
+    uint32_t lastToothTime;     // us
     
 public:
     /**
@@ -90,16 +207,41 @@ public:
     void initialize();
     
     /**
-     * @brief Update simulation (call at ~20Hz / 50ms intervals)
-     * @return true if state changed, false otherwise
+     * @brief Advance the simulation to the current time (call in loop)
+     * 
+     * The physics run in fixed steps of SIM_STEP_MS, each stage at its own
+     * period. A call runs as many steps as have elapsed (at most
+     * UPDATE_MAX_STEPS); time short of a full step carries over to the
+     * next call, so simulated time follows wall time even when loop() is
+     * late. A snapshot is published once per call if an UPDATE_INTERVAL_MS
+     * tick completed.
+     * 
+     * @return true if a snapshot was published
      */
     bool update();
     
     /**
-     * @brief Get current engine status structure
-     * @return Reference to EngineStatus
+     * @brief Get last published engine status structure
+     * @return Reference to EngineStatus of the latest snapshot
      */
-    const EngineStatus& getStatus() const { return status; }
+    const EngineStatus& getStatus() const { return getSnapshot().status; }
+    
+    /**
+     * @brief Get last published snapshot (no copy)
+     * 
+     * The referenced buffer is not written again until SNAPSHOT_BUFFER_COUNT - 1
+     * further ticks have been published, so a consumer may send from it
+     * directly as long as it finishes within one tick.
+     * 
+     * @return Reference to the latest EngineSnapshot
+     */
+    const EngineSnapshot& getSnapshot() const { return snapshots[publishedIndex]; }
+    
+    /**
+     * @brief Get generation number of the last published snapshot
+     * @return Generation (compare with a saved value to skip unchanged data)
+     */
+    uint32_t getGeneration() const { return snapshots[publishedIndex].generation; }
     
     /**
      * @brief Get current operating mode
@@ -119,13 +261,83 @@ public:
      */
     uint32_t getRuntime() const;
     
+    /**
+     * @brief Get how often a stage runs
+     * @param stage Stage
+     * @return Period in ms of simulated time (0 for an invalid stage)
+     */
+    static uint16_t getStagePeriodMs(SimStage stage);
+    
+    /**
+     * @brief Get number of SIM_STEP_MS steps simulated since initialize()
+     * @return Steps (the published 'loops' channel counts ticks instead)
+     */
+    uint32_t getStepCount() const { return loopCounter; }
+    
+    /**
+     * @brief Get number of extra steps run by late update() calls
+     * @return Steps beyond the first per call since initialize()
+     */
+    uint32_t getCatchUpSteps() const { return catchUpSteps; }
+    
+    /**
+     * @brief Get number of steps dropped because update() was too late
+     * @return Steps lost beyond UPDATE_MAX_STEPS since initialize()
+     * (simulated time fell behind wall time by as many intervals)
+     */
+    uint32_t getSkippedSteps() const { return skippedSteps; }
+    
+    /**
+     * @brief Get number of update() calls that hit UPDATE_MAX_STEPS
+     * @return Clamped calls since initialize()
+     */
+    uint32_t getClampedUpdates() const { return clampedUpdates; }
+    
+    /**
+     * @brief Start or stop the tooth / composite logger
+     * 
+     * Starting clears the log; trigger events are then generated from
+     * currentRPM on every update().
+     * 
+     * @param mode Logger to run (OFF stops logging, the log keeps its contents)
+     */
+    void setToothLogMode(ToothLogMode mode);
+    
+    /**
+     * @brief Get the running logger
+     */
+    ToothLogMode getToothLogMode() const { return toothLogMode; }
+    
+    /**
+     * @brief Tooth log ring (the protocol is its only consumer)
+     */
+    ToothLog& getToothLog() { return toothLog; }
+    
+    /**
+     * @brief VE table used by the fuel stage (percent)
+     */
+    Table3D& getVETable() { return veTable; }
+    
+    /**
+     * @brief Spark table used by the ignition stage (degrees BTDC)
+     */
+    Table3D& getSparkTable() { return sparkTable; }
+    
 private:
+    // Snapshot publishing
+    void publishSnapshot();
+    
+    // One fixed step of SIM_STEP_MS; true when it completes a tick
+    bool step();
+    void runStage(uint8_t stage);
+    
     // State machine
     void updateStateMachine();
     void transitionToMode(EngineMode newMode);
     
     // Physics simulation
     void simulateRPM();
+    void simulateTrigger();
     void simulateThermal();
     void simulateMAP();
     void simulateThrottle();
@@ -136,14 +348,29 @@ private:
     void simulateSensors();
     void simulateVoltage();
     void simulateCANData();
+    void simulateExtendedChannels();
     
     // Helper functions
-    uint8_t calculateVE(uint16_t rpm, uint8_t tps);
-    uint8_t calculateIgnitionAdvance(uint16_t rpm, uint8_t load);
     uint16_t calculateRequiredPulseWidth(uint16_t rpm, uint16_t map, uint8_t ve);
     uint8_t getWarmupEnrichment(int16_t coolantTemp);
     int8_t addNoise(int8_t value, int8_t range);
-    int16_t interpolate(int16_t current, int16_t target, uint8_t rate);
+    
+    // Random number in [min, max) / [0, max) from the build's generator
+    int32_t nextRandom(int32_t min, int32_t max) {
+        #if FAST_RANDOM
+            return rng.random(min, max);
+        #else
+            return randomProvider->random(min, max);
+        #endif
+    }
+    int32_t nextRandom(int32_t max) {
+        #if FAST_RANDOM
+            return rng.random(max);
+        #else
+            return randomProvider->random(max);
+        #endif
+    }
+    int16_t interpolate(int16_t current, int16_t target, uint8_t rate, SimStage stage);
     uint16_t mapValue(uint16_t x, uint16_t in_min, uint16_t in_max, 
                       uint16_t out_min, uint16_t out_max);
 };
@@ -0,0 +1,103 @@
+/**
+ * @file FastRandom.h
+ * @brief Inline xorshift32 generator for simulation noise
+ * 
+ * Sensor noise needs no statistical quality, only to be cheap and
+ * reproducible. A draw through IRandomProvider is a virtual call into
+ * Arduino's random() (a 32-bit multiply and modulo), or into the hardware
+ * RNG on ESP8266. Here a draw is three shifts and three XORs, and a
+ * bounded value is one multiply. fillNoise() gets four noise bytes from
+ * every step.
+ * 
+ * The sequence depends on the seed only. EngineSimulator seeds it from
+ * its IRandomProvider, so a seeded provider still gives a reproducible
+ * run (see FAST_RANDOM in Config.h).
+ */
+
+#ifndef FAST_RANDOM_H
+#define FAST_RANDOM_H
+
+#include <stdint.h>
+
+/// Seed used for seed(0) (xorshift never leaves the all-zero state)
+#define FAST_RANDOM_DEFAULT_SEED 2463534242UL
+
+/**
+ * @class FastRandom
+ * @brief xorshift32 (Marsaglia 13/17/5), period 2^32 - 1
+ */
+class FastRandom {
+private:
+    uint32_t state;             // Never 0
+    
+public:
+    FastRandom() : state(FAST_RANDOM_DEFAULT_SEED) {}
+    
+    /**
+     * @brief Restart the sequence
+     * @param seed Any value (0 selects the default seed)
+     */
+    void seed(uint32_t seed) {
+        state = (seed != 0) ? seed : FAST_RANDOM_DEFAULT_SEED;
+    }
+    
+    /**
+     * @brief Next 32 random bits
+     */
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    
+    /**
+     * @brief Random number in [min, max), like Arduino random()
+     * @param min Minimum value (inclusive)
+     * @param max Maximum value (exclusive, at most min + 65536)
+     * @return min if the range is empty
+     */
+    int32_t random(int32_t min, int32_t max) {
+        if (min >= max) {
+            return min;
+        }
+        // Top 16 bits scaled to the span: no division
+        uint32_t span = static_cast<uint32_t>(max - min);
+        return min + static_cast<int32_t>(((next() >> 16) * span) >> 16);
+    }
+    
+    /**
+     * @brief Random number in [0, max)
+     */
+    int32_t random(int32_t max) {
+        return random(0, max);
+    }
+    
+    /**
+     * @brief Fill a buffer with noise bytes (uniform 0-255)
+     * @param buffer Destination
+     * @param count Number of bytes
+     */
+    void fillNoise(uint8_t* buffer, uint8_t count) {
+        uint32_t bits = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            if ((i & 3) == 0) {
+                bits = next();
+            }
+            buffer[i] = static_cast<uint8_t>(bits);
+            bits >>= 8;
+        }
+    }
+    
+    /**
+     * @brief Scale a noise byte to [-range, range]
+     * @param noise Byte from fillNoise()
+     * @param range Largest deviation (0-127)
+     */
+    static int8_t boundNoise(uint8_t noise, int8_t range) {
+        uint8_t span = static_cast<uint8_t>(2 * range + 1);
+        return static_cast<int8_t>(((uint16_t)noise * span) >> 8) - range;
+    }
+};
+
+#endif // FAST_RANDOM_H
@@ -0,0 +1,89 @@
+/**
+ * @file FixedPoint.h
+ * @brief Division-free integer helpers for the simulation hot path
+ * 
+ * AVR has no divide instruction: every '/' on a 16- or 32-bit value is a
+ * libgcc call of a few hundred cycles, and at -Os avr-gcc does not turn
+ * divisions by constants into multiplications. These helpers do so
+ * explicitly and return exactly what the C operator returns (truncation
+ * toward zero), so results are bit-identical to the plain expressions:
+ * 
+ * - fpDiv10() / fpDiv100(): multiply-shift for 16-bit inputs, plain
+ *   division beyond
+ * - q8_8_t / frac8_t and fpLerp(): 8-bit fixed point interpolation
+ */
+
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+
+/// Unsigned Q8.8 (value * 256)
+typedef uint16_t q8_8_t;
+
+/// Position between two points in 1/256, 0-256 (256 = the second point)
+typedef uint16_t frac8_t;
+
+/**
+ * @brief x / 10
+ * 
+ * (x / 2) * ceil(2^17 / 5) >> 17 is exact for x < 87388; the fast path
+ * covers 16-bit inputs.
+ */
+inline uint32_t fpDiv10(uint32_t x) {
+    if (x > 0xFFFF) {
+        return x / 10;
+    }
+    return ((uint32_t)(uint16_t)(x >> 1) * 26215U) >> 17;
+}
+
+/**
+ * @brief x / 100
+ * 
+ * (x / 4) * ceil(2^19 / 25) >> 19 is exact for x < 174796; the fast path
+ * covers 16-bit inputs.
+ */
+inline uint32_t fpDiv100(uint32_t x) {
+    if (x > 0xFFFF) {
+        return x / 100;
+    }
+    return ((uint32_t)(uint16_t)(x >> 2) * 20972U) >> 19;
+}
+
+/**
+ * @brief x / 10, rounded toward zero like '/'
+ */
+inline int32_t fpDiv10Signed(int32_t x) {
+    return (x < 0) ? -(int32_t)fpDiv10((uint32_t)-x) : (int32_t)fpDiv10((uint32_t)x);
+}
+
+/**
+ * @brief x / 100, rounded toward zero like '/'
+ */
+inline int32_t fpDiv100Signed(int32_t x) {
+    return (x < 0) ? -(int32_t)fpDiv100((uint32_t)-x) : (int32_t)fpDiv100((uint32_t)x);
+}
+
+/**
+ * @brief Interpolate between two 8-bit values
+ * @param a Value at t = 0
+ * @param b Value at t = 256
+ * @param t Position
+ * @return a + (b - a) * t / 256 in Q8.8, not rounded
+ */
+inline q8_8_t fpLerp(uint8_t a, uint8_t b, frac8_t t) {
+    return (q8_8_t)(a * (256U - t) + b * (uint16_t)t);
+}
+
+/**
+ * @brief Interpolate between two Q8.8 values, rounded to an integer
+ * @param a Value at t = 0
+ * @param b Value at t = 256
+ * @param t Position
+ */
+inline uint8_t fpLerpRound(q8_8_t a, q8_8_t b, frac8_t t) {
+    uint32_t value = (uint32_t)a * (256U - t) + (uint32_t)b * t;
+    return (uint8_t)((value + 0x8000UL) >> 16);
+}
+
+#endif // FIXED_POINT_H
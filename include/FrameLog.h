@@ -0,0 +1,106 @@
+/**
+ * @file FrameLog.h
+ * @brief Onboard recording of realtime frames for download over serial
+ * 
+ * Every FRAME_LOG_INTERVAL simulator ticks the published snapshot is
+ * appended to the log storage as one fixed-size record:
+ * 
+ * - Bytes 0-3: Snapshot generation (little-endian)
+ * - Bytes 4..: Output channels, legacy layout (same bytes as 'A')
+ * 
+ * The 'y' command streams the file back in chunks of at most
+ * FRAME_LOG_CHUNK_SIZE bytes. Each chunk is read from storage into one
+ * shared buffer and sent from there, so the file is never held in RAM.
+ */
+
+#ifndef FRAME_LOG_H
+#define FRAME_LOG_H
+
+#include "EngineSimulator.h"
+#include "IFrameLogStorage.h"
+#include "Config.h"
+
+/// Bytes per recorded frame
+#define FRAME_LOG_RECORD_SIZE (4 + sizeof(EngineStatus))
+
+/**
+ * @class FrameLog
+ * @brief Snapshot recorder on an append-only log
+ */
+class FrameLog {
+private:
+    EngineSimulator* simulator;
+    IFrameLogStorage* storage;
+    uint32_t logSize;           // Bytes stored
+    bool recording;
+    bool recorded;              // lastGeneration is valid
+    uint32_t lastGeneration;    // Snapshot generation of the last record
+    uint32_t recordCount;       // Records appended since begin()/clear()
+    uint32_t droppedCount;      // Records lost (log full or storage failed)
+    
+    // Chunk being downloaded ('y'); shared by all sessions, which are
+    // serviced one after the other and flush before the next one runs
+    uint8_t chunk[FRAME_LOG_CHUNK_SIZE];
+    
+public:
+    /**
+     * @brief Constructor
+     * @param simulator Source of the recorded snapshots
+     * @param storage Log file (nullptr = nothing is recorded)
+     */
+    FrameLog(EngineSimulator* simulator, IFrameLogStorage* storage);
+    
+    /**
+     * @brief Open the log, keeping frames recorded before a restart
+     * @return false without usable storage
+     */
+    bool begin();
+    
+    /**
+     * @brief Record the current snapshot if it is due (call in loop)
+     * @return true if a record was appended
+     */
+    bool update();
+    
+    /**
+     * @brief Pause or resume recording
+     */
+    void setRecording(bool enabled) { recording = enabled; }
+    
+    /**
+     * @brief Check whether new snapshots are being recorded
+     */
+    bool isRecording() const { return recording; }
+    
+    /**
+     * @brief Get size of the log in bytes
+     */
+    uint32_t size() const { return logSize; }
+    
+    /**
+     * @brief Read one download chunk
+     * @param offset First byte in the log
+     * @param maxLength Bytes wanted (clipped to FRAME_LOG_CHUNK_SIZE)
+     * @param length Set to the bytes available (0 at the end of the log)
+     * @return Chunk data, valid until the next read()
+     */
+    const uint8_t* read(uint32_t offset, uint16_t maxLength, uint16_t* length);
+    
+    /**
+     * @brief Erase all recorded frames
+     * @return false if the storage failed
+     */
+    bool clear();
+    
+    /**
+     * @brief Get number of records appended since begin()/clear()
+     */
+    uint32_t getRecordCount() const { return recordCount; }
+    
+    /**
+     * @brief Get number of records lost because the log was full
+     */
+    uint32_t getDroppedCount() const { return droppedCount; }
+};
+
+#endif // FRAME_LOG_H
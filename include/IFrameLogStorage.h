@@ -0,0 +1,67 @@
+/**
+ * @file IFrameLogStorage.h
+ * @brief Hardware abstraction interface for the recorded frame log
+ * 
+ * An append-only byte file holding realtime frames recorded on the device
+ * (FrameLog). It is read back in chunks by the 'y' download command, so
+ * implementations must support reads at any offset without loading the
+ * whole file.
+ */
+
+#ifndef I_FRAME_LOG_STORAGE_H
+#define I_FRAME_LOG_STORAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @interface IFrameLogStorage
+ * @brief Abstract interface for append-only log storage
+ * 
+ * Implementations:
+ * - FrameLogFile: File on LittleFS (ESP32/ESP8266)
+ * - MockFrameLogStorage: RAM stand-in for unit testing
+ */
+class IFrameLogStorage {
+public:
+    virtual ~IFrameLogStorage() {}
+    
+    /**
+     * @brief Mount / open the storage
+     * @return true if successful
+     */
+    virtual bool begin() = 0;
+    
+    /**
+     * @brief Get number of bytes stored
+     */
+    virtual uint32_t size() = 0;
+    
+    /**
+     * @brief Append bytes at the end
+     * 
+     * The bytes must be readable with read() once this returns.
+     * 
+     * @param data Bytes to store
+     * @param length Number of bytes
+     * @return false if nothing was stored (storage full or failed)
+     */
+    virtual bool append(const uint8_t* data, uint16_t length) = 0;
+    
+    /**
+     * @brief Read stored bytes
+     * @param offset First byte
+     * @param buffer Destination
+     * @param length Bytes wanted
+     * @return Bytes read (short at the end of the log)
+     */
+    virtual uint16_t read(uint32_t offset, uint8_t* buffer, uint16_t length) = 0;
+    
+    /**
+     * @brief Erase everything
+     * @return true if successful
+     */
+    virtual bool clear() = 0;
+};
+
+#endif // I_FRAME_LOG_STORAGE_H
@@ -0,0 +1,62 @@
+/**
+ * @file INonVolatileStorage.h
+ * @brief Hardware abstraction interface for persistent byte storage
+ * 
+ * Backs the tune pages burned by the protocol. The address space is a
+ * small flat array (PAGE_STORAGE_SIZE bytes); implementations decide how
+ * it maps onto EEPROM or flash.
+ */
+
+#ifndef I_NON_VOLATILE_STORAGE_H
+#define I_NON_VOLATILE_STORAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @interface INonVolatileStorage
+ * @brief Abstract interface for persistent storage
+ * 
+ * Implementations:
+ * - EepromStorage: AVR EEPROM (EEPROM.update() skips unchanged cells)
+ * - LogStorage: Append-only log on LittleFS (ESP32/ESP8266)
+ * - MockStorage: RAM stand-in with wear counters for unit testing
+ */
+class INonVolatileStorage {
+public:
+    virtual ~INonVolatileStorage() {}
+    
+    /**
+     * @brief Mount / load the storage
+     * @return true if successful
+     */
+    virtual bool begin() = 0;
+    
+    /**
+     * @brief Read one byte
+     * @param address Byte address (0 to PAGE_STORAGE_SIZE - 1)
+     * @return Stored value (0xFF if never written)
+     */
+    virtual uint8_t read(uint16_t address) = 0;
+    
+    /**
+     * @brief Write a run of bytes
+     * 
+     * Callers only pass bytes that changed; implementations may buffer
+     * until commit().
+     * 
+     * @param address First byte address
+     * @param data Bytes to store
+     * @param length Number of bytes
+     * @return true if successful
+     */
+    virtual bool write(uint16_t address, const uint8_t* data, uint16_t length) = 0;
+    
+    /**
+     * @brief Make all previous writes durable
+     * @return true if successful
+     */
+    virtual bool commit() { return true; }
+};
+
+#endif // I_NON_VOLATILE_STORAGE_H
@@ -12,6 +12,14 @@
 #include <stdint.h>
 #include <stddef.h>
 
+/**
+ * @brief One piece of a gathered write (see ISerialInterface::writeSpans())
+ */
+struct SerialSpan {
+    const uint8_t* data;
+    size_t length;
+};
+
 /**
  * @interface ISerialInterface
  * @brief Abstract interface for serial communication
@@ -32,6 +40,21 @@ public:
      */
     virtual void begin(uint32_t baudRate) = 0;
     
+    /**
+     * @brief Change the link speed of an open port
+     * 
+     * Pending output must be flushed first. Bytes received while switching
+     * are discarded.
+     * 
+     * @param baudRate New speed in bits per second
+     * @return false if the transport has no baud rate (e.g. TCP)
+     */
+    virtual bool setBaudRate(uint32_t baudRate) {
+        begin(baudRate);
+        clear();
+        return true;
+    }
+    
     /**
      * @brief Check if serial connection is ready
      * @return true if ready, false otherwise
@@ -73,6 +96,25 @@ public:
      */
     virtual size_t write(const uint8_t* buffer, size_t length) = 0;
     
+    /**
+     * @brief Write several buffers back to back (scatter/gather)
+     * 
+     * Lets a transport send all pieces as one packet, USB transfer or
+     * system call instead of one per piece. The default writes them one
+     * after the other.
+     * 
+     * @param spans Pieces in transmission order
+     * @param count Number of pieces
+     * @return Number of bytes actually written
+     */
+    virtual size_t writeSpans(const SerialSpan* spans, uint8_t count) {
+        size_t written = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            written += write(spans[i].data, spans[i].length);
+        }
+        return written;
+    }
+    
     /**
      * @brief Flush output buffer (wait for transmission complete)
      */
@@ -82,6 +124,35 @@ public:
      * @brief Clear input buffer
      */
     virtual void clear() = 0;
+    
+    /**
+     * @brief Enable or disable asynchronous (queued) transmission
+     * 
+     * In async mode write() queues data in a TX ring buffer and returns
+     * without waiting for the UART; pollTransmit() moves queued bytes to
+     * the hardware and flush() remains the explicit blocking drain.
+     * 
+     * @param enabled true for queued writes, false for direct writes
+     * @return true if the requested mode is supported
+     */
+    virtual bool setAsyncTransmit(bool enabled) { return !enabled; }
+    
+    /**
+     * @brief Check if asynchronous transmission is active
+     * @return true if writes are queued
+     */
+    virtual bool isAsyncTransmit() const { return false; }
+    
+    /**
+     * @brief Move queued bytes to the hardware without blocking (call in loop)
+     */
+    virtual void pollTransmit() {}
+    
+    /**
+     * @brief Get number of bytes queued but not yet handed to the hardware
+     * @return Bytes waiting in the TX ring buffer
+     */
+    virtual size_t pendingTransmit() const { return 0; }
 };
 
 #endif // I_SERIAL_INTERFACE_H
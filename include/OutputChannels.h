@@ -0,0 +1,214 @@
+/**
+ * @file OutputChannels.h
+ * @brief Output channel field table and the layouts built from it
+ * 
+ * Every real-time channel is listed once in OUTPUT_CHANNELS, with the
+ * layouts it appears in. Layout structs, the legacy layout check and the
+ * extended layout's fill function are all generated from that table, so a
+ * channel is added in exactly one place.
+ * 
+ * Layouts:
+ * - LAYOUT_LEGACY: the 79-byte EngineStatus ('A' echo byte first, reserved
+ *   bytes last), signature SPEEDUINO_SIGNATURE
+ * - LAYOUT_EXTENDED: 124 bytes modeled on 2023-era firmware (no echo or
+ *   reserved bytes, 36 further channels appended), signature
+ *   SPEEDUINO_SIGNATURE_EXTENDED; not built with MINIMAL_FEATURES
+ * 
+ * Each layout is published as one contiguous packed buffer per snapshot and
+ * sent from there without further copies.
+ */
+
+#ifndef OUTPUT_CHANNELS_H
+#define OUTPUT_CHANNELS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "EngineStatus.h"
+#include "Config.h"
+
+#if defined(__BYTE_ORDER__)
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "Multi-byte output channels are stored little-endian in place");
+#endif
+
+/**
+ * @brief Selectable output channel layouts
+ */
+enum OutputLayout : uint8_t {
+    LAYOUT_LEGACY = 0,
+    LAYOUT_EXTENDED,
+    LAYOUT_COUNT
+};
+
+typedef uint8_t CanInputs[32];
+
+/**
+ * Field table: X(name, type, legacy, extended)
+ * legacy / extended: Y if the channel is part of that layout, N if not.
+ * Order is wire order. Channels in the legacy layout live in EngineStatus
+ * (same member names); the others live in ExtraChannels.
+ */
+#define OUTPUT_CHANNELS(X) \
+    X(response,           uint8_t,   Y, N)  /* 'A' echo */                 \
+    X(secl,               uint8_t,   Y, Y)                                 \
+    X(status1,            uint8_t,   Y, Y)                                 \
+    X(engine,             uint8_t,   Y, Y)                                 \
+    X(dwell,              uint8_t,   Y, Y)                                 \
+    X(maplo,              uint8_t,   Y, Y)                                 \
+    X(maphi,              uint8_t,   Y, Y)                                 \
+    X(iat,                uint8_t,   Y, Y)                                 \
+    X(clt,                uint8_t,   Y, Y)                                 \
+    X(batcorrection,      uint8_t,   Y, Y)                                 \
+    X(batteryv,           uint8_t,   Y, Y)                                 \
+    X(o2,                 uint8_t,   Y, Y)                                 \
+    X(egocorrection,      uint8_t,   Y, Y)                                 \
+    X(iatcorrection,      uint8_t,   Y, Y)                                 \
+    X(wue,                uint8_t,   Y, Y)                                 \
+    X(rpmlo,              uint8_t,   Y, Y)                                 \
+    X(rpmhi,              uint8_t,   Y, Y)                                 \
+    X(taeamount,          uint8_t,   Y, Y)                                 \
+    X(gammae,             uint8_t,   Y, Y)                                 \
+    X(ve,                 uint8_t,   Y, Y)                                 \
+    X(afrtarget,          uint8_t,   Y, Y)                                 \
+    X(pw1lo,              uint8_t,   Y, Y)                                 \
+    X(pw1hi,              uint8_t,   Y, Y)                                 \
+    X(tpsdot,             uint8_t,   Y, Y)                                 \
+    X(advance,            uint8_t,   Y, Y)                                 \
+    X(tps,                uint8_t,   Y, Y)                                 \
+    X(loopslo,            uint8_t,   Y, Y)                                 \
+    X(loopshi,            uint8_t,   Y, Y)                                 \
+    X(freeramlo,          uint8_t,   Y, Y)                                 \
+    X(freeramhi,          uint8_t,   Y, Y)                                 \
+    X(boosttarget,        uint8_t,   Y, Y)                                 \
+    X(boostduty,          uint8_t,   Y, Y)                                 \
+    X(spark,              uint8_t,   Y, Y)                                 \
+    X(rpmdotlo,           uint8_t,   Y, Y)                                 \
+    X(rpmdothi,           uint8_t,   Y, Y)                                 \
+    X(ethanolpct,         uint8_t,   Y, Y)                                 \
+    X(flexcorrection,     uint8_t,   Y, Y)                                 \
+    X(flexigncorrection,  uint8_t,   Y, Y)                                 \
+    X(idleload,           uint8_t,   Y, Y)                                 \
+    X(testoutputs,        uint8_t,   Y, Y)                                 \
+    X(o2_2,               uint8_t,   Y, Y)                                 \
+    X(baro,               uint8_t,   Y, Y)                                 \
+    X(canin,              CanInputs, Y, Y)                                 \
+    X(tpsadc,             uint8_t,   Y, Y)                                 \
+    X(errors,             uint8_t,   Y, Y)                                 \
+    X(unused1,            uint8_t,   Y, N)                                 \
+    X(unused2,            uint8_t,   Y, N)                                 \
+    X(unused3,            uint8_t,   Y, N)                                 \
+    X(pw2,                uint16_t,  N, Y)  /* 0.1ms */                    \
+    X(pw3,                uint16_t,  N, Y)                                 \
+    X(pw4,                uint16_t,  N, Y)                                 \
+    X(status3,            uint8_t,   N, Y)                                 \
+    X(engineProtectStatus, uint8_t,  N, Y)                                 \
+    X(fuelLoad,           uint16_t,  N, Y)  /* kPa */                      \
+    X(ignLoad,            uint16_t,  N, Y)  /* kPa */                      \
+    X(dwellActual,        uint16_t,  N, Y)  /* 0.1ms */                    \
+    X(idleTarget,         uint8_t,   N, Y)  /* RPM / 10 */                 \
+    X(mapDot,             int8_t,    N, Y)  /* kPa/s / 10 */               \
+    X(vvt1Angle,          int16_t,   N, Y)                                 \
+    X(vvt1TargetAngle,    uint8_t,   N, Y)                                 \
+    X(vvt1Duty,           uint8_t,   N, Y)                                 \
+    X(flexBoostCorrection, uint16_t, N, Y)                                 \
+    X(baroCorrection,     uint8_t,   N, Y)  /* % */                        \
+    X(aseValue,           uint8_t,   N, Y)  /* % */                        \
+    X(vss,                uint16_t,  N, Y)  /* km/h */                     \
+    X(gear,               uint8_t,   N, Y)                                 \
+    X(fuelPressure,       uint8_t,   N, Y)  /* psi */                      \
+    X(oilPressure,        uint8_t,   N, Y)  /* psi */                      \
+    X(wmiPW,              uint8_t,   N, Y)                                 \
+    X(status4,            uint8_t,   N, Y)                                 \
+    X(vvt2Angle,          int16_t,   N, Y)                                 \
+    X(vvt2TargetAngle,    uint8_t,   N, Y)                                 \
+    X(vvt2Duty,           uint8_t,   N, Y)                                 \
+    X(outputsStatus,      uint8_t,   N, Y)                                 \
+    X(fuelTemp,           uint8_t,   N, Y)  /* °C + 40 */                  \
+    X(fuelTempCorrection, uint8_t,   N, Y)  /* % */                        \
+    X(ve1,                uint8_t,   N, Y)  /* % */                        \
+    X(ve2,                uint8_t,   N, Y)  /* % */                        \
+    X(advance1,           uint8_t,   N, Y)  /* degrees */                  \
+    X(advance2,           uint8_t,   N, Y)  /* degrees */                  \
+    X(nitrousStatus,      uint8_t,   N, Y)                                 \
+    X(sdStatus,           uint8_t,   N, Y)                                 \
+    X(emap,               uint16_t,  N, Y)  /* kPa */                      \
+    X(fanDuty,            uint8_t,   N, Y)  /* % */                        \
+    X(airConStatus,       uint8_t,   N, Y)                                 \
+    X(syncLossCounter,    uint8_t,   N, Y)
+
+// Table helpers: OUTPUT_IF_<flag>(...) keeps its argument for Y only
+#define OUTPUT_IF_Y(...) __VA_ARGS__
+#define OUTPUT_IF_N(...)
+#define OUTPUT_UNLESS_Y(...)
+#define OUTPUT_UNLESS_N(...) __VA_ARGS__
+
+#define OUTPUT_LEGACY_MEMBER(name, type, legacy, extended) OUTPUT_IF_##legacy(type name;)
+#define OUTPUT_EXTENDED_MEMBER(name, type, legacy, extended) OUTPUT_IF_##extended(type name;)
+#define OUTPUT_EXTRA_MEMBER(name, type, legacy, extended) OUTPUT_UNLESS_##legacy(type name;)
+
+#pragma pack(push, 1)
+
+/**
+ * @struct LegacyLayout
+ * @brief Legacy layout as described by the table (must match EngineStatus)
+ */
+struct LegacyLayout {
+    OUTPUT_CHANNELS(OUTPUT_LEGACY_MEMBER)
+};
+
+/**
+ * @struct ExtendedStatus
+ * @brief Extended layout buffer, sent as is for LAYOUT_EXTENDED
+ */
+struct ExtendedStatus {
+    OUTPUT_CHANNELS(OUTPUT_EXTENDED_MEMBER)
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(ExtendedStatus) == 124, "Extended layout size changed (update the client INI)");
+
+// Largest output channel buffer of this build
+#if OUTPUT_LAYOUT_EXTENDED
+  #define OUTPUT_CHANNELS_MAX_SIZE (sizeof(ExtendedStatus) > sizeof(EngineStatus) ? \
+                                    sizeof(ExtendedStatus) : sizeof(EngineStatus))
+#else
+  #define OUTPUT_CHANNELS_MAX_SIZE sizeof(EngineStatus)
+#endif
+
+/**
+ * @struct ExtraChannels
+ * @brief Simulator working values of the channels EngineStatus lacks
+ */
+struct ExtraChannels {
+    OUTPUT_CHANNELS(OUTPUT_EXTRA_MEMBER)
+};
+
+// EngineStatus is written by hand (documented fields, helpers); pin every
+// legacy channel to the table so the two cannot drift apart
+#define OUTPUT_CHECK_LEGACY(name, type, legacy, extended) \
+    OUTPUT_IF_##legacy(static_assert(offsetof(LegacyLayout, name) == offsetof(EngineStatus, name) && \
+                                     sizeof(LegacyLayout::name) == sizeof(EngineStatus::name), \
+                                     "EngineStatus differs from OUTPUT_CHANNELS: " #name);)
+OUTPUT_CHANNELS(OUTPUT_CHECK_LEGACY)
+static_assert(sizeof(LegacyLayout) == sizeof(EngineStatus), "EngineStatus differs from OUTPUT_CHANNELS");
+
+/**
+ * @brief Fill the extended layout buffer from the simulator's working values
+ * @param out Snapshot buffer
+ * @param status Legacy channels
+ * @param extra Channels only the extended layout has
+ */
+inline void buildExtendedStatus(ExtendedStatus& out, const EngineStatus& status, const ExtraChannels& extra) {
+    #define OUTPUT_SOURCE_Y status
+    #define OUTPUT_SOURCE_N extra
+    #define OUTPUT_FILL(name, type, legacy, extended) \
+        OUTPUT_IF_##extended(memcpy(&out.name, &OUTPUT_SOURCE_##legacy.name, sizeof(out.name));)
+    OUTPUT_CHANNELS(OUTPUT_FILL)
+    #undef OUTPUT_FILL
+    #undef OUTPUT_SOURCE_N
+    #undef OUTPUT_SOURCE_Y
+}
+
+#endif // OUTPUT_CHANNELS_H
@@ -0,0 +1,116 @@
+/**
+ * @file PageStore.h
+ * @brief RAM copy of the tune pages with dirty tracking and burn to storage
+ * 
+ * TunerStudio edits pages in RAM ('M') and makes them permanent with a
+ * burn ('b'/'B'). Only bytes that differ from the stored tune are written,
+ * which keeps EEPROM/flash wear and burn time proportional to the edit.
+ */
+
+#ifndef PAGE_STORE_H
+#define PAGE_STORE_H
+
+#include "INonVolatileStorage.h"
+#include "Config.h"
+
+/**
+ * @class PageStore
+ * @brief Tune pages with per-page dirty ranges
+ */
+class PageStore {
+private:
+    INonVolatileStorage* storage;
+    uint8_t pages[PAGE_0_SIZE + PAGE_1_SIZE];   // All pages back to back
+    
+    // Changed bytes since the last burn: [dirtyStart, dirtyEnd) per page
+    uint16_t dirtyStart[PAGE_COUNT];
+    uint16_t dirtyEnd[PAGE_COUNT];              // 0 = clean
+    
+    // Statistics
+    uint32_t burnCount;
+    uint32_t bytesBurned;
+    
+public:
+    /**
+     * @brief Constructor
+     * @param storage Persistent backend (nullptr = RAM only, burns are no-ops)
+     */
+    explicit PageStore(INonVolatileStorage* storage);
+    
+    /**
+     * @brief Load the burned tune
+     * 
+     * Without a valid burned tune, pages start zeroed and fully dirty so
+     * the first burn writes them completely.
+     * 
+     * @return true if a burned tune was loaded
+     */
+    bool begin();
+    
+    /**
+     * @brief Get the size of a page
+     * @param page Page number
+     * @return Size in bytes (0 for an invalid page)
+     */
+    static uint16_t getPageSize(uint8_t page);
+    
+    /**
+     * @brief Check that a byte range lies within a page
+     * @return true if page, offset and length are valid (length > 0)
+     */
+    static bool isValidRange(uint8_t page, uint16_t offset, uint16_t length);
+    
+    /**
+     * @brief Direct access to a page for reading
+     * @param page Page number (must be valid)
+     * @return Pointer to the page's first byte
+     */
+    const uint8_t* getPage(uint8_t page) const { return &pages[getPageOffset(page)]; }
+    
+    /**
+     * @brief Write bytes to a page in RAM
+     * @param page Page number
+     * @param offset Offset within the page
+     * @param data Bytes to write
+     * @param length Number of bytes
+     * @return false if the range is invalid
+     */
+    bool write(uint8_t page, uint16_t offset, const uint8_t* data, uint16_t length);
+    
+    /**
+     * @brief Check for unburned changes
+     * @param page Page number
+     * @return true if the page differs from the burned tune
+     */
+    bool isDirty(uint8_t page) const { return page < PAGE_COUNT && dirtyEnd[page] > 0; }
+    
+    /**
+     * @brief Burn one page's changes to storage
+     * @param page Page number
+     * @return false if the page is invalid or storage failed
+     */
+    bool burn(uint8_t page);
+    
+    /**
+     * @brief Burn every dirty page
+     * @return false if storage failed
+     */
+    bool burnAll();
+    
+    /**
+     * @brief Get number of successful burns that wrote data
+     */
+    uint32_t getBurnCount() const { return burnCount; }
+    
+    /**
+     * @brief Get total bytes written to storage by burns
+     */
+    uint32_t getBytesBurned() const { return bytesBurned; }
+    
+private:
+    static uint16_t getPageOffset(uint8_t page);
+    bool writeRuns(uint16_t start, uint16_t end);
+    bool writeMarker();
+};
+
+#endif // PAGE_STORE_H
@@ -0,0 +1,35 @@
+/**
+ * @file PgmSpace.h
+ * @brief Portable access to constant data stored in flash (PROGMEM)
+ * 
+ * AVR and ESP8266 keep PROGMEM data out of RAM and need explicit
+ * pgm_read_*() accessors; ESP32 maps flash into the address space, and
+ * native builds fall back to plain memory reads.
+ * 
+ * PGM_DIRECT_ACCESS is 1 where PROGMEM data may be passed to ordinary
+ * pointer-based APIs (memcpy, serial write) without going through pgm_read_*().
+ */
+
+#ifndef PGM_SPACE_H
+#define PGM_SPACE_H
+
+#include <stdint.h>
+
+#if defined(ARDUINO)
+  #include <Arduino.h>
+#else
+  #define PROGMEM
+  #define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+  #define pgm_read_word(addr) (*(const uint16_t*)(addr))
+  #define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+  #define memcpy_P(dest, src, n) memcpy((dest), (src), (n))
+  #include <string.h>
+#endif
+
+#if defined(__AVR__) || defined(ARDUINO_AVR) || defined(ESP8266)
+  #define PGM_DIRECT_ACCESS 0
+#else
+  #define PGM_DIRECT_ACCESS 1
+#endif
+
+#endif // PGM_SPACE_H
@@ -11,11 +11,24 @@
 #include "ISerialInterface.h"
 #include "ITimeProvider.h"
 #include "IRandomProvider.h"
+#include "INonVolatileStorage.h"
+#include "IFrameLogStorage.h"
+#include "Config.h"
+#include <string.h>
 
 #if defined(ARDUINO)
   #include <Arduino.h>
 #endif
 
+#if defined(ARDUINO_AVR) || defined(__AVR__)
+  #include <EEPROM.h>
+  #define HAS_EEPROM_STORAGE
+#elif defined(ESP32) || defined(ESP8266)
+  #include <LittleFS.h>
+  #include "Crc32.h"
+  #define HAS_LOG_STORAGE
+#endif
+
 // ============================================
 // Arduino Serial Adapter
 // ============================================
@@ -24,12 +37,20 @@ class ArduinoSerialAdapter : public ISerialInterface {
 private:
     HardwareSerial* serial;
     
+    // Async TX ring buffer (see setAsyncTransmit())
+    bool asyncTx;
+    uint8_t txRing[SERIAL_TX_RING_SIZE];
+    uint16_t txHead;    // Next free slot
+    uint16_t txTail;    // Next byte to hand to the UART
+    uint16_t txCount;   // Bytes queued
+    
 public:
     explicit ArduinoSerialAdapter(HardwareSerial* serialPort = &Serial) 
-        : serial(serialPort) {}
+        : serial(serialPort), asyncTx(false), txHead(0), txTail(0), txCount(0) {}
     
     void begin(uint32_t baudRate) override {
         serial->begin(baudRate);
+        serial->setTimeout(SERIAL_TIMEOUT_MS);  // Bound blocking readBytes() callers
         // Wait for serial port to be ready
         while (!serial) {
             ; // Wait for serial port to connect
@@ -53,14 +74,42 @@ public:
     }
     
     size_t write(uint8_t byte) override {
-        return serial->write(byte);
+        return write(&byte, 1);
     }
     
     size_t write(const uint8_t* buffer, size_t length) override {
-        return serial->write(buffer, length);
+        if (!asyncTx) {
+            return serial->write(buffer, length);
+        }
+        
+        // Bypass the ring only when nothing is queued, to keep byte order
+        size_t written = 0;
+        if (txCount == 0) {
+            written = writeToHardware(buffer, length);
+        }
+        
+        while (written < length) {
+            if (txCount == SERIAL_TX_RING_SIZE) {
+                pumpRing(true);  // Ring full: block rather than drop data
+            }
+            
+            size_t chunk = length - written;
+            size_t space = SERIAL_TX_RING_SIZE - txCount;
+            size_t contiguous = SERIAL_TX_RING_SIZE - txHead;
+            if (chunk > space) chunk = space;
+            if (chunk > contiguous) chunk = contiguous;
+            
+            memcpy(&txRing[txHead], &buffer[written], chunk);
+            txHead = (txHead + chunk) % SERIAL_TX_RING_SIZE;
+            txCount += chunk;
+            written += chunk;
+        }
+        
+        return length;
     }
     
     void flush() override {
+        pumpRing(true);
         serial->flush();
     }
     
@@ -69,6 +118,61 @@ public:
             serial->read();
         }
     }
+    
+    bool setAsyncTransmit(bool enabled) override {
+        if (!enabled) {
+            pumpRing(true);
+        }
+        asyncTx = enabled;
+        return true;
+    }
+    
+    bool isAsyncTransmit() const override {
+        return asyncTx;
+    }
+    
+    void pollTransmit() override {
+        pumpRing(false);
+    }
+    
+    size_t pendingTransmit() const override {
+        return txCount;
+    }
+    
+private:
+    /**
+     * @brief Write as much as the UART TX buffer accepts without blocking
+     */
+    size_t writeToHardware(const uint8_t* buffer, size_t length) {
+        int room = serial->availableForWrite();
+        if (room <= 0) {
+            return 0;
+        }
+        if (length > (size_t)room) {
+            length = room;
+        }
+        return serial->write(buffer, length);
+    }
+    
+    /**
+     * @brief Move queued bytes to the UART
+     * @param blocking true to wait until the ring is empty
+     */
+    void pumpRing(bool blocking) {
+        while (txCount > 0) {
+            size_t chunk = SERIAL_TX_RING_SIZE - txTail;
+            if (chunk > txCount) chunk = txCount;
+            
+            size_t sent = blocking ? serial->write(&txRing[txTail], chunk)
+                                   : writeToHardware(&txRing[txTail], chunk);
+            if (sent == 0) {
+                break;
+            }
+            
+            txTail = (txTail + sent) % SERIAL_TX_RING_SIZE;
+            txCount -= sent;
+        }
+    }
 };
 
 // ============================================
@@ -113,6 +217,285 @@ public:
     }
 };
 
+// ============================================
+// Tune Storage
+// ============================================
+
+#ifdef HAS_EEPROM_STORAGE
+
+/**
+ * @brief Tune storage in the AVR EEPROM (address = EEPROM address)
+ * 
+ * EEPROM.update() skips cells that already hold the value, so a cell is
+ * only erased/written when its byte really changes.
+ */
+class EepromStorage : public INonVolatileStorage {
+public:
+    bool begin() override {
+        return EEPROM.length() >= PAGE_STORAGE_SIZE;
+    }
+    
+    uint8_t read(uint16_t address) override {
+        return EEPROM.read(address);
+    }
+    
+    bool write(uint16_t address, const uint8_t* data, uint16_t length) override {
+        for (uint16_t i = 0; i < length; i++) {
+            EEPROM.update(address + i, data[i]);
+        }
+        return true;
+    }
+};
+
+#endif // HAS_EEPROM_STORAGE
+
+#ifdef HAS_LOG_STORAGE
+
+/**
+ * @brief Tune storage as an append-only change log on LittleFS
+ * 
+ * A burn appends one record per changed run instead of rewriting the
+ * whole tune, and LittleFS spreads those appends over its blocks. Once
+ * the log exceeds PAGE_LOG_MAX_BYTES it is folded into a full image.
+ * 
+ * Files:
+ * - /tune.bin: Full image (PAGE_STORAGE_SIZE bytes)
+ * - /tune.log: Records [address lo, address hi, length, data..., CRC32 BE]
+ *   applied on top of the image; a torn last record fails its CRC and is
+ *   ignored
+ * 
+ * The RAM image is updated only after a write's records are all stored.
+ * A failed append folds the log into /tune.bin right away, so no later
+ * record is ever appended behind a torn one.
+ */
+class LogStorage : public INonVolatileStorage {
+private:
+    uint8_t image[PAGE_STORAGE_SIZE];   // Current contents (reads never touch flash)
+    File log;
+    
+public:
+    LogStorage() {
+        memset(image, 0xFF, sizeof(image));
+    }
+    
+    bool begin() override {
+        #ifdef ESP32
+            if (!LittleFS.begin(true)) return false;   // Format on first use
+        #else
+            if (!LittleFS.begin()) return false;
+        #endif
+        
+        File base = LittleFS.open("/tune.bin", "r");
+        if (base) {
+            base.read(image, sizeof(image));
+            base.close();
+        }
+        replayLog();
+        return true;
+    }
+    
+    uint8_t read(uint16_t address) override {
+        return (address < sizeof(image)) ? image[address] : 0xFF;
+    }
+    
+    bool write(uint16_t address, const uint8_t* data, uint16_t length) override {
+        if ((uint32_t)address + length > sizeof(image)) {
+            return false;
+        }
+        
+        if (!log) {
+            log = LittleFS.open("/tune.log", "a");
+            if (!log) return false;
+        }
+        
+        // The image follows flash only once every record is stored: after a
+        // failed write a retried burn still sees the difference
+        uint16_t start = address;
+        const uint8_t* source = data;
+        uint16_t total = length;
+        
+        // Records carry at most 255 bytes
+        while (length > 0) {
+            uint8_t chunk = (length > 255) ? 255 : length;
+            uint8_t header[3] = {
+                static_cast<uint8_t>(address & 0xFF),
+                static_cast<uint8_t>(address >> 8),
+                chunk
+            };
+            uint32_t crc = Crc32::finish(Crc32::update(Crc32::update(Crc32::begin(), header, 3),
+                                                        data, chunk));
+            uint8_t trailer[4] = {
+                static_cast<uint8_t>(crc >> 24),
+                static_cast<uint8_t>(crc >> 16),
+                static_cast<uint8_t>(crc >> 8),
+                static_cast<uint8_t>(crc)
+            };
+            
+            if (log.write(header, 3) != 3 || log.write(data, chunk) != chunk ||
+                log.write(trailer, 4) != 4) {
+                // A torn record would end replay there and hide every later
+                // burn: fold the log into the base image (still the last good
+                // state) instead of appending after it
+                log.close();
+                compact();
+                return false;
+            }
+            address += chunk;
+            data += chunk;
+            length -= chunk;
+        }
+        
+        memcpy(&image[start], source, total);
+        return true;
+    }
+    
+    bool commit() override {
+        if (!log) {
+            return true;
+        }
+        size_t logSize = log.size();
+        log.close();
+        
+        return (logSize > PAGE_LOG_MAX_BYTES) ? compact() : true;
+    }
+    
+private:
+    void replayLog() {
+        File replay = LittleFS.open("/tune.log", "r");
+        if (!replay) {
+            return;
+        }
+        
+        uint8_t header[3];
+        uint8_t data[255];
+        uint8_t trailer[4];
+        while (replay.read(header, 3) == 3) {
+            uint8_t length = header[2];
+            uint16_t address = header[0] | (static_cast<uint16_t>(header[1]) << 8);
+            if (replay.read(data, length) != length || replay.read(trailer, 4) != 4) {
+                break;  // Torn record
+            }
+            
+            uint32_t crc = Crc32::finish(Crc32::update(Crc32::update(Crc32::begin(), header, 3),
+                                                        data, length));
+            uint32_t stored = (static_cast<uint32_t>(trailer[0]) << 24) |
+                              (static_cast<uint32_t>(trailer[1]) << 16) |
+                              (static_cast<uint32_t>(trailer[2]) << 8) | trailer[3];
+            if (crc != stored || (uint32_t)address + length > sizeof(image)) {
+                break;
+            }
+            memcpy(&image[address], data, length);
+        }
+        replay.close();
+    }
+    
+    bool compact() {
+        // Write the new image beside the old one and swap it in, so a power
+        // loss leaves either the old image + log or the new image
+        File base = LittleFS.open("/tune.tmp", "w");
+        if (!base) {
+            return false;
+        }
+        bool ok = base.write(image, sizeof(image)) == sizeof(image);
+        base.close();
+        
+        if (!ok || !LittleFS.rename("/tune.tmp", "/tune.bin")) {
+            return false;
+        }
+        return LittleFS.remove("/tune.log");
+    }
+};
+
+/**
+ * @brief Recorded frame log as one file on LittleFS (/frames.bin)
+ * 
+ * Appends go through a handle that stays open and is flushed every
+ * FRAME_LOG_FLUSH_RECORDS records rather than after each one, which keeps
+ * flash metadata writes off the per-record path. A power loss therefore
+ * costs up to FRAME_LOG_FLUSH_RECORDS records (about 5 s of recording at
+ * the default interval). Reads use a second handle, reopened once the log
+ * has grown past its end; pending records are flushed first so the reader
+ * sees them.
+ */
+class FrameLogFile : public IFrameLogStorage {
+private:
+    File writer;
+    File reader;
+    uint32_t length;
+    uint32_t readerLength;  // Log size when the reader was opened
+    uint8_t unflushed;      // Records appended since the last flush
+    
+    void flushWriter() {
+        if (writer && unflushed > 0) {
+            writer.flush();
+        }
+        unflushed = 0;
+    }
+    
+public:
+    FrameLogFile() : length(0), readerLength(0), unflushed(0) {}
+    
+    bool begin() override {
+        #ifdef ESP32
+            if (!LittleFS.begin(true)) return false;   // Format on first use
+        #else
+            if (!LittleFS.begin()) return false;
+        #endif
+        
+        File existing = LittleFS.open("/frames.bin", "r");
+        length = existing ? existing.size() : 0;
+        if (existing) {
+            existing.close();
+        }
+        return true;
+    }
+    
+    uint32_t size() override {
+        return length;
+    }
+    
+    bool append(const uint8_t* data, uint16_t count) override {
+        if (!writer) {
+            writer = LittleFS.open("/frames.bin", "a");
+            if (!writer) return false;
+        }
+        if (writer.write(data, count) != count) {
+            return false;
+        }
+        length += count;
+        if (++unflushed >= FRAME_LOG_FLUSH_RECORDS) {
+            flushWriter();
+        }
+        return true;
+    }
+    
+    uint16_t read(uint32_t offset, uint8_t* buffer, uint16_t count) override {
+        if (reader && offset + count > readerLength) {
+            reader.close();
+        }
+        if (!reader) {
+            flushWriter();
+            reader = LittleFS.open("/frames.bin", "r");
+            if (!reader) return 0;
+            readerLength = reader.size();
+        }
+        if (!reader.seek(offset)) {
+            return 0;
+        }
+        return static_cast<uint16_t>(reader.read(buffer, count));
+    }
+    
+    bool clear() override {
+        unflushed = 0;
+        writer.close();
+        reader.close();
+        length = 0;
+        return !LittleFS.exists("/frames.bin") || LittleFS.remove("/frames.bin");
+    }
+};
+
+#endif // HAS_LOG_STORAGE
+
 // ============================================
 // Factory Functions
 // ============================================
@@ -141,4 +524,32 @@ inline IRandomProvider* createRandomProvider() {
     return new ArduinoRandomProvider();
 }
 
+/**
+ * @brief Create platform-appropriate tune storage
+ * @return Pointer to storage (caller owns memory), or nullptr on platforms
+ *         without persistent storage (tune pages then live in RAM only)
+ */
+inline INonVolatileStorage* createStorage() {
+    #if defined(HAS_EEPROM_STORAGE)
+        return new EepromStorage();
+    #elif defined(HAS_LOG_STORAGE)
+        return new LogStorage();
+    #else
+        return nullptr;
+    #endif
+}
+
+/**
+ * @brief Create platform-appropriate frame log storage
+ * @return Pointer to storage (caller owns memory), or nullptr on platforms
+ *         that do not record frames
+ */
+inline IFrameLogStorage* createFrameLogStorage() {
+    #if defined(HAS_LOG_STORAGE)
+        return new FrameLogFile();
+    #else
+        return nullptr;
+    #endif
+}
+
 #endif // PLATFORM_ADAPTERS_H
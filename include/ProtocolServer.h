@@ -0,0 +1,147 @@
+/**
+ * @file ProtocolServer.h
+ * @brief Multiple concurrent protocol sessions on one simulator
+ * 
+ * Each session pairs a transport (any ISerialInterface) with its own
+ * SpeeduinoProtocol parser, so TunerStudio, a dash and a logger can be
+ * connected at once. All sessions read the simulator's published snapshot
+ * directly; nothing is copied per client.
+ * 
+ * On ESP with ENABLE_WIFI, listen() accepts TCP clients on
+ * PROTOCOL_TCP_PORT through TcpSerialAdapter. Elsewhere (unit tests, host
+ * benchmarks) transports are attached by hand.
+ */
+
+#ifndef PROTOCOL_SERVER_H
+#define PROTOCOL_SERVER_H
+
+#include "EngineSimulator.h"
+#include "SpeeduinoProtocol.h"
+#include "ISerialInterface.h"
+#include "ITimeProvider.h"
+#include "Config.h"
+
+class PageStore;
+class FrameLog;
+
+#ifdef ENABLE_WIFI
+  class AsyncServer;
+  class AsyncClient;
+  class TcpSerialAdapter;
+#endif
+
+/**
+ * @class ProtocolServer
+ * @brief Fixed table of protocol sessions serviced from loop()
+ */
+class ProtocolServer {
+private:
+    struct Session {
+        ISerialInterface* transport;    // nullptr = free slot
+        SpeeduinoProtocol* protocol;
+        bool ownsTransport;             // Delete transport on detach
+    };
+    
+    EngineSimulator* simulator;
+    ITimeProvider* timeProvider;
+    PageStore* pageStore;
+    FrameLog* frameLog;
+    Session sessions[PROTOCOL_SERVER_MAX_SESSIONS];
+    uint8_t sessionCount;
+    uint32_t acceptedCount;
+    uint32_t rejectedCount;
+    
+    #ifdef ENABLE_WIFI
+        AsyncServer* server;
+        // Accepted in the TCP task, adopted in update() (one producer, one consumer).
+        // The adapter is built on accept so no byte sent before adoption is lost.
+        TcpSerialAdapter* volatile pendingClients[PROTOCOL_SERVER_MAX_SESSIONS];
+    #endif
+    
+public:
+    /**
+     * @brief Constructor
+     * @param simulator Engine simulator shared by all sessions
+     * @param timeProvider Optional time source (request timeout, latency)
+     * @param pageStore Optional tune pages shared by all sessions
+     */
+    ProtocolServer(EngineSimulator* simulator, ITimeProvider* timeProvider = nullptr,
+                   PageStore* pageStore = nullptr);
+    
+    /**
+     * @brief Destructor (closes all sessions)
+     */
+    ~ProtocolServer();
+    
+    /**
+     * @brief Offer the onboard frame log ('y'/'Y') to sessions started from now on
+     * @param log Frame log shared by all sessions
+     */
+    void setFrameLog(FrameLog* log) { frameLog = log; }
+    
+    /**
+     * @brief Start a session on a transport
+     * 
+     * The transport is switched to asynchronous transmit, so responses of
+     * one update() pass leave in a single write per session.
+     * 
+     * @param transport Connected transport
+     * @param takeOwnership true to delete the transport when the session ends
+     * @return Session index, or -1 if all PROTOCOL_SERVER_MAX_SESSIONS are in use
+     */
+    int8_t attach(ISerialInterface* transport, bool takeOwnership = false);
+    
+    /**
+     * @brief End a session
+     * @param index Session index returned by attach()
+     */
+    void detach(uint8_t index);
+    
+    /**
+     * @brief Service all sessions (call in loop)
+     * 
+     * Ends sessions whose transport is no longer ready, lets every session
+     * process its pending requests, then transmits each session's queued
+     * responses.
+     * 
+     * @return Number of requests completed over all sessions
+     */
+    uint16_t update();
+    
+    /**
+     * @brief Get number of active sessions
+     */
+    uint8_t getSessionCount() const { return sessionCount; }
+    
+    /**
+     * @brief Get a session's protocol handler
+     * @param index Session index
+     * @return Protocol handler, or nullptr for a free slot
+     */
+    SpeeduinoProtocol* getSession(uint8_t index) const;
+    
+    /**
+     * @brief Get number of sessions started since construction
+     */
+    uint32_t getAcceptedCount() const { return acceptedCount; }
+    
+    /**
+     * @brief Get number of connections refused because all slots were in use
+     */
+    uint32_t getRejectedCount() const { return rejectedCount; }
+    
+    #ifdef ENABLE_WIFI
+        /**
+         * @brief Accept TCP clients
+         * @param port TCP port
+         * @return true if listening
+         */
+        bool listen(uint16_t port = PROTOCOL_TCP_PORT);
+    
+    private:
+        void acceptClient(AsyncClient* client);
+        void adoptPendingClients();
+    #endif
+};
+
+#endif // PROTOCOL_SERVER_H
@@ -7,10 +7,27 @@
  * 
  * Supported commands:
  * - 'A': Get real-time data (75 bytes + 4 CAN)
+ * - 'r': Ranged read of the real-time data (offset + length)
+ * - 'e': Real-time data as changes against the last frame the client acknowledged
  * - 'Q': ECU status and capabilities
  * - 'V': Firmware version string
  * - 'S': ECU signature (identification)
+ * - 's': Select the output channel layout by signature (per session)
  * - 'n': Get page sizes
+ * - 'D': Diagnostics (per-command count and latency histogram)
+ * - 'G'/'g': Start/stop pushing real-time data every N simulator ticks
+ * - 'p': Read tune page
+ * - 'M': Write tune page (RAM)
+ * - 'b'/'B': Burn one/all tune pages to EEPROM/flash
+ * - 'H'/'h', 'T': Start/stop the tooth logger, fetch tooth gaps
+ * - 'J'/'j', 'X'/'x', 'O': Start/stop the composite logger, fetch events
+ * - 'u': Switch the baud rate (falls back unless confirmed at the new rate)
+ * - 'l': Link self-test (test pattern in both directions, error count)
+ * - 'y'/'Y': Download the onboard frame log in CRC-checked chunks / clear it
+ * 
+ * Every command is accepted either raw (legacy single-byte protocol) or
+ * wrapped in a CRC32 frame (Speeduino "new" protocol); the framing mode is
+ * detected per request and remembered for the session.
  */
 
 #ifndef SPEEDUINO_PROTOCOL_H
@@ -19,29 +36,139 @@
 #include "EngineStatus.h"
 #include "EngineSimulator.h"
 #include "ISerialInterface.h"
+#include "ITimeProvider.h"
 #include "Config.h"
 
+class PageStore;
+class FrameLog;
+
+#ifdef MINIMAL_FEATURES
+  typedef uint16_t LatencyCount;    // Saturates at 65535
+#else
+  typedef uint32_t LatencyCount;
+#endif
+
 /**
  * @class SpeeduinoProtocol
  * @brief Serial protocol handler for Speeduino commands
  */
 class SpeeduinoProtocol {
+    // Command handlers live in the compile-time dispatch table (SpeeduinoProtocol.cpp)
+    friend struct CommandTable;
+    
+public:
+    /// 'r' sub-command selecting the output channel (EngineStatus) block
+    static const uint8_t RANGED_READ_OUTPUT_CHANNELS = 0x30;
+    
+    /// Return codes (first payload byte of framed responses)
+    static const uint8_t RC_OK = 0x00;
+    static const uint8_t RC_BURN_OK = 0x04;
+    static const uint8_t RC_CRC_ERROR = 0x82;
+    static const uint8_t RC_UNKNOWN_COMMAND = 0x83;
+    static const uint8_t RC_RANGE_ERROR = 0x84;
+    static const uint8_t RC_BUSY_ERROR = 0x85;
+    
+    /// Latency histogram layout (see getLatencyBucketFloorUs())
+    static const uint8_t LATENCY_BUCKETS = PROTOCOL_LATENCY_BUCKETS;
+    
 private:
+    /// Highest first byte of a framed request (payload length high byte)
+    static const uint8_t FRAME_MAX_SIZE_HIGH = PROTOCOL_RX_BUFFER_SIZE >> 8;
+    
+    /// Request parser states
+    enum RxState : uint8_t {
+        RX_IDLE,            // Waiting for a command byte or frame start
+        RX_LEGACY_ARGS,     // Collecting argument bytes of a raw command
+        RX_LEGACY_DATA,     // Collecting data bytes of a variable-length raw command
+        RX_FRAME_SIZE_LOW,  // Frame header, second size byte
+        RX_FRAME_PAYLOAD,   // Frame payload
+        RX_FRAME_CRC        // Frame CRC32 trailer
+    };
+    
     ISerialInterface* serial;
     EngineSimulator* simulator;
+    ITimeProvider* timeProvider;
+    PageStore* pageStore;
+    FrameLog* frameLog;
+    
+    // Drain budget (per processCommands() call)
+    uint8_t maxCommandsPerCall;
+    uint16_t maxProcessTimeUs;
+    bool budgetExhausted;   // Last call stopped with input still waiting
+    
+    // Framing state
+    bool framedSession;     // Client last spoke the framed protocol
+    bool framedRequest;     // Request being handled arrived in a frame
+    uint8_t strayBytes;     // Non-frame bytes dropped in a row (framed session)
+    OutputLayout layout;    // Output channels for 'A'/'r'/'G' (selected with 's')
+    uint8_t rxBuffer[PROTOCOL_RX_BUFFER_SIZE];  // Frame payload / argument bytes
+    
+    // Incremental request parser (a request may span processCommands() calls)
+    RxState rxState;
+    uint8_t rxCommand;      // Raw command awaiting its arguments
+    uint16_t rxExpected;    // Argument count or frame payload size
+    uint16_t rxCount;       // Bytes collected in the current state
+    uint32_t rxCrc;         // Received frame CRC32
+    uint32_t rxByteTime;    // micros() of the last byte (SERIAL_TIMEOUT_MS resync)
+    
+    // Push streaming ('G'/'g')
+    bool streaming;
+    bool streamFramed;          // Push records as CRC32 frames
+    uint8_t streamInterval;     // Simulator ticks between records
+    uint16_t streamOffset;      // Output channel subset
+    uint16_t streamLength;
+    uint32_t streamGeneration;  // Snapshot generation of the last record sent
+    
+    // Delta-compressed real-time data ('e')
+    uint8_t deltaBase[OUTPUT_CHANNELS_MAX_SIZE];    // Channels of the last 'e' frame sent
+    uint16_t deltaSequence;     // Sequence number of that frame
+    bool deltaBaseValid;        // deltaBase holds a frame of the current layout
+    uint8_t deltaSinceKeyframe; // Delta frames sent since the last keyframe
+    uint32_t deltaFrameCount;
+    uint32_t keyframeCount;
+    
+    // Runtime baud rate ('u') and link self-test ('l')
+    uint32_t baudRate;          // Current link speed
+    uint32_t fallbackBaudRate;  // Speed restored unless the switch is confirmed
+    uint32_t baudSwitchTime;    // micros() of the unconfirmed switch
+    bool baudPending;           // Waiting for a valid request at the new speed
+    uint32_t baudFallbackCount;
+    uint32_t selfTestBytes;     // Test pattern bytes received
+    uint32_t selfTestErrors;    // ... and how many of them were wrong
+    
+    // Frame log download ('y')
+    bool downloading;
+    bool downloadFramed;        // Send chunks as CRC32 frames
+    uint32_t downloadOffset;    // Next log byte to send
+    uint32_t downloadEnd;       // Log size when the download started
+    
+    #if PROTOCOL_TX_SPANS > 0
+        // Responses of the current drain pass, sent by flushResponses()
+        SerialSpan txSpans[PROTOCOL_TX_SPANS];
+        uint8_t txSpanCount;
+        uint8_t txScratch[PROTOCOL_TX_SCRATCH_SIZE];    // Bytes that do not outlive their handler
+        uint16_t txScratchUsed;
+        bool txUnflushed;       // Written since the last blocking flush()
+    #endif
     
     // Statistics
     uint32_t commandCount;
     uint32_t errorCount;
-    uint32_t lastCommandTime;
+    uint32_t lastCommandTime;   // micros() when the current/last request's first byte was read
+    uint32_t commandSlotCounts[PROTOCOL_COMMAND_SLOTS];  // Indexed by dispatch table slot
+    LatencyCount latencyHistogram[PROTOCOL_COMMAND_SLOTS][PROTOCOL_LATENCY_BUCKETS];
     
 public:
     /**
      * @brief Constructor
      * @param serial Serial interface for communication
      * @param simulator Engine simulator providing data
+     * @param timeProvider Optional time source for the per-call time budget
+     * @param pageStore Optional tune pages for 'p'/'M'/'b'/'B' (rejected
+     *                  with a range error without one)
      */
-    SpeeduinoProtocol(ISerialInterface* serial, EngineSimulator* simulator);
+    SpeeduinoProtocol(ISerialInterface* serial, EngineSimulator* simulator,
+                      ITimeProvider* timeProvider = nullptr, PageStore* pageStore = nullptr);
     
     /**
      * @brief Initialize protocol handler
@@ -50,9 +177,44 @@ public:
     
     /**
      * @brief Process incoming serial commands (call in loop)
-     * @return true if command was processed, false if none available
+     * 
+     * Drains the receive buffer until it is empty or the per-call budget
+     * (command count or elapsed time) is used up, so a connect burst such
+     * as "QSnA" is answered in a single loop() pass.
+     * 
+     * Never blocks waiting for input: a request whose bytes arrive over
+     * several calls is assembled incrementally, and a partial request is
+     * dropped once no byte arrived for SERIAL_TIMEOUT_MS (requires a time
+     * provider).
+     * 
+     * Also pushes a stream record when streaming is active and the
+     * simulator has published enough new ticks, and the next frame log
+     * chunk while a 'y' download is in progress.
+     * 
+     * @return Number of requests completed (0 if none)
+     */
+    uint8_t processCommands();
+    
+    /**
+     * @brief Set the drain budget for processCommands()
+     * @param maxCommands Maximum commands per call (1 = legacy single byte)
+     * @param maxTimeUs Maximum time per call in microseconds (0 = no limit,
+     *                  ignored without a time provider)
+     */
+    void setProcessingBudget(uint8_t maxCommands, uint16_t maxTimeUs);
+    
+    /**
+     * @brief Check whether the last processCommands() ran out of budget
+     * @return true if it stopped at the command or time limit while more
+     *         input was already waiting
+     */
+    bool isBudgetExhausted() const { return budgetExhausted; }
+    
+    /**
+     * @brief Attach the onboard frame log for 'y'/'Y'
+     * @param log Frame log (nullptr = 'y'/'Y' are rejected with a range error)
      */
-    bool processCommands();
+    void setFrameLog(FrameLog* log) { frameLog = log; }
     
     /**
      * @brief Get total commands processed
@@ -60,24 +222,163 @@ public:
      */
     uint32_t getCommandCount() const { return commandCount; }
     
+    /**
+     * @brief Get number of times a specific command was handled
+     * @param command Command byte (aliases such as 'V'/'v' share a count;
+     *                any unknown byte returns the unknown-command count)
+     * @return Command count
+     */
+    uint32_t getCommandCount(uint8_t command) const;
+    
+    /**
+     * @brief Get the statistics slot of a command byte
+     * @param command Command byte
+     * @return Slot index (0 = unknown command; aliases share a slot)
+     */
+    uint8_t getCommandSlot(uint8_t command) const;
+    
+    /**
+     * @brief Get one latency histogram bucket of a command
+     * 
+     * Latency runs from reading the request's first byte to the last
+     * response byte being handed to the serial driver (queued, or flushed
+     * for synchronous transports). With response gathering
+     * (PROTOCOL_TX_SPANS) it ends when the response is queued for the
+     * pass's gathered write. Requires a time provider.
+     * 
+     * @param command Command byte (aliases share a histogram)
+     * @param bucket Bucket index (0 to LATENCY_BUCKETS - 1)
+     * @return Number of requests in the bucket
+     */
+    uint32_t getLatencyCount(uint8_t command, uint8_t bucket) const;
+    
+    /**
+     * @brief Get the lower bound of a latency bucket
+     * 
+     * Bucket 0 holds latencies below 1 << PROTOCOL_LATENCY_SHIFT us; each
+     * following bucket doubles, the last one is open-ended.
+     * 
+     * @param bucket Bucket index
+     * @return Smallest latency in the bucket in microseconds
+     */
+    static uint32_t getLatencyBucketFloorUs(uint8_t bucket);
+    
+    /**
+     * @brief Get the time the last request started
+     * @return micros() when its first byte was read (0 without a time provider)
+     */
+    uint32_t getLastCommandTime() const { return lastCommandTime; }
+    
     /**
      * @brief Get error count
      * @return Number of invalid commands
      */
     uint32_t getErrorCount() const { return errorCount; }
     
+    /**
+     * @brief Check which protocol the client is using
+     * @return true if the last valid request was CRC32-framed
+     */
+    bool isFramedSession() const { return framedSession; }
+    
+    /**
+     * @brief Check whether push streaming is active
+     * @return true between 'G' and 'g' (or begin())
+     */
+    bool isStreaming() const { return streaming; }
+    
+    /**
+     * @brief Check whether a frame log download is in progress
+     * @return true from 'y' until the final (empty) chunk is sent
+     */
+    bool isDownloading() const { return downloading; }
+    
+    /**
+     * @brief Get the session's output channel layout
+     * @return Layout sent by 'A', 'r' and 'G' (LAYOUT_LEGACY after begin())
+     */
+    OutputLayout getOutputLayout() const { return layout; }
+    
+    /**
+     * @brief Get number of 'e' replies sent as changes only
+     */
+    uint32_t getDeltaFrameCount() const { return deltaFrameCount; }
+    
+    /**
+     * @brief Get number of 'e' replies sent as full keyframes
+     */
+    uint32_t getKeyframeCount() const { return keyframeCount; }
+    
+    /**
+     * @brief Get the current link speed
+     * @return Baud rate (SERIAL_BAUD_RATE after begin())
+     */
+    uint32_t getBaudRate() const { return baudRate; }
+    
+    /**
+     * @brief Check whether a baud rate switch awaits confirmation
+     * @return true until a valid request arrives at the new speed, or the
+     *         link falls back after SERIAL_BAUD_CONFIRM_MS
+     */
+    bool isBaudRatePending() const { return baudPending; }
+    
+    /**
+     * @brief Get number of baud rate switches undone for lack of confirmation
+     */
+    uint32_t getBaudFallbackCount() const { return baudFallbackCount; }
+    
+    /**
+     * @brief Get number of self-test ('l') pattern bytes received
+     */
+    uint32_t getSelfTestBytes() const { return selfTestBytes; }
+    
+    /**
+     * @brief Get number of self-test pattern bytes received corrupted
+     */
+    uint32_t getSelfTestErrors() const { return selfTestErrors; }
+    
+    /**
+     * @brief Self-test pattern byte
+     * @param index Byte position in the 'l' data
+     * @return Expected byte (every value once per 256 bytes)
+     */
+    static uint8_t selfTestPattern(uint16_t index) {
+        return static_cast<uint8_t>(index * 167 + 13);
+    }
+    
 private:
-    // Command handlers
-    void handleRealtimeData();      // 'A' command
-    void handleStatusRequest();     // 'Q' command
-    void handleVersionRequest();    // 'V' command (alias 'v')
-    void handleSignatureRequest();  // 'S' command
-    void handlePageSizesRequest();  // 'n' command
+    // Request parsing and dispatch
+    bool receiveByte(uint8_t rxByte);
+    void handleLegacyCommand(uint8_t command);
+    void handleFrame(uint16_t size, uint32_t receivedCrc);
     void handleUnknownCommand(char cmd);
+    void recordCommand(uint8_t slot);
+    void finishBurn(bool burned);
+    void setToothLogger(ToothLogMode mode);
+    void sendToothLog(ToothLogMode mode);
+    void serviceStream();
+    void sendStreamRecord(const EngineSnapshot& snapshot);
+    void serviceDownload();
+    void switchBaudRate(uint32_t newBaudRate);
+    void checkBaudRateFallback(uint32_t now);
     
     // Utility functions
     void sendResponse(const uint8_t* data, size_t length);
+    void sendResponseInPlace(const uint8_t* data, size_t length);
+    void sendError(uint8_t returnCode);
+    void sendFrame(uint8_t returnCode, const uint8_t* data, size_t length);
+    void sendFlashResponse(const uint8_t* flashData, size_t length, uint32_t framedCrc);
+    void writeFlash(const uint8_t* flashData, size_t length);
+    void writeFrameHeader(uint8_t returnCode, size_t length);
+    void writeFrameTrailer(uint32_t crc);
+    void finishResponse();
     void sendString(const char* str);
+    
+    // Response output (gathered per drain pass where PROTOCOL_TX_SPANS > 0)
+    void queueSpan(const uint8_t* data, size_t length);
+    void queueCopy(const uint8_t* data, size_t length);
+    void transmitQueued();
+    void flushResponses();
 };
 
 #endif // SPEEDUINO_PROTOCOL_H
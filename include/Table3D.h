@@ -0,0 +1,175 @@
+/**
+ * @file Table3D.h
+ * @brief Speeduino-style 16x16 tune table with bilinear interpolation
+ * 
+ * The table data (values plus RPM and load axes) lives in flash; only the
+ * per-axis bin cache is kept in RAM. A lookup:
+ * 
+ * 1. Finds the bin on each axis. The bin found last time is checked first,
+ *    so while RPM and MAP stay between the same two breakpoints (most
+ *    ticks) no axis data is read and no division runs. Otherwise the bin
+ *    is binary-searched and its span reciprocal recomputed once.
+ * 2. Interpolates the four surrounding cells in 8-bit fixed point
+ *    (fractions in 1/256, intermediate rows in Q8.8, FixedPoint.h),
+ *    rounding once at the end.
+ * 
+ * Inputs beyond the outermost breakpoints are clamped to the edge cells.
+ */
+
+#ifndef TABLE_3D_H
+#define TABLE_3D_H
+
+#include <stdint.h>
+#include "PgmSpace.h"
+#include "FixedPoint.h"
+
+/// Breakpoints per axis (Speeduino VE / spark table size)
+#define TABLE3D_SIZE 16
+
+/**
+ * @struct Table3DData
+ * @brief Table contents, same order as a Speeduino table page
+ * 
+ * Axes must be strictly increasing.
+ */
+struct Table3DData {
+    uint8_t values[TABLE3D_SIZE][TABLE3D_SIZE];  ///< [load bin][RPM bin], row 0 = lowest load
+    uint16_t rpmBins[TABLE3D_SIZE];              ///< X axis, RPM
+    uint16_t loadBins[TABLE3D_SIZE];             ///< Y axis, MAP in kPa
+};
+
+/**
+ * @class Table3D
+ * @brief Lookup on a Table3DData in flash with cached axis bins
+ */
+class Table3D {
+private:
+    /**
+     * @brief Last bin found on one axis: [low, high) and its reciprocal span
+     */
+    struct AxisCache {
+        uint16_t low;
+        uint16_t high;          // low == high: nothing cached
+        uint16_t scale;         // 65535 / (high - low)
+        uint8_t bin;
+    };
+    
+    const Table3DData* data;    // PROGMEM
+    AxisCache rpmCache;
+    AxisCache loadCache;
+    uint32_t binSearches;       // Cache misses that searched an axis
+    
+    /**
+     * @brief Locate a value on an axis
+     * @param bins Axis breakpoints (PROGMEM)
+     * @param value Axis input
+     * @param cache Bin cache of this axis
+     * @param bin Set to the lower cell of the pair to interpolate
+     * @return Position between bin and bin + 1
+     */
+    frac8_t locate(const uint16_t* bins, uint16_t value, AxisCache& cache, uint8_t* bin) {
+        if (value >= cache.low && value < cache.high) {
+            *bin = cache.bin;
+            // 16 x 16 -> 32 bit product: a widening multiply on AVR, not a
+            // full 32-bit one
+            return static_cast<frac8_t>(((uint32_t)(uint16_t)(value - cache.low) * cache.scale) >> 8);
+        }
+        
+        // Clamp at the edges (not cached: stays cheap, needs no division)
+        if (value <= pgm_read_word(&bins[0])) {
+            *bin = 0;
+            return 0;
+        }
+        if (value >= pgm_read_word(&bins[TABLE3D_SIZE - 1])) {
+            *bin = TABLE3D_SIZE - 2;
+            return 256;
+        }
+        
+        // bins[low] <= value < bins[high]
+        uint8_t low = 0;
+        uint8_t high = TABLE3D_SIZE - 1;
+        while (high - low > 1) {
+            uint8_t mid = (low + high) / 2;
+            if (pgm_read_word(&bins[mid]) <= value) {
+                low = mid;
+            } else {
+                high = mid;
+            }
+        }
+        
+        cache.bin = low;
+        cache.low = pgm_read_word(&bins[low]);
+        cache.high = pgm_read_word(&bins[high]);
+        cache.scale = 65535U / (cache.high - cache.low);
+        binSearches++;
+        
+        *bin = low;
+        return static_cast<frac8_t>(((uint32_t)(uint16_t)(value - cache.low) * cache.scale) >> 8);
+    }
+    
+public:
+    /**
+     * @brief Constructor
+     * @param data Table in flash (PROGMEM)
+     */
+    explicit Table3D(const Table3DData* data) : data(data), binSearches(0) {
+        invalidate();
+    }
+    
+    /**
+     * @brief Interpolated table value
+     * @param rpm Engine speed
+     * @param load MAP in kPa
+     * @return Value, rounded to the nearest integer
+     */
+    uint8_t lookup(uint16_t rpm, uint16_t load) {
+        uint8_t x;
+        uint8_t y;
+        frac8_t fx = locate(data->rpmBins, rpm, rpmCache, &x);
+        frac8_t fy = locate(data->loadBins, load, loadCache, &y);
+        
+        const uint8_t* lower = data->values[y];
+        const uint8_t* upper = data->values[y + 1];
+        
+        // Along RPM on both rows, then along load
+        q8_8_t bottom = fpLerp(pgm_read_byte(&lower[x]), pgm_read_byte(&lower[x + 1]), fx);
+        q8_8_t top = fpLerp(pgm_read_byte(&upper[x]), pgm_read_byte(&upper[x + 1]), fx);
+        return fpLerpRound(bottom, top, fy);
+    }
+    
+    /**
+     * @brief Get a table cell
+     * @param loadBin Row (0 = lowest load)
+     * @param rpmBin Column (0 = lowest RPM)
+     */
+    uint8_t getValue(uint8_t loadBin, uint8_t rpmBin) const {
+        return pgm_read_byte(&data->values[loadBin][rpmBin]);
+    }
+    
+    /**
+     * @brief Get an RPM axis breakpoint
+     */
+    uint16_t getRpmBin(uint8_t bin) const { return pgm_read_word(&data->rpmBins[bin]); }
+    
+    /**
+     * @brief Get a load axis breakpoint (kPa)
+     */
+    uint16_t getLoadBin(uint8_t bin) const { return pgm_read_word(&data->loadBins[bin]); }
+    
+    /**
+     * @brief Forget the cached bins (the next lookup searches both axes)
+     */
+    void invalidate() {
+        rpmCache.low = rpmCache.high = 0;
+        loadCache.low = loadCache.high = 0;
+        rpmCache.scale = loadCache.scale = 0;
+        rpmCache.bin = loadCache.bin = 0;
+    }
+    
+    /**
+     * @brief Get number of axis lookups that missed the bin cache
+     */
+    uint32_t getBinSearches() const { return binSearches; }
+};
+
+#endif // TABLE_3D_H
@@ -0,0 +1,232 @@
+/**
+ * @file TcpSerialAdapter.h
+ * @brief ISerialInterface on top of an AsyncTCP / ESPAsyncTCP client socket
+ * 
+ * ESP32/ESP8266 only. Lets a SpeeduinoProtocol instance serve one TCP
+ * connection exactly as it serves the UART (see ProtocolServer).
+ * 
+ * Received data is copied from the TCP task into an SPSC ring and read by
+ * the protocol in loop(). Writes are collected in a TX buffer and handed to
+ * the socket in one segment per loop() pass (pollTransmit()); Nagle is
+ * disabled so that segment leaves immediately.
+ */
+
+#ifndef TCP_SERIAL_ADAPTER_H
+#define TCP_SERIAL_ADAPTER_H
+
+#ifdef ENABLE_WIFI
+
+#include "ISerialInterface.h"
+#include "Config.h"
+#include <string.h>
+
+#ifdef ESP32
+  #include <AsyncTCP.h>
+#elif defined(ESP8266)
+  #include <ESPAsyncTCP.h>
+#endif
+
+static_assert((TCP_RX_BUFFER_SIZE & (TCP_RX_BUFFER_SIZE - 1)) == 0,
+              "TCP_RX_BUFFER_SIZE must be a power of two");
+
+/**
+ * @class TcpSerialAdapter
+ * @brief One TCP client as a serial port
+ * 
+ * The adapter owns the client and deletes it with itself. It never blocks:
+ * received bytes that do not fit the RX ring and response bytes the socket
+ * cannot take while the TX buffer is full are dropped and counted, so a
+ * stalled client only loses its own data. The protocol's request timeout
+ * and the client's retry resynchronize the session.
+ */
+class TcpSerialAdapter : public ISerialInterface {
+private:
+    static const uint16_t RX_MASK = TCP_RX_BUFFER_SIZE - 1;
+    
+    AsyncClient* client;
+    volatile bool connected;
+    bool asyncTx;
+    
+    // RX ring: written by the TCP task (onData), read by loop()
+    uint8_t rxRing[TCP_RX_BUFFER_SIZE];
+    volatile uint16_t rxHead;   // Bytes ever received (TCP task)
+    volatile uint16_t rxTail;   // Bytes ever read (loop)
+    uint32_t rxDropped;
+    
+    // TX buffer: [txStart, txEnd) waits for the socket
+    uint8_t txBuffer[TCP_TX_BUFFER_SIZE];
+    uint16_t txStart;
+    uint16_t txEnd;
+    uint32_t txDropped;
+    
+public:
+    /**
+     * @brief Constructor
+     * @param client Connected client (ownership is taken)
+     */
+    explicit TcpSerialAdapter(AsyncClient* client)
+        : client(client), connected(true), asyncTx(false)
+        , rxHead(0), rxTail(0), rxDropped(0)
+        , txStart(0), txEnd(0), txDropped(0) {
+        client->setNoDelay(true);
+        client->onData([](void* arg, AsyncClient*, void* data, size_t length) {
+            static_cast<TcpSerialAdapter*>(arg)->receive(static_cast<const uint8_t*>(data), length);
+        }, this);
+        client->onDisconnect([](void* arg, AsyncClient*) {
+            static_cast<TcpSerialAdapter*>(arg)->connected = false;
+        }, this);
+    }
+    
+    ~TcpSerialAdapter() override {
+        // No callback may reach this object once it is gone
+        client->onData(nullptr, nullptr);
+        client->onDisconnect(nullptr, nullptr);
+        delete client;  // Closes the connection if still open
+    }
+    
+    void begin(uint32_t) override {}
+    
+    bool setBaudRate(uint32_t) override {
+        return false;
+    }
+    
+    bool isReady() override {
+        // Also catches a close that happened before the callbacks were set
+        return connected && client->connected();
+    }
+    
+    int available() override {
+        return (uint16_t)(rxHead - rxTail);
+    }
+    
+    int read() override {
+        uint16_t tail = rxTail;
+        if (tail == rxHead) {
+            return -1;
+        }
+        uint8_t byte = rxRing[tail & RX_MASK];
+        __sync_synchronize();
+        rxTail = tail + 1;
+        return byte;
+    }
+    
+    size_t readBytes(uint8_t* buffer, size_t length) override {
+        size_t count = 0;
+        int byte;
+        while (count < length && (byte = read()) >= 0) {
+            buffer[count++] = byte;
+        }
+        return count;
+    }
+    
+    size_t write(uint8_t byte) override {
+        return write(&byte, 1);
+    }
+    
+    size_t write(const uint8_t* buffer, size_t length) override {
+        size_t written = 0;
+        while (written < length) {
+            if (txEnd == TCP_TX_BUFFER_SIZE) {
+                sendPending();
+                compact();
+                if (txEnd == TCP_TX_BUFFER_SIZE) {
+                    break;  // Socket backed up: drop rather than stall loop()
+                }
+            }
+            size_t chunk = length - written;
+            if (chunk > (size_t)(TCP_TX_BUFFER_SIZE - txEnd)) {
+                chunk = TCP_TX_BUFFER_SIZE - txEnd;
+            }
+            memcpy(&txBuffer[txEnd], &buffer[written], chunk);
+            txEnd += chunk;
+            written += chunk;
+        }
+        txDropped += length - written;
+        return length;
+    }
+    
+    /**
+     * @brief Hand buffered bytes to the socket (does not wait for the ACK)
+     */
+    void flush() override {
+        sendPending();
+    }
+    
+    void clear() override {
+        rxTail = rxHead;
+    }
+    
+    bool setAsyncTransmit(bool enabled) override {
+        if (!enabled) {
+            sendPending();
+        }
+        asyncTx = enabled;
+        return true;
+    }
+    
+    bool isAsyncTransmit() const override {
+        return asyncTx;
+    }
+    
+    void pollTransmit() override {
+        sendPending();
+    }
+    
+    size_t pendingTransmit() const override {
+        return txEnd - txStart;
+    }
+    
+    /**
+     * @brief Get number of bytes lost to a full RX ring or TX buffer
+     */
+    uint32_t getDropped() const { return rxDropped + txDropped; }
+    
+private:
+    // TCP task: copy a received segment into the ring
+    void receive(const uint8_t* data, size_t length) {
+        uint16_t head = rxHead;
+        uint16_t space = TCP_RX_BUFFER_SIZE - (uint16_t)(head - rxTail);
+        if (length > space) {
+            rxDropped += length - space;
+            length = space;
+        }
+        for (size_t i = 0; i < length; i++) {
+            rxRing[(head + i) & RX_MASK] = data[i];
+        }
+        __sync_synchronize();
+        rxHead = head + length;
+    }
+    
+    void sendPending() {
+        if (txStart == txEnd || !connected) {
+            return;
+        }
+        size_t room = client->space();
+        size_t chunk = txEnd - txStart;
+        if (chunk > room) {
+            chunk = room;
+        }
+        if (chunk > 0) {
+            chunk = client->add(reinterpret_cast<const char*>(&txBuffer[txStart]), chunk);
+            if (chunk > 0) {
+                client->send();
+                txStart += chunk;
+            }
+        }
+        if (txStart == txEnd) {
+            txStart = txEnd = 0;
+        }
+    }
+    
+    void compact() {
+        if (txStart > 0) {
+            memmove(txBuffer, &txBuffer[txStart], txEnd - txStart);
+            txEnd -= txStart;
+            txStart = 0;
+        }
+    }
+};
+
+#endif // ENABLE_WIFI
+
+#endif // TCP_SERIAL_ADAPTER_H
@@ -0,0 +1,173 @@
+/**
+ * @file ToothLog.h
+ * @brief Fixed-size ring buffer for tooth and composite logger entries
+ * 
+ * Single producer (EngineSimulator::update()) and single consumer (the
+ * protocol's 'T'/'O' handlers). The producer never waits: when the
+ * consumer falls behind, the oldest entries are overwritten and counted as
+ * dropped, so a slow or absent client can never stall the main loop.
+ */
+
+#ifndef TOOTH_LOG_H
+#define TOOTH_LOG_H
+
+#include <stdint.h>
+#include <string.h>
+#include "Config.h"
+
+static_assert((TOOTH_LOG_BUFFER_SIZE & (TOOTH_LOG_BUFFER_SIZE - 1)) == 0,
+              "TOOTH_LOG_BUFFER_SIZE must be a power of two");
+static_assert(TOOTH_LOG_BUFFER_SIZE >= TOOTH_LOG_SIZE,
+              "TOOTH_LOG_BUFFER_SIZE must hold at least one TOOTH_LOG_SIZE packet");
+
+// Order entry contents against the counters (other core / task)
+#if defined(ESP32)
+  #define TOOTH_LOG_BARRIER() __sync_synchronize()
+#else
+  #define TOOTH_LOG_BARRIER() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/**
+ * @brief Composite logger flag bits (Speeduino compositeLogHistory layout)
+ */
+enum CompositeLogBits : uint8_t {
+    COMPOSITE_LOG_PRI = 0x01,       ///< Primary (crank) trigger level
+    COMPOSITE_LOG_SEC = 0x02,       ///< Secondary (cam) trigger level
+    COMPOSITE_LOG_THIRD = 0x04,     ///< Tertiary trigger level (never set)
+    COMPOSITE_LOG_TRIG = 0x08,      ///< Entry is a primary trigger event
+    COMPOSITE_LOG_SYNC = 0x10       ///< Decoder has sync
+};
+
+/**
+ * @struct ToothLogEntry
+ * @brief One logged trigger event
+ */
+struct ToothLogEntry {
+    uint32_t time;      ///< Tooth gap (tooth logger) or timestamp (composite logger), us
+    uint8_t flags;      ///< CompositeLogBits (composite logger only)
+};
+
+/**
+ * @class ToothLog
+ * @brief Allocation-free SPSC ring that overwrites its oldest entries
+ * 
+ * head and tail are free-running entry counters; only the producer writes
+ * head and only the consumer writes tail. Overruns are detected by the
+ * consumer from the distance between the two.
+ * 
+ * Counters are 32-bit; on AVR both sides must run in the main loop (not in
+ * an ISR), as they do here.
+ */
+class ToothLog {
+private:
+    static const uint16_t MASK = TOOTH_LOG_BUFFER_SIZE - 1;
+    
+    ToothLogEntry entries[TOOTH_LOG_BUFFER_SIZE];
+    volatile uint32_t head;     // Entries ever pushed (producer)
+    volatile uint32_t claimed;  // head + 1 while an entry is being written (producer)
+    volatile uint32_t tail;     // Entries ever consumed or dropped (consumer)
+    uint32_t skipped;           // Entries the producer never wrote (producer)
+    uint32_t overrun;           // Entries overwritten before being read (consumer)
+    
+public:
+    ToothLog() : head(0), claimed(0), tail(0), skipped(0), overrun(0) {
+        memset(entries, 0, sizeof(entries));
+    }
+    
+    // ---- Producer side ----
+    
+    /**
+     * @brief Append an entry, overwriting the oldest one when full
+     */
+    void push(uint32_t time, uint8_t flags) {
+        uint32_t next = head + 1;
+        claimed = next;
+        TOOTH_LOG_BARRIER();
+        ToothLogEntry& entry = entries[head & MASK];
+        entry.time = time;
+        entry.flags = flags;
+        TOOTH_LOG_BARRIER();
+        head = next;
+    }
+    
+    /**
+     * @brief Account for entries that were due but not generated
+     * @param count Number of entries given up
+     */
+    void skip(uint32_t count) { skipped += count; }
+    
+    // ---- Consumer side ----
+    
+    /**
+     * @brief Number of entries ready to read
+     * 
+     * Safe to call from the producer as well (read-only).
+     */
+    uint16_t available() const {
+        uint32_t pending = head - tail;
+        return (pending > TOOTH_LOG_BUFFER_SIZE) ? TOOTH_LOG_BUFFER_SIZE : pending;
+    }
+    
+    /**
+     * @brief Copy out the oldest entries
+     * 
+     * Entries the producer lapped while they were being copied are dropped
+     * rather than returned torn.
+     * 
+     * @param out Destination
+     * @param max Maximum number of entries
+     * @return Number of entries copied
+     */
+    uint16_t read(ToothLogEntry* out, uint16_t max) {
+        dropOverwritten();
+        uint32_t start = tail;
+        uint32_t pending = head - start;
+        uint16_t count = (pending < max) ? pending : max;
+        TOOTH_LOG_BARRIER();
+        
+        for (uint16_t i = 0; i < count; i++) {
+            out[i] = entries[(start + i) & MASK];
+        }
+        
+        TOOTH_LOG_BARRIER();
+        tail = start + count;
+        
+        // Entries older than claimed - N were (or are being) overwritten
+        // while we copied them
+        int32_t stale = (int32_t)(claimed - TOOTH_LOG_BUFFER_SIZE - start);
+        uint16_t lost = (stale <= 0) ? 0 : (stale >= count) ? count : stale;
+        if (lost > 0) {
+            overrun += lost;
+            memmove(out, out + lost, (count - lost) * sizeof(ToothLogEntry));
+        }
+        return count - lost;
+    }
+    
+    /**
+     * @brief Discard everything logged so far
+     */
+    void clear() { tail = head; }
+    
+    /**
+     * @brief Get number of entries lost to overload
+     * @return Entries overwritten unread plus entries never generated
+     */
+    uint32_t getDropped() const { return overrun + skipped; }
+    
+    /**
+     * @brief Get number of entries ever pushed
+     */
+    uint32_t getPushed() const { return head; }
+    
+private:
+    // Advance tail past entries the producer has already overwritten
+    void dropOverwritten() {
+        uint32_t behind = head - tail;
+        if (behind > TOOTH_LOG_BUFFER_SIZE) {
+            tail = tail + (behind - TOOTH_LOG_BUFFER_SIZE);
+            overrun += behind - TOOTH_LOG_BUFFER_SIZE;
+        }
+    }
+};
+
+#endif // TOOTH_LOG_H
@@ -92,6 +92,7 @@ private:
     void handleSetMode(AsyncWebServerRequest* request);
     void handleRealtimeData(AsyncWebServerRequest* request);
     void handleStatistics(AsyncWebServerRequest* request);
+    void handleLatency(AsyncWebServerRequest* request);
     void handleNotFound(AsyncWebServerRequest* request);
     
     // HTML pages
@@ -102,6 +103,7 @@ private:
     String getStatusJSON();
     String getRealtimeJSON();
     String getStatisticsJSON();
+    String getLatencyJSON();
 };
 
 #endif // ENABLE_WEB_INTERFACE
@@ -4,28 +4,140 @@
  */
 
 #include "EngineSimulator.h"
+#include "PgmSpace.h"
+#include "FixedPoint.h"
 #include <string.h>
 
+// Make snapshot contents visible before the index swap (other core / task)
+#if defined(ESP32)
+  #define PUBLISH_BARRIER() __sync_synchronize()
+#else
+  #define PUBLISH_BARRIER() __asm__ __volatile__("" ::: "memory")
+#endif
+
+// Stage schedule: how often each stage runs, in simulated ms rounded up to
+// whole SIM_STEP_MS steps (with 50 ms steps on AVR everything runs at
+// 20Hz). The driver and the crank are followed closely; temperatures,
+// voltage and CAN filler change on a seconds scale.
+#define STAGE_STEPS(ms) (((ms) + SIM_STEP_MS - 1) / SIM_STEP_MS)
+
+static const uint16_t STAGE_SCHEDULE[] PROGMEM = {
+    STAGE_STEPS(50),    // STAGE_MODE           20Hz
+    STAGE_STEPS(2),     // STAGE_RPM           500Hz
+    STAGE_STEPS(2),     // STAGE_TRIGGER       500Hz
+    STAGE_STEPS(100),   // STAGE_THERMAL        10Hz
+    STAGE_STEPS(10),    // STAGE_THROTTLE      100Hz
+    STAGE_STEPS(2),     // STAGE_MAP           500Hz
+    STAGE_STEPS(10),    // STAGE_FUEL          100Hz
+    STAGE_STEPS(10),    // STAGE_IGNITION      100Hz
+    STAGE_STEPS(20),    // STAGE_AFR            50Hz
+    STAGE_STEPS(50),    // STAGE_CORRECTIONS    20Hz
+    STAGE_STEPS(50),    // STAGE_SENSORS        20Hz
+    STAGE_STEPS(100),   // STAGE_VOLTAGE        10Hz
+    STAGE_STEPS(100),   // STAGE_CAN            10Hz
+    STAGE_STEPS(50),    // STAGE_EXTENDED       20Hz
+};
+
+static_assert(sizeof(STAGE_SCHEDULE) / sizeof(STAGE_SCHEDULE[0]) == STAGE_COUNT,
+              "STAGE_SCHEDULE needs one period per SimStage");
+static_assert(UPDATE_INTERVAL_MS % SIM_STEP_MS == 0, "A tick must be a whole number of steps");
+
+// Default tune: 2.0L I4 on a 16x16 RPM x MAP grid (Speeduino table layout).
+// VE peaks around the 4500-5000 RPM torque peak; spark comes in with RPM and
+// is pulled back as load rises.
+static const Table3DData VE_TABLE PROGMEM = {
+    {
+        {  30,  30,  33,  37,  40,  43,  47,  50,  52,  55,  56,  56,  55,  53,  51,  48 },   //  20 kPa
+        {  30,  30,  35,  39,  42,  45,  49,  52,  55,  57,  59,  59,  57,  55,  53,  50 },   //  26 kPa
+        {  30,  31,  36,  40,  44,  46,  51,  54,  57,  60,  61,  61,  60,  58,  55,  52 },   //  32 kPa
+        {  30,  32,  37,  42,  45,  48,  53,  56,  59,  62,  63,  63,  62,  60,  57,  54 },   //  38 kPa
+        {  31,  34,  39,  43,  47,  50,  55,  58,  61,  64,  66,  66,  64,  62,  59,  56 },   //  44 kPa
+        {  33,  35,  40,  45,  49,  52,  57,  60,  64,  67,  68,  68,  67,  64,  61,  58 },   //  50 kPa
+        {  34,  36,  42,  47,  51,  54,  59,  63,  66,  69,  71,  71,  69,  67,  63,  60 },   //  56 kPa
+        {  35,  37,  43,  48,  52,  56,  61,  65,  68,  71,  73,  73,  71,  69,  65,  62 },   //  62 kPa
+        {  36,  39,  45,  50,  54,  57,  62,  67,  70,  74,  75,  75,  74,  71,  68,  64 },   //  68 kPa
+        {  37,  40,  46,  51,  56,  59,  64,  69,  72,  76,  78,  78,  76,  73,  70,  66 },   //  74 kPa
+        {  38,  41,  47,  53,  57,  61,  66,  71,  75,  78,  80,  80,  78,  76,  72,  68 },   //  80 kPa
+        {  39,  42,  49,  54,  59,  63,  68,  73,  77,  81,  82,  82,  81,  78,  74,  70 },   //  86 kPa
+        {  40,  43,  50,  56,  61,  65,  70,  75,  79,  83,  85,  85,  83,  80,  76,  72 },   //  92 kPa
+        {  42,  45,  52,  57,  62,  66,  72,  77,  81,  85,  87,  87,  85,  82,  78,  74 },   //  98 kPa
+        {  43,  46,  53,  59,  64,  68,  74,  79,  83,  88,  90,  90,  88,  84,  80,  76 },   // 104 kPa
+        {  44,  47,  54,  61,  66,  70,  76,  82,  86,  90,  92,  92,  90,  87,  83,  78 },   // 110 kPa
+    },
+    { 500, 800, 1100, 1400, 1700, 2000, 2500, 3000, 3500, 4000, 4500, 5000, 5500, 6000, 6500, 7000 },
+    { 20, 26, 32, 38, 44, 50, 56, 62, 68, 74, 80, 86, 92, 98, 104, 110 },
+};
+
+static const Table3DData SPARK_TABLE PROGMEM = {
+    {
+        {  14,  18,  22,  25,  28,  31,  34,  35,  35,  35,  35,  35,  35,  35,  35,  35 },   //  20 kPa
+        {  13,  17,  21,  24,  27,  30,  33,  35,  35,  35,  35,  35,  35,  35,  35,  35 },   //  26 kPa
+        {  12,  16,  20,  23,  26,  29,  32,  34,  35,  35,  35,  35,  35,  35,  35,  35 },   //  32 kPa
+        {  10,  14,  18,  21,  24,  27,  30,  32,  34,  35,  35,  35,  35,  35,  35,  35 },   //  38 kPa
+        {   9,  13,  17,  20,  23,  26,  29,  31,  33,  34,  35,  35,  35,  35,  35,  35 },   //  44 kPa
+        {   8,  12,  16,  19,  22,  25,  28,  30,  32,  33,  34,  34,  34,  34,  34,  34 },   //  50 kPa
+        {   7,  11,  15,  18,  21,  24,  27,  29,  31,  32,  33,  33,  33,  33,  33,  33 },   //  56 kPa
+        {   6,  10,  14,  17,  20,  23,  26,  28,  30,  31,  32,  32,  32,  32,  32,  32 },   //  62 kPa
+        {   5,   8,  12,  15,  18,  21,  24,  26,  28,  29,  30,  30,  30,  30,  30,  30 },   //  68 kPa
+        {   5,   7,  11,  14,  17,  20,  23,  25,  27,  28,  29,  29,  29,  29,  29,  29 },   //  74 kPa
+        {   5,   6,  10,  13,  16,  19,  22,  24,  26,  27,  28,  28,  28,  28,  28,  28 },   //  80 kPa
+        {   5,   5,   9,  12,  15,  18,  21,  23,  25,  26,  27,  27,  27,  27,  27,  27 },   //  86 kPa
+        {   5,   5,   8,  11,  14,  17,  20,  22,  24,  25,  26,  26,  26,  26,  26,  26 },   //  92 kPa
+        {   5,   5,   6,   9,  12,  15,  18,  20,  22,  23,  24,  24,  24,  24,  24,  24 },   //  98 kPa
+        {   5,   5,   5,   8,  11,  14,  17,  19,  21,  22,  23,  23,  23,  23,  23,  23 },   // 104 kPa
+        {   5,   5,   5,   7,  10,  13,  16,  18,  20,  21,  22,  22,  22,  22,  22,  22 },   // 110 kPa
+    },
+    { 500, 800, 1100, 1400, 1700, 2000, 2500, 3000, 3500, 4000, 4500, 5000, 5500, 6000, 6500, 7000 },
+    { 20, 26, 32, 38, 44, 50, 56, 62, 68, 74, 80, 86, 92, 98, 104, 110 },
+};
+
 EngineSimulator::EngineSimulator(ITimeProvider* timeProvider, IRandomProvider* randomProvider)
     : timeProvider(timeProvider)
     , randomProvider(randomProvider)
+#if FAST_RANDOM && SENSOR_NOISE_ENABLED
+    , noiseIndex(NOISE_POOL_SIZE)
+#endif
+    , publishedIndex(0)
+    , generation(0)
     , currentMode(EngineMode::STARTUP)
-    , lastUpdateTime(0)
+    , simulatedTime(0)
+    , stepTime(0)
+    , stepsToTick(UPDATE_INTERVAL_MS / SIM_STEP_MS)
     , stateStartTime(0)
     , engineStartTime(0)
     , targetRPM(0)
     , currentRPM(0)
     , rpmAcceleration(0)
+    , rpmFraction(0)
     , targetThrottle(0)
     , currentThrottle(0)
+    , lastThrottle(0)
     , coolantTemp(TEMP_AMBIENT)
     , intakeTemp(TEMP_AMBIENT)
     , exhaustTemp(TEMP_AMBIENT)
     , pulseWidth(0)
     , injectorDutyCycle(0)
+    , veTable(&VE_TABLE)
+    , sparkTable(&SPARK_TABLE)
     , loopCounter(0)
+    , tickCounter(0)
     , secondCounter(0)
+    , catchUpSteps(0)
+    , skippedSteps(0)
+    , clampedUpdates(0)
+    , toothLogMode(ToothLogMode::OFF)
+    , triggerRunning(false)
+    , triggerSync(false)
+    , camPhase(false)
+    , toothIndex(0)
+    , nextToothTime(0)
+    , lastToothTime(0)
 {
+    memset(snapshots, 0, sizeof(snapshots));
+    #if OUTPUT_LAYOUT_EXTENDED
+        memset(&extra, 0, sizeof(extra));
+    #endif
+    
     // Seed random number generator with a varying value
     randomProvider->seed(timeProvider->millis());
 }
@@ -40,7 +152,9 @@ void EngineSimulator::initialize() {
     // Initialize to cold engine state
     currentMode = EngineMode::STARTUP;
     engineStartTime = timeProvider->millis();
-    lastUpdateTime = engineStartTime;
+    simulatedTime = engineStartTime;
+    stepTime = engineStartTime;
+    stepsToTick = UPDATE_INTERVAL_MS / SIM_STEP_MS;
     stateStartTime = engineStartTime;
     
     // Cold start conditions
@@ -49,8 +163,10 @@ void EngineSimulator::initialize() {
     coolantTemp = TEMP_AMBIENT;      // 20°C
     intakeTemp = TEMP_AMBIENT;
     exhaustTemp = TEMP_AMBIENT;
+    rpmFraction = 0;
     currentThrottle = TPS_IDLE;
     targetThrottle = TPS_IDLE;
+    lastThrottle = TPS_IDLE;
     
     // Initial sensor values
     status.setRPM(currentRPM);
@@ -62,65 +178,138 @@ void EngineSimulator::initialize() {
     status.tps = currentThrottle;
     
     loopCounter = 0;
+    tickCounter = 0;
     secondCounter = 0;
+    catchUpSteps = 0;
+    skippedSteps = 0;
+    clampedUpdates = 0;
+    
+    #if FAST_RANDOM
+        // Seed from the provider: a seeded provider gives a reproducible run
+        rng.seed(((uint32_t)randomProvider->random(0x10000) << 16) | (uint32_t)randomProvider->random(0x10000));
+        #if SENSOR_NOISE_ENABLED
+            noiseIndex = NOISE_POOL_SIZE;
+        #endif
+    #endif
+    
+    publishSnapshot();
 }
 
 bool EngineSimulator::update() {
-    uint32_t currentTime = timeProvider->millis();
-    uint32_t deltaTime = currentTime - lastUpdateTime;
+    uint32_t elapsed = timeProvider->millis() - simulatedTime;
+    
+    // Fixed steps of SIM_STEP_MS; the remainder stays accumulated in
+    // simulatedTime for the next call
+    if (elapsed < SIM_STEP_MS) {
+        return false;
+    }
+    uint32_t steps = elapsed / SIM_STEP_MS;
+    simulatedTime += steps * SIM_STEP_MS;
+    
+    // After a long stall only the last UPDATE_MAX_STEPS are simulated, so
+    // one call never runs away; the rest is lost and counted
+    if (steps > UPDATE_MAX_STEPS) {
+        uint32_t dropped = steps - UPDATE_MAX_STEPS;
+        skippedSteps += dropped;
+        clampedUpdates++;
+        steps = UPDATE_MAX_STEPS;
+        
+        // The engine (stepTime) pauses over the dropped time; the teeth it
+        // would have logged count as dropped
+        if (toothLogMode != ToothLogMode::OFF) {
+            uint32_t droppedMs = dropped * SIM_STEP_MS;
+            uint32_t revolutions = (droppedMs / 60000) * currentRPM + (droppedMs % 60000) * currentRPM / 60000;
+            toothLog.skip(revolutions * (TRIGGER_TEETH - TRIGGER_MISSING_TEETH));
+        }
+    }
+    catchUpSteps += steps - 1;
     
-    // Update at configured interval (default 50ms = 20Hz)
-    if (deltaTime < UPDATE_INTERVAL_MS) {
+    // One snapshot for all ticks completed in this call
+    bool tick = false;
+    while (steps-- > 0) {
+        tick |= step();
+    }
+    if (!tick) {
         return false;
     }
+    publishSnapshot();
     
-    lastUpdateTime = currentTime;
+    return true;
+}
+
+bool EngineSimulator::step() {
     loopCounter++;
+    stepTime += SIM_STEP_MS;
     
     // Update second counter
-    if (loopCounter % 20 == 0) {  // Every second at 20Hz
+    if (loopCounter % (1000 / SIM_STEP_MS) == 0) {
         secondCounter++;
         status.secl = secondCounter & 0xFF;  // Wrap at 256
     }
     
-    // Update state machine
-    updateStateMachine();
-    
-    // Simulate all engine parameters in realistic order
-    simulateRPM();          // Engine speed drives everything
-    simulateThermal();      // Temperature affects fuel/timing
-    simulateThrottle();     // Throttle position
-    simulateMAP();          // Manifold pressure from RPM & throttle
-    simulateFuel();         // Fuel delivery based on MAP, RPM, temp
-    simulateIgnition();     // Timing based on RPM & load
-    simulateAFR();          // Air-fuel ratio and O2 sensors
-    simulateCorrections();  // Fuel/timing corrections
-    simulateSensors();      // Additional sensors
-    simulateVoltage();      // Battery voltage
-    simulateCANData();      // CAN bus data
-    
-    // Update counters and status
-    uint16_t loops = loopCounter & 0xFFFF;
+    // Stages due in this step, in realistic order (speed drives everything)
+    for (uint8_t stage = 0; stage < STAGE_COUNT; stage++) {
+        if (loopCounter % pgm_read_word(&STAGE_SCHEDULE[stage]) == 0) {
+            runStage(stage);
+        }
+    }
+    
+    if (--stepsToTick > 0) {
+        return false;
+    }
+    stepsToTick = UPDATE_INTERVAL_MS / SIM_STEP_MS;
+    
+    // 'loops' counts 20 Hz ticks, not steps, so clients see the same rate
+    tickCounter++;
+    uint16_t loops = tickCounter & 0xFFFF;
     status.loopslo = loops & 0xFF;
     status.loopshi = (loops >> 8) & 0xFF;
-    
-    // Simulate free RAM (more on ESP32, less on AVR)
-    #ifdef ARDUINO_AVR
-        status.freeramlo = 512 & 0xFF;
-        status.freeramhi = (512 >> 8) & 0xFF;
-    #else
-        status.freeramlo = 8192 & 0xFF;
-        status.freeramhi = (8192 >> 8) & 0xFF;
+    return true;
+}
+
+void EngineSimulator::runStage(uint8_t stage) {
+    switch (stage) {
+        case STAGE_MODE:        updateStateMachine(); break;
+        case STAGE_RPM:         simulateRPM(); break;
+        case STAGE_TRIGGER:     simulateTrigger(); break;
+        case STAGE_THERMAL:     simulateThermal(); break;
+        case STAGE_THROTTLE:    simulateThrottle(); break;
+        case STAGE_MAP:         simulateMAP(); break;
+        case STAGE_FUEL:        simulateFuel(); break;
+        case STAGE_IGNITION:    simulateIgnition(); break;
+        case STAGE_AFR:         simulateAFR(); break;
+        case STAGE_CORRECTIONS: simulateCorrections(); break;
+        case STAGE_SENSORS:     simulateSensors(); break;
+        case STAGE_VOLTAGE:     simulateVoltage(); break;
+        case STAGE_CAN:         simulateCANData(); break;
+        case STAGE_EXTENDED:    simulateExtendedChannels(); break;
+        default: break;
+    }
+}
+
+uint16_t EngineSimulator::getStagePeriodMs(SimStage stage) {
+    if (stage >= STAGE_COUNT) {
+        return 0;
+    }
+    return pgm_read_word(&STAGE_SCHEDULE[stage]) * SIM_STEP_MS;
+}
+
+void EngineSimulator::publishSnapshot() {
+    // Fill the buffer after the published one; readers only ever see
+    // snapshots[publishedIndex], which is complete before the swap
+    uint8_t next = (publishedIndex + 1) % SNAPSHOT_BUFFER_COUNT;
+    snapshots[next].status = status;
+    snapshots[next].generation = ++generation;
+    #if OUTPUT_LAYOUT_EXTENDED
+        buildExtendedStatus(snapshots[next].extended, status, extra);
     #endif
     
-    // Random error code (mostly no errors)
-    status.errors = randomProvider->random(100) < 2 ? randomProvider->random(1, 4) : 0;
-    
-    return true;
+    PUBLISH_BARRIER();
+    publishedIndex = next;
 }
 
 void EngineSimulator::updateStateMachine() {
-    uint32_t timeInState = timeProvider->millis() - stateStartTime;
+    uint32_t timeInState = stepTime - stateStartTime;
     
     switch (currentMode) {
         case EngineMode::STARTUP:
@@ -131,18 +320,18 @@ void EngineSimulator::updateStateMachine() {
                 }
             }
             break;
-            
+        
         case EngineMode::WARMUP_IDLE:
             // Warm up until coolant reaches 60°C (takes ~30s)
             if (coolantTemp > 600) {  // 60°C
                 transitionToMode(EngineMode::IDLE);
             }
             break;
-            
+        
         case EngineMode::IDLE:
             // Randomly transition to other modes
             if (timeInState > STATE_TRANSITION_MS) {
-                int rand = randomProvider->random(100);
+                int rand = nextRandom(100);
                 if (rand < 30) {
                     transitionToMode(EngineMode::LIGHT_LOAD);
                 } else if (rand < 35) {
@@ -150,10 +339,10 @@ void EngineSimulator::updateStateMachine() {
                 }
             }
             break;
-            
+        
         case EngineMode::LIGHT_LOAD:
             if (timeInState > STATE_TRANSITION_MS) {
-                int rand = randomProvider->random(100);
+                int rand = nextRandom(100);
                 if (rand < 40) {
                     transitionToMode(EngineMode::ACCELERATION);
                 } else if (rand < 70) {
@@ -163,27 +352,27 @@ void EngineSimulator::updateStateMachine() {
                 }
             }
             break;
-            
+        
         case EngineMode::ACCELERATION:
             if (currentRPM > RPM_HIGH_START) {
                 transitionToMode(EngineMode::HIGH_RPM);
-            } else if (timeInState > 3000 && randomProvider->random(100) < 30) {
+            } else if (timeInState > 3000 && nextRandom(100) < 30) {
                 transitionToMode(EngineMode::LIGHT_LOAD);
             }
             break;
-            
+        
         case EngineMode::HIGH_RPM:
             if (timeInState > 2000) {
                 transitionToMode(EngineMode::DECELERATION);
             }
             break;
-            
+        
         case EngineMode::DECELERATION:
             if (currentRPM < RPM_IDLE_MAX + 200) {
                 transitionToMode(EngineMode::IDLE);
             }
             break;
-            
+        
         case EngineMode::WOT:
             if (timeInState > 3000 || currentRPM > RPM_REDLINE) {
                 transitionToMode(EngineMode::HIGH_RPM);
@@ -194,7 +383,7 @@ void EngineSimulator::updateStateMachine() {
 
 void EngineSimulator::transitionToMode(EngineMode newMode) {
     currentMode = newMode;
-    stateStartTime = timeProvider->millis();
+    stateStartTime = stepTime;
     
     // Set target values based on new mode
     switch (newMode) {
@@ -203,43 +392,43 @@ void EngineSimulator::transitionToMode(EngineMode newMode) {
             targetThrottle = TPS_IDLE + 5;
             rpmAcceleration = 500;  // RPM/s
             break;
-            
+        
         case EngineMode::WARMUP_IDLE:
             targetRPM = RPM_IDLE_MIN + 150;
             targetThrottle = TPS_IDLE + 3;
             rpmAcceleration = 100;
             break;
-            
+        
         case EngineMode::IDLE:
-            targetRPM = RPM_IDLE_MIN + randomProvider->random(-50, 50);
+            targetRPM = RPM_IDLE_MIN + nextRandom(-50, 50);
             targetThrottle = TPS_IDLE;
             rpmAcceleration = 50;
             break;
-            
+        
         case EngineMode::LIGHT_LOAD:
-            targetRPM = RPM_CRUISE + randomProvider->random(-300, 300);
-            targetThrottle = TPS_CRUISE + randomProvider->random(-5, 10);
+            targetRPM = RPM_CRUISE + nextRandom(-300, 300);
+            targetThrottle = TPS_CRUISE + nextRandom(-5, 10);
             rpmAcceleration = 200;
             break;
-            
+        
         case EngineMode::ACCELERATION:
-            targetRPM = RPM_HIGH_START + randomProvider->random(-500, 500);
-            targetThrottle = TPS_HALF + randomProvider->random(10, 40);
+            targetRPM = RPM_HIGH_START + nextRandom(-500, 500);
+            targetThrottle = TPS_HALF + nextRandom(10, 40);
             rpmAcceleration = 1000;  // Fast acceleration
             break;
-            
+        
         case EngineMode::HIGH_RPM:
-            targetRPM = RPM_REDLINE - randomProvider->random(100, 500);
-            targetThrottle = TPS_WOT - randomProvider->random(0, 20);
+            targetRPM = RPM_REDLINE - nextRandom(100, 500);
+            targetThrottle = TPS_WOT - nextRandom(0, 20);
             rpmAcceleration = 500;
             break;
-            
+        
         case EngineMode::DECELERATION:
-            targetRPM = RPM_IDLE_MAX + randomProvider->random(0, 500);
+            targetRPM = RPM_IDLE_MAX + nextRandom(0, 500);
             targetThrottle = TPS_IDLE;
             rpmAcceleration = -800;  // Fast deceleration
             break;
-            
+        
         case EngineMode::WOT:
             targetRPM = RPM_REDLINE;
             targetThrottle = TPS_WOT;
@@ -249,30 +438,82 @@ void EngineSimulator::transitionToMode(EngineMode newMode) {
 }
 
 void EngineSimulator::simulateRPM() {
-    // Smooth interpolation toward target RPM
-    if (currentRPM < targetRPM) {
-        int16_t delta = (rpmAcceleration * UPDATE_INTERVAL_MS) / 1000;
-        currentRPM += delta;
-        if (currentRPM > targetRPM) currentRPM = targetRPM;
-    } else if (currentRPM > targetRPM) {
-        int16_t delta = (rpmAcceleration * UPDATE_INTERVAL_MS) / 1000;
-        currentRPM += delta;  // rpmAcceleration is negative
-        if (currentRPM < targetRPM) currentRPM = targetRPM;
+    // Smooth interpolation toward target RPM; at short stage periods a step
+    // is a fraction of an RPM, which carries over in rpmFraction
+    if (currentRPM != targetRPM) {
+        int32_t change = (int32_t)rpmAcceleration * getStagePeriodMs(STAGE_RPM) + rpmFraction;
+        int16_t delta = change / 1000;
+        rpmFraction = change - (int32_t)delta * 1000;
+        
+        if (currentRPM < targetRPM) {
+            currentRPM += delta;
+            if (currentRPM > targetRPM) currentRPM = targetRPM;
+        } else {
+            currentRPM += delta;  // rpmAcceleration is negative
+            if (currentRPM < targetRPM) currentRPM = targetRPM;
+        }
     }
     
     // Clamp to valid range
     if ((int16_t)currentRPM < RPM_MIN) currentRPM = RPM_MIN;
     if (currentRPM > RPM_MAX) currentRPM = RPM_MAX;
     
-    // Add realistic idle fluctuation
-    if (currentMode == EngineMode::IDLE || currentMode == EngineMode::WARMUP_IDLE) {
-        currentRPM += randomProvider->random(-10, 10);
+    // Add realistic idle fluctuation (once per tick at any stage period)
+    if ((currentMode == EngineMode::IDLE || currentMode == EngineMode::WARMUP_IDLE) && stepsToTick == 1) {
+        currentRPM += nextRandom(-10, 10);
     }
     
     status.setRPM(currentRPM);
     status.setRPMDot(rpmAcceleration);
 }
 
+void EngineSimulator::simulateTrigger() {
+    if (toothLogMode == ToothLogMode::OFF) {
+        return;
+    }
+    
+    uint32_t now = stepTime * 1000UL;  // Wraps consistently with the step increments
+    if (currentRPM == 0) {
+        triggerRunning = false;
+        triggerSync = false;
+        return;
+    }
+    
+    // 36-1 crank wheel: even tooth gaps, the missing tooth stretches one gap
+    // per revolution; the cam edge comes once per two revolutions
+    uint32_t gap = 60000000UL / ((uint32_t)currentRPM * TRIGGER_TEETH);
+    
+    if (!triggerRunning) {
+        triggerRunning = true;
+        nextToothTime = now;
+        lastToothTime = now - gap;
+    }
+    
+    while ((int32_t)(now - nextToothTime) >= 0) {
+        uint32_t toothTime = nextToothTime;
+        
+        if (toothLogMode == ToothLogMode::TOOTH) {
+            toothLog.push(toothTime - lastToothTime, 0);
+        } else {
+            uint8_t sync = triggerSync ? COMPOSITE_LOG_SYNC : 0;
+            toothLog.push(toothTime, COMPOSITE_LOG_PRI | COMPOSITE_LOG_TRIG | sync);
+            if (toothIndex == 0 && camPhase) {
+                toothLog.push(toothTime + gap / 2, COMPOSITE_LOG_SEC | sync);
+            }
+        }
+        
+        lastToothTime = toothTime;
+        if (++toothIndex < TRIGGER_TEETH - TRIGGER_MISSING_TEETH) {
+            nextToothTime += gap;
+        } else {
+            nextToothTime += gap * (TRIGGER_MISSING_TEETH + 1);
+            toothIndex = 0;
+            triggerSync = true;  // The tooth after the gap is recognized
+            camPhase = !camPhase;
+        }
+    }
+}
+
 void EngineSimulator::simulateThermal() {
     int16_t targetCoolantTemp = TEMP_ENGINE_WARM;
     
@@ -283,8 +524,8 @@ void EngineSimulator::simulateThermal() {
     }
     
     // Gradual warmup (thermal inertia)
-    coolantTemp = interpolate(coolantTemp, targetCoolantTemp, 5);  // Slow change
-    status.setCoolantTemp(coolantTemp / 10);
+    coolantTemp = interpolate(coolantTemp, targetCoolantTemp, 5, STAGE_THERMAL);  // Slow change
+    status.setCoolantTemp(fpDiv10Signed(coolantTemp));
     
     // Intake air temperature affected by engine bay heat and airflow
     int16_t targetIntakeTemp = TEMP_AMBIENT + (coolantTemp - TEMP_AMBIENT) / 4;
@@ -292,13 +533,13 @@ void EngineSimulator::simulateThermal() {
         // More airflow = cooler intake
         targetIntakeTemp -= (currentRPM - RPM_CRUISE) / 50;
     }
-    intakeTemp = interpolate(intakeTemp, targetIntakeTemp, 10);
-    status.setIntakeTemp(intakeTemp / 10);
+    intakeTemp = interpolate(intakeTemp, targetIntakeTemp, 10, STAGE_THERMAL);
+    status.setIntakeTemp(fpDiv10Signed(intakeTemp));
 }
 
 void EngineSimulator::simulateThrottle() {
     // Smooth throttle response
-    currentThrottle = interpolate(currentThrottle, targetThrottle, 20);
+    currentThrottle = interpolate(currentThrottle, targetThrottle, 20, STAGE_THROTTLE);
     
     // Add realistic sensor noise
     int8_t noisyThrottle = currentThrottle + addNoise(0, 1);
@@ -306,13 +547,13 @@ void EngineSimulator::simulateThrottle() {
     if (noisyThrottle > 100) noisyThrottle = 100;
     
     status.tps = noisyThrottle;
-    status.tpsadc = (noisyThrottle * 255) / 100;  // Scale to ADC range
+    status.tpsadc = fpDiv100(noisyThrottle * 255);  // Scale to ADC range
     
-    // TPS rate of change
-    static uint8_t lastTPS = 0;
-    int16_t tpsDelta = status.tps - lastTPS;
-    status.tpsdot = tpsDelta * (1000 / UPDATE_INTERVAL_MS);  // Convert to %/s
-    lastTPS = status.tps;
+    // TPS rate of change in %/s (opening only), from the filtered position:
+    // sensor noise over a short stage period would read as a huge rate
+    int16_t tpsDot = ((int16_t)currentThrottle - lastThrottle) * (1000 / getStagePeriodMs(STAGE_THROTTLE));
+    status.tpsdot = (tpsDot < 0) ? 0 : (tpsDot > 255) ? 255 : tpsDot;
+    lastThrottle = currentThrottle;
 }
 
 void EngineSimulator::simulateMAP() {
@@ -328,7 +569,7 @@ void EngineSimulator::simulateMAP() {
         baseMAP = MAP_IDLE + (currentRPM - RPM_IDLE_MIN) / 20;
     } else if (currentThrottle > 80) {
         // WOT: near atmospheric
-        baseMAP = MAP_WOT - (RPM_MAX - currentRPM) / 100;
+        baseMAP = MAP_WOT - fpDiv100(RPM_MAX - currentRPM);
     } else {
         // Proportional to throttle
         baseMAP = mapValue(currentThrottle, 10, 80, MAP_IDLE + 10, MAP_WOT - 5);
@@ -336,7 +577,7 @@ void EngineSimulator::simulateMAP() {
     
     // RPM affects pumping efficiency
     if (currentRPM > RPM_HIGH_START) {
-        baseMAP += (currentRPM - RPM_HIGH_START) / 100;
+        baseMAP += fpDiv100(currentRPM - RPM_HIGH_START);
     }
     
     // Add sensor noise
@@ -347,21 +588,21 @@ void EngineSimulator::simulateMAP() {
 }
 
 void EngineSimulator::simulateFuel() {
-    // Calculate volumetric efficiency
-    status.ve = calculateVE(currentRPM, currentThrottle);
+    // Volumetric efficiency from the VE table (speed density: RPM x MAP)
+    uint16_t map = status.getMAP();
+    status.ve = veTable.lookup(currentRPM, map);
     
     // Calculate required pulse width based on MAP, RPM, and VE
-    uint16_t map = status.getMAP();
     pulseWidth = calculateRequiredPulseWidth(currentRPM, map, status.ve);
     
     // Apply warm-up enrichment
     uint8_t wue = getWarmupEnrichment(coolantTemp);
-    pulseWidth = (pulseWidth * wue) / 100;
+    pulseWidth = fpDiv100(pulseWidth * wue);
     status.wue = wue;
     
     // Apply corrections
-    uint16_t correctedPW = (pulseWidth * status.egocorrection) / 100;
-    correctedPW = (correctedPW * status.iatcorrection) / 100;
+    uint16_t correctedPW = fpDiv100(pulseWidth * status.egocorrection);
+    correctedPW = fpDiv100(correctedPW * status.iatcorrection);
     
     // Clamp to valid range
     if (correctedPW < PW_MIN) correctedPW = PW_MIN;
@@ -381,9 +622,8 @@ void EngineSimulator::simulateFuel() {
 }
 
 void EngineSimulator::simulateIgnition() {
-    // Calculate ignition advance based on RPM and load
-    uint8_t load = (status.getMAP() * 100) / MAP_ATMOSPHERIC;
-    status.advance = calculateIgnitionAdvance(currentRPM, load);
+    // Ignition advance from the spark table (RPM x MAP)
+    status.advance = sparkTable.lookup(currentRPM, status.getMAP());
     
     // Dwell time (coil charge time) based on voltage and RPM
     // Typical: 3-4ms at 14V, increases at low voltage
@@ -446,7 +686,7 @@ void EngineSimulator::simulateCorrections() {
     }
     
     // IAT correction: richer when intake air is cold
-    int16_t iatCelsius = intakeTemp / 10;
+    int16_t iatCelsius = fpDiv10Signed(intakeTemp);
     if (iatCelsius < 0) {
         status.iatcorrection = 110;  // 10% enrichment
     } else if (iatCelsius < 10) {
@@ -469,7 +709,7 @@ void EngineSimulator::simulateCorrections() {
     
     // Idle load
     status.idleload = (currentMode == EngineMode::IDLE) ? 
-                      (30 + randomProvider->random(-5, 5)) : 0;
+                      (30 + nextRandom(-5, 5)) : 0;
     
     // Boost (N/A engine, no boost)
     status.boosttarget = 0;
@@ -481,6 +721,9 @@ void EngineSimulator::simulateSensors() {
     status.status1 = 0x00;
     if (currentRPM > 0) status.status1 |= 0x01;  // Engine running
     if (coolantTemp > 500) status.status1 |= 0x02;  // Warm
+    if (toothLogMode != ToothLogMode::OFF && toothLog.available() >= TOOTH_LOG_SIZE) {
+        status.status1 |= 0x40;  // Tooth log ready (BIT_STATUS1_TOOTHLOG1READY)
+    }
     
     status.engine = 0x00;
     if (currentMode == EngineMode::STARTUP) status.engine |= 0x01;  // Cranking
@@ -488,6 +731,18 @@ void EngineSimulator::simulateSensors() {
     
     // Test outputs
     status.testoutputs = 0x00;
+    
+    // Simulate free RAM (more on ESP32, less on AVR)
+    #ifdef ARDUINO_AVR
+        status.freeramlo = 512 & 0xFF;
+        status.freeramhi = (512 >> 8) & 0xFF;
+    #else
+        status.freeramlo = 8192 & 0xFF;
+        status.freeramhi = (8192 >> 8) & 0xFF;
+    #endif
+    
+    // Random error code (mostly no errors)
+    status.errors = nextRandom(100) < 2 ? nextRandom(1, 4) : 0;
 }
 
 void EngineSimulator::simulateVoltage() {
@@ -527,62 +782,49 @@ void EngineSimulator::simulateCANData() {
     
     // Fill remaining with pattern for testing
     for (int i = 8; i < 32; i++) {
-        status.canin[i] = (i * 7 + loopCounter) & 0xFF;
+        status.canin[i] = (i * 7 + tickCounter) & 0xFF;
     }
 }
 
-// Helper functions
-
-uint8_t EngineSimulator::calculateVE(uint16_t rpm, uint8_t tps) {
-    // Volumetric efficiency curve for typical I4 engine
-    // Peak VE around 3500-5000 RPM
-    
-    uint8_t baseVE;
-    
-    if (rpm < 1000) {
-        baseVE = 45;
-    } else if (rpm < 2000) {
-        baseVE = 55 + (rpm - 1000) / 50;
-    } else if (rpm < 4000) {
-        baseVE = 75 + (rpm - 2000) / 100;
-    } else if (rpm < 5500) {
-        baseVE = 85 + (rpm - 4000) / 200;
-    } else {
-        baseVE = 90 - (rpm - 5500) / 100;  // Falls off at high RPM
-    }
-    
-    // Throttle affects VE
-    baseVE = (baseVE * (50 + tps / 2)) / 100;
-    
-    if (baseVE > 100) baseVE = 100;
-    if (baseVE < 30) baseVE = 30;
-    
-    return baseVE;
+void EngineSimulator::simulateExtendedChannels() {
+    #if OUTPUT_LAYOUT_EXTENDED
+        uint16_t map = status.getMAP();
+        
+        // MAP rate from the previous run's load (kPa/s / 10)
+        int16_t mapDot = ((int16_t)map - (int16_t)extra.fuelLoad) * (1000 / getStagePeriodMs(STAGE_EXTENDED)) / 10;
+        if (mapDot > 127) mapDot = 127;
+        if (mapDot < -128) mapDot = -128;
+        extra.mapDot = mapDot;
+        
+        // Batch fired: every injector channel sees the same pulse width
+        extra.pw2 = status.getPulseWidth();
+        extra.pw3 = extra.pw2;
+        extra.pw4 = extra.pw2;
+        
+        extra.fuelLoad = map;
+        extra.ignLoad = map;
+        extra.dwellActual = status.dwell;
+        extra.ve1 = status.ve;
+        extra.advance1 = status.advance;
+        extra.idleTarget = targetRPM / 10;
+        extra.baroCorrection = 100;
+        extra.aseValue = (currentMode == EngineMode::STARTUP) ? 125 : 100;
+        
+        // Same simplified road speed as the CAN data, rough gear from speed
+        extra.vss = currentRPM / 100;
+        extra.gear = (currentMode == EngineMode::IDLE || currentMode == EngineMode::WARMUP_IDLE ||
+                      currentMode == EngineMode::STARTUP) ? 0 : 1 + extra.vss / 15;
+        if (extra.gear > 6) extra.gear = 6;
+        
+        extra.fuelPressure = 43;    // 3 bar regulator
+        extra.oilPressure = (currentRPM > 0) ? 15 + currentRPM / 100 : 0;
+        extra.fuelTemp = status.iat;
+        extra.fuelTempCorrection = 100;
+        extra.fanDuty = (coolantTemp > TEMP_ENGINE_HOT) ? 100 : 0;
+    #endif
 }
 
-uint8_t EngineSimulator::calculateIgnitionAdvance(uint16_t rpm, uint8_t load) {
-    // Ignition timing map: more advance at higher RPM and lower load
-    
-    uint8_t baseAdvance = TIMING_IDLE;
-    
-    if (rpm > 1000) {
-        baseAdvance += (rpm - 1000) / 200;
-    }
-    
-    // Reduce advance at high load (prevent knock)
-    if (load > 80) {
-        baseAdvance -= (load - 80) / 4;
-    } else if (load < 40) {
-        // More advance at light load
-        baseAdvance += (40 - load) / 8;
-    }
-    
-    // Clamp to safe range
-    if (baseAdvance > TIMING_MAX) baseAdvance = TIMING_MAX;
-    if (baseAdvance < 5) baseAdvance = 5;
-    
-    return baseAdvance;
-}
+// Helper functions
 
 uint16_t EngineSimulator::calculateRequiredPulseWidth(uint16_t rpm, uint16_t map, uint8_t ve) {
     // Simplified fuel calculation
@@ -590,8 +832,9 @@ uint16_t EngineSimulator::calculateRequiredPulseWidth(uint16_t rpm, uint16_t map
     
     // Base pulse width proportional to MAP and VE, inversely to RPM
     uint32_t pw = (uint32_t)map * ve * 1000;
-    pw = pw / (rpm + 1);  // Avoid division by zero
-    pw = pw / 10;  // Scale factor
+    
+    // pw / (rpm + 1) / 10 as one division (+ 1 avoids division by zero)
+    pw = pw / (((uint32_t)rpm + 1) * 10);
     
     // Clamp to reasonable range
     if (pw < PW_MIN) pw = PW_MIN;
@@ -602,7 +845,7 @@ uint16_t EngineSimulator::calculateRequiredPulseWidth(uint16_t rpm, uint16_t map
 
 uint8_t EngineSimulator::getWarmupEnrichment(int16_t coolantTemp) {
     // Warmer engine needs less enrichment
-    int16_t tempC = coolantTemp / 10;
+    int16_t tempC = fpDiv10Signed(coolantTemp);
     
     if (tempC < 0) return 140;      // 40% enrichment when very cold
     if (tempC < 20) return 130;     // 30% enrichment when cold
@@ -612,17 +855,30 @@ uint8_t EngineSimulator::getWarmupEnrichment(int16_t coolantTemp) {
 }
 
 int8_t EngineSimulator::addNoise(int8_t value, int8_t range) {
-    #if SENSOR_NOISE_ENABLED
+    #if SENSOR_NOISE_ENABLED && FAST_RANDOM
+        // One batch covers about a tick of noise draws (MAP runs every step)
+        if (noiseIndex >= NOISE_POOL_SIZE) {
+            rng.fillNoise(noisePool, NOISE_POOL_SIZE);
+            noiseIndex = 0;
+        }
+        return value + FastRandom::boundNoise(noisePool[noiseIndex++], range);
+    #elif SENSOR_NOISE_ENABLED
         return value + randomProvider->random(-range, range + 1);
     #else
         return value;
     #endif
 }
 
-int16_t EngineSimulator::interpolate(int16_t current, int16_t target, uint8_t rate) {
-    // Linear interpolation with rate limiting
+int16_t EngineSimulator::interpolate(int16_t current, int16_t target, uint8_t rate, SimStage stage) {
+    // Linear interpolation with rate limiting: rate % of the gap per
+    // UPDATE_INTERVAL_MS, scaled to the stage period
     int16_t delta = target - current;
-    int16_t maxChange = (delta * rate) / 100;
+    int32_t scaled = (int32_t)delta * rate;
+    uint16_t period = getStagePeriodMs(stage);
+    
+    // Stages that run once per tick (all of them on AVR) need only the / 100
+    int16_t maxChange = (period == UPDATE_INTERVAL_MS) ? fpDiv100Signed(scaled)
+                                                       : (scaled * period) / (100L * UPDATE_INTERVAL_MS);
     
     if (maxChange == 0 && delta != 0) {
         maxChange = (delta > 0) ? 1 : -1;
@@ -641,6 +897,16 @@ void EngineSimulator::setMode(EngineMode mode) {
     transitionToMode(mode);
 }
 
+void EngineSimulator::setToothLogMode(ToothLogMode mode) {
+    if (mode != ToothLogMode::OFF) {
+        toothLog.clear();
+        triggerRunning = false;
+        triggerSync = false;
+        toothIndex = 0;
+    }
+    toothLogMode = mode;
+}
+
 uint32_t EngineSimulator::getRuntime() const {
     return (timeProvider->millis() - engineStartTime) / 1000;
 }
@@ -0,0 +1,88 @@
+/**
+ * @file FrameLog.cpp
+ * @brief Implementation of the onboard frame recorder
+ */
+
+#include "FrameLog.h"
+#include <string.h>
+
+FrameLog::FrameLog(EngineSimulator* simulator, IFrameLogStorage* storage)
+    : simulator(simulator)
+    , storage(storage)
+    , logSize(0)
+    , recording(true)
+    , recorded(false)
+    , lastGeneration(0)
+    , recordCount(0)
+    , droppedCount(0)
+{
+}
+
+bool FrameLog::begin() {
+    recorded = false;
+    recordCount = 0;
+    droppedCount = 0;
+    
+    if (storage == nullptr || !storage->begin()) {
+        logSize = 0;
+        return false;
+    }
+    logSize = storage->size();
+    return true;
+}
+
+bool FrameLog::update() {
+    if (!recording || storage == nullptr) {
+        return false;
+    }
+    
+    const EngineSnapshot& snapshot = simulator->getSnapshot();
+    if (recorded && snapshot.generation - lastGeneration < FRAME_LOG_INTERVAL) {
+        return false;
+    }
+    lastGeneration = snapshot.generation;
+    recorded = true;
+    
+    uint8_t record[FRAME_LOG_RECORD_SIZE];
+    for (uint8_t i = 0; i < 4; i++) {
+        record[i] = static_cast<uint8_t>(snapshot.generation >> (8 * i));
+    }
+    memcpy(&record[4], snapshot.getChannels(LAYOUT_LEGACY), sizeof(EngineStatus));
+    
+    // Full log: keep the oldest frames, count what is lost
+    if (logSize + sizeof(record) > FRAME_LOG_MAX_BYTES || !storage->append(record, sizeof(record))) {
+        droppedCount++;
+        return false;
+    }
+    logSize += sizeof(record);
+    recordCount++;
+    return true;
+}
+
+const uint8_t* FrameLog::read(uint32_t offset, uint16_t maxLength, uint16_t* length) {
+    *length = 0;
+    if (storage == nullptr || offset >= logSize) {
+        return chunk;
+    }
+    
+    uint32_t available = logSize - offset;
+    uint16_t wanted = (maxLength < FRAME_LOG_CHUNK_SIZE) ? maxLength : FRAME_LOG_CHUNK_SIZE;
+    if (available < wanted) {
+        wanted = static_cast<uint16_t>(available);
+    }
+    *length = storage->read(offset, chunk, wanted);
+    return chunk;
+}
+
+bool FrameLog::clear() {
+    recordCount = 0;
+    droppedCount = 0;
+    recorded = false;
+    
+    if (storage == nullptr) {
+        return true;
+    }
+    bool cleared = storage->clear();
+    logSize = storage->size();
+    return cleared;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file PageStore.cpp
+ * @brief Implementation of the tune page store
+ */
+
+#include "PageStore.h"
+#include <string.h>
+
+// Validity marker follows the pages in storage
+#define PAGE_STORAGE_MARKER_ADDRESS (PAGE_0_SIZE + PAGE_1_SIZE)
+
+PageStore::PageStore(INonVolatileStorage* storage)
+    : storage(storage)
+    , burnCount(0)
+    , bytesBurned(0)
+{
+    memset(pages, 0, sizeof(pages));
+    memset(dirtyStart, 0, sizeof(dirtyStart));
+    memset(dirtyEnd, 0, sizeof(dirtyEnd));
+}
+
+bool PageStore::begin() {
+    bool loaded = storage != nullptr && storage->begin() &&
+                  storage->read(PAGE_STORAGE_MARKER_ADDRESS) == PAGE_STORAGE_MAGIC;
+    
+    if (loaded) {
+        for (uint16_t i = 0; i < sizeof(pages); i++) {
+            pages[i] = storage->read(i);
+        }
+    } else {
+        // Blank or foreign storage: start from zeroed pages and make sure
+        // the first burn writes every byte
+        memset(pages, 0, sizeof(pages));
+    }
+    
+    for (uint8_t page = 0; page < PAGE_COUNT; page++) {
+        dirtyStart[page] = 0;
+        dirtyEnd[page] = loaded ? 0 : getPageSize(page);
+    }
+    
+    return loaded;
+}
+
+uint16_t PageStore::getPageSize(uint8_t page) {
+    switch (page) {
+        case 0: return PAGE_0_SIZE;
+        case 1: return PAGE_1_SIZE;
+        default: return 0;
+    }
+}
+
+uint16_t PageStore::getPageOffset(uint8_t page) {
+    return (page == 0) ? 0 : PAGE_0_SIZE;
+}
+
+bool PageStore::isValidRange(uint8_t page, uint16_t offset, uint16_t length) {
+    return length > 0 && (uint32_t)offset + length <= getPageSize(page);
+}
+
+bool PageStore::write(uint8_t page, uint16_t offset, const uint8_t* data, uint16_t length) {
+    if (!isValidRange(page, offset, length)) {
+        return false;
+    }
+    
+    // Track only bytes that actually change, so re-sending an unchanged
+    // block (TunerStudio does this routinely) costs no burn time
+    uint8_t* target = &pages[getPageOffset(page) + offset];
+    uint16_t first = length;
+    uint16_t last = 0;
+    for (uint16_t i = 0; i < length; i++) {
+        if (target[i] != data[i]) {
+            target[i] = data[i];
+            if (first == length) first = i;
+            last = i + 1;
+        }
+    }
+    
+    if (first < length) {
+        uint16_t start = offset + first;
+        uint16_t end = offset + last;
+        if (dirtyEnd[page] == 0) {
+            dirtyStart[page] = start;
+            dirtyEnd[page] = end;
+        } else {
+            if (start < dirtyStart[page]) dirtyStart[page] = start;
+            if (end > dirtyEnd[page]) dirtyEnd[page] = end;
+        }
+    }
+    
+    return true;
+}
+
+bool PageStore::burn(uint8_t page) {
+    if (page >= PAGE_COUNT) {
+        return false;
+    }
+    if (dirtyEnd[page] == 0 || storage == nullptr) {
+        return true;  // Nothing to do
+    }
+    
+    // Until the marker is set, storage holds no complete tune: the first
+    // burn writes every page, then marks the tune valid
+    bool firstBurn = storage->read(PAGE_STORAGE_MARKER_ADDRESS) != PAGE_STORAGE_MAGIC;
+    uint8_t firstPage = firstBurn ? 0 : page;
+    uint8_t lastPage = firstBurn ? PAGE_COUNT - 1 : page;
+    
+    for (uint8_t p = firstPage; p <= lastPage; p++) {
+        uint16_t base = getPageOffset(p);
+        if (dirtyEnd[p] > 0 && !writeRuns(base + dirtyStart[p], base + dirtyEnd[p])) {
+            return false;  // Keep the page dirty so the burn can be retried
+        }
+    }
+    if ((firstBurn && !writeMarker()) || !storage->commit()) {
+        return false;
+    }
+    
+    for (uint8_t p = firstPage; p <= lastPage; p++) {
+        dirtyEnd[p] = 0;
+    }
+    burnCount++;
+    return true;
+}
+
+bool PageStore::burnAll() {
+    bool ok = true;
+    for (uint8_t page = 0; page < PAGE_COUNT; page++) {
+        ok = burn(page) && ok;
+    }
+    return ok;
+}
+
+bool PageStore::writeRuns(uint16_t start, uint16_t end) {
+    // The dirty range may contain bytes that were changed and changed back;
+    // compare against storage and write only the runs that differ
+    uint16_t i = start;
+    while (i < end) {
+        if (storage->read(i) == pages[i]) {
+            i++;
+            continue;
+        }
+        
+        uint16_t runStart = i;
+        while (i < end && storage->read(i) != pages[i]) {
+            i++;
+        }
+        
+        if (!storage->write(runStart, &pages[runStart], i - runStart)) {
+            return false;
+        }
+        bytesBurned += i - runStart;
+    }
+    return true;
+}
+
+bool PageStore::writeMarker() {
+    uint8_t marker = PAGE_STORAGE_MAGIC;
+    return storage->write(PAGE_STORAGE_MARKER_ADDRESS, &marker, 1);
+}
@@ -0,0 +1,162 @@
+/**
+ * @file ProtocolServer.cpp
+ * @brief Implementation of concurrent protocol sessions
+ */
+
+#include "ProtocolServer.h"
+
+#ifdef ENABLE_WIFI
+  #include "TcpSerialAdapter.h"
+#endif
+
+ProtocolServer::ProtocolServer(EngineSimulator* simulator, ITimeProvider* timeProvider,
+                               PageStore* pageStore)
+    : simulator(simulator)
+    , timeProvider(timeProvider)
+    , pageStore(pageStore)
+    , frameLog(nullptr)
+    , sessionCount(0)
+    , acceptedCount(0)
+    , rejectedCount(0)
+    #ifdef ENABLE_WIFI
+    , server(nullptr)
+    #endif
+{
+    memset(sessions, 0, sizeof(sessions));
+    #ifdef ENABLE_WIFI
+        for (uint8_t i = 0; i < PROTOCOL_SERVER_MAX_SESSIONS; i++) {
+            pendingClients[i] = nullptr;
+        }
+    #endif
+}
+
+ProtocolServer::~ProtocolServer() {
+    #ifdef ENABLE_WIFI
+        delete server;
+        for (uint8_t i = 0; i < PROTOCOL_SERVER_MAX_SESSIONS; i++) {
+            delete pendingClients[i];
+        }
+    #endif
+    for (uint8_t i = 0; i < PROTOCOL_SERVER_MAX_SESSIONS; i++) {
+        detach(i);
+    }
+}
+
+int8_t ProtocolServer::attach(ISerialInterface* transport, bool takeOwnership) {
+    for (uint8_t i = 0; i < PROTOCOL_SERVER_MAX_SESSIONS; i++) {
+        Session& session = sessions[i];
+        if (session.transport != nullptr) {
+            continue;
+        }
+        
+        session.transport = transport;
+        session.ownsTransport = takeOwnership;
+        session.protocol = new SpeeduinoProtocol(transport, simulator, timeProvider, pageStore);
+        session.protocol->setFrameLog(frameLog);
+        session.protocol->begin();
+        transport->setAsyncTransmit(true);
+        sessionCount++;
+        acceptedCount++;
+        return i;
+    }
+    
+    rejectedCount++;
+    return -1;
+}
+
+void ProtocolServer::detach(uint8_t index) {
+    if (index >= PROTOCOL_SERVER_MAX_SESSIONS || sessions[index].transport == nullptr) {
+        return;
+    }
+    
+    Session& session = sessions[index];
+    delete session.protocol;
+    if (session.ownsTransport) {
+        delete session.transport;
+    }
+    session.transport = nullptr;
+    session.protocol = nullptr;
+    sessionCount--;
+}
+
+uint16_t ProtocolServer::update() {
+    #ifdef ENABLE_WIFI
+        adoptPendingClients();
+    #endif
+    
+    uint16_t handled = 0;
+    for (uint8_t i = 0; i < PROTOCOL_SERVER_MAX_SESSIONS; i++) {
+        Session& session = sessions[i];
+        if (session.transport == nullptr) {
+            continue;
+        }
+        if (!session.transport->isReady()) {
+            detach(i);
+            continue;
+        }
+        handled += session.protocol->processCommands();
+    }
+    
+    // Everything a session answered in this pass goes out as one write
+    for (uint8_t i = 0; i < PROTOCOL_SERVER_MAX_SESSIONS; i++) {
+        if (sessions[i].transport != nullptr) {
+            sessions[i].transport->pollTransmit();
+        }
+    }
+    return handled;
+}
+
+SpeeduinoProtocol* ProtocolServer::getSession(uint8_t index) const {
+    return (index < PROTOCOL_SERVER_MAX_SESSIONS) ? sessions[index].protocol : nullptr;
+}
+
+#ifdef ENABLE_WIFI
+
+bool ProtocolServer::listen(uint16_t port) {
+    if (server != nullptr) {
+        return true;
+    }
+    
+    server = new AsyncServer(port);
+    server->setNoDelay(true);
+    server->onClient([](void* arg, AsyncClient* client) {
+        static_cast<ProtocolServer*>(arg)->acceptClient(client);
+    }, this);
+    server->begin();
+    return true;
+}
+
+void ProtocolServer::acceptClient(AsyncClient* client) {
+    // TCP task: wrap the client right away, so its RX ring receives from the
+    // first packet (TunerStudio probes with 'Q'/'S' as soon as it connects),
+    // then hand the adapter to loop(), which owns the session table
+    for (uint8_t i = 0; i < PROTOCOL_SERVER_MAX_SESSIONS; i++) {
+        if (pendingClients[i] == nullptr) {
+            TcpSerialAdapter* transport = new TcpSerialAdapter(client);
+            __sync_synchronize();
+            pendingClients[i] = transport;
+            return;
+        }
+    }
+    
+    rejectedCount++;
+    client->close(true);
+    delete client;
+}
+
+void ProtocolServer::adoptPendingClients() {
+    for (uint8_t i = 0; i < PROTOCOL_SERVER_MAX_SESSIONS; i++) {
+        TcpSerialAdapter* transport = pendingClients[i];
+        if (transport == nullptr) {
+            continue;
+        }
+        __sync_synchronize();
+        pendingClients[i] = nullptr;
+        
+        if (attach(transport, true) < 0) {
+            delete transport;   // Closes the client; attach() counted the rejection
+        }
+    }
+}
+
+#endif // ENABLE_WIFI
@@ -4,168 +4,1324 @@
  */
 
 #include "SpeeduinoProtocol.h"
+#include "Crc32.h"
+#include "PageStore.h"
+#include "FrameLog.h"
+#include "PgmSpace.h"
 #include <string.h>
 
-SpeeduinoProtocol::SpeeduinoProtocol(ISerialInterface* serial, EngineSimulator* simulator)
+// ============================================
+// Command Dispatch Table
+// ============================================
+
+/**
+ * Command handlers. Each receives exactly CommandEntry::argCount argument
+ * bytes, whether the request arrived raw or inside a CRC32 frame.
+ */
+struct CommandTable {
+    static void realtimeData(SpeeduinoProtocol& protocol, const uint8_t* args);      // 'A'
+    static void rangedRead(SpeeduinoProtocol& protocol, const uint8_t* args);        // 'r'
+    static void deltaRealtime(SpeeduinoProtocol& protocol, const uint8_t* args);     // 'e'
+    static void statusRequest(SpeeduinoProtocol& protocol, const uint8_t* args);     // 'Q'
+    static void versionRequest(SpeeduinoProtocol& protocol, const uint8_t* args);    // 'V'/'v'
+    static void signatureRequest(SpeeduinoProtocol& protocol, const uint8_t* args);  // 'S'
+    static void selectSignature(SpeeduinoProtocol& protocol, const uint8_t* args);   // 's'
+    static void pageSizesRequest(SpeeduinoProtocol& protocol, const uint8_t* args);  // 'n'
+    static void diagnostics(SpeeduinoProtocol& protocol, const uint8_t* args);       // 'D'
+    static void startStream(SpeeduinoProtocol& protocol, const uint8_t* args);       // 'G'
+    static void stopStream(SpeeduinoProtocol& protocol, const uint8_t* args);        // 'g'
+    static void readPage(SpeeduinoProtocol& protocol, const uint8_t* args);          // 'p'
+    static void writePage(SpeeduinoProtocol& protocol, const uint8_t* args);         // 'M'
+    static void burnPage(SpeeduinoProtocol& protocol, const uint8_t* args);          // 'b'
+    static void burnAll(SpeeduinoProtocol& protocol, const uint8_t* args);           // 'B'
+    static void startToothLog(SpeeduinoProtocol& protocol, const uint8_t* args);     // 'H'
+    static void startCompositeLog(SpeeduinoProtocol& protocol, const uint8_t* args); // 'J'/'X'
+    static void stopLogger(SpeeduinoProtocol& protocol, const uint8_t* args);        // 'h'/'j'/'x'
+    static void toothLog(SpeeduinoProtocol& protocol, const uint8_t* args);          // 'T'
+    static void compositeLog(SpeeduinoProtocol& protocol, const uint8_t* args);      // 'O'
+    static void setBaudRate(SpeeduinoProtocol& protocol, const uint8_t* args);       // 'u'
+    static void selfTest(SpeeduinoProtocol& protocol, const uint8_t* args);          // 'l'
+    static void downloadLog(SpeeduinoProtocol& protocol, const uint8_t* args);       // 'y'
+    static void clearLog(SpeeduinoProtocol& protocol, const uint8_t* args);          // 'Y'
+};
+
+typedef void (*CommandHandler)(SpeeduinoProtocol& protocol, const uint8_t* args);
+
+struct CommandEntry {
+    CommandHandler handler;     // nullptr = unknown command
+    uint8_t argCount;           // Argument bytes following the command byte
+    uint8_t statSlot;           // Index into the per-command statistics
+    bool hasData;               // Last two argument bytes give a data length (LE);
+                                // that many data bytes follow the arguments
+};
+
+// Per-command statistics slots (slot 0 collects unknown commands)
+enum CommandSlot : uint8_t {
+    SLOT_UNKNOWN = 0,
+    SLOT_REALTIME,
+    SLOT_RANGED_READ,
+    SLOT_STATUS,
+    SLOT_VERSION,
+    SLOT_SIGNATURE,
+    SLOT_PAGE_SIZES,
+    SLOT_DIAGNOSTICS,
+    SLOT_STREAM,
+    SLOT_PAGE_READ,
+    SLOT_PAGE_WRITE,
+    SLOT_BURN,
+    SLOT_TOOTH_LOG,
+    SLOT_COMPOSITE_LOG,
+    SLOT_LINK,
+    SLOT_FRAME_LOG,
+    SLOT_COUNT
+};
+
+static_assert(SLOT_COUNT <= PROTOCOL_COMMAND_SLOTS, "Increase PROTOCOL_COMMAND_SLOTS");
+
+/**
+ * @brief Table entry for one command byte (add new commands here)
+ */
+constexpr CommandEntry commandEntry(uint8_t command) {
+    return command == 'A' ? CommandEntry{ &CommandTable::realtimeData,      0, SLOT_REALTIME,      false } :
+           command == 'r' ? CommandEntry{ &CommandTable::rangedRead,        6, SLOT_RANGED_READ,   false } :
+           command == 'e' ? CommandEntry{ &CommandTable::deltaRealtime,     2, SLOT_REALTIME,      false } :
+           command == 'Q' ? CommandEntry{ &CommandTable::statusRequest,     0, SLOT_STATUS,        false } :
+           command == 'V' ? CommandEntry{ &CommandTable::versionRequest,    0, SLOT_VERSION,       false } :
+           command == 'v' ? CommandEntry{ &CommandTable::versionRequest,    0, SLOT_VERSION,       false } :
+           command == 'S' ? CommandEntry{ &CommandTable::signatureRequest,  0, SLOT_SIGNATURE,     false } :
+           command == 's' ? CommandEntry{ &CommandTable::selectSignature,  20, SLOT_SIGNATURE,     false } :
+           command == 'n' ? CommandEntry{ &CommandTable::pageSizesRequest,  0, SLOT_PAGE_SIZES,    false } :
+           command == 'D' ? CommandEntry{ &CommandTable::diagnostics,       1, SLOT_DIAGNOSTICS,   false } :
+           command == 'G' ? CommandEntry{ &CommandTable::startStream,       5, SLOT_STREAM,        false } :
+           command == 'g' ? CommandEntry{ &CommandTable::stopStream,        0, SLOT_STREAM,        false } :
+           command == 'p' ? CommandEntry{ &CommandTable::readPage,          6, SLOT_PAGE_READ,     false } :
+           command == 'M' ? CommandEntry{ &CommandTable::writePage,         6, SLOT_PAGE_WRITE,    true } :
+           command == 'b' ? CommandEntry{ &CommandTable::burnPage,          2, SLOT_BURN,          false } :
+           command == 'B' ? CommandEntry{ &CommandTable::burnAll,           0, SLOT_BURN,          false } :
+           command == 'H' ? CommandEntry{ &CommandTable::startToothLog,     0, SLOT_TOOTH_LOG,     false } :
+           command == 'h' ? CommandEntry{ &CommandTable::stopLogger,        0, SLOT_TOOTH_LOG,     false } :
+           command == 'T' ? CommandEntry{ &CommandTable::toothLog,          0, SLOT_TOOTH_LOG,     false } :
+           command == 'J' ? CommandEntry{ &CommandTable::startCompositeLog, 0, SLOT_COMPOSITE_LOG, false } :
+           command == 'j' ? CommandEntry{ &CommandTable::stopLogger,        0, SLOT_COMPOSITE_LOG, false } :
+           command == 'X' ? CommandEntry{ &CommandTable::startCompositeLog, 0, SLOT_COMPOSITE_LOG, false } :
+           command == 'x' ? CommandEntry{ &CommandTable::stopLogger,        0, SLOT_COMPOSITE_LOG, false } :
+           command == 'O' ? CommandEntry{ &CommandTable::compositeLog,      0, SLOT_COMPOSITE_LOG, false } :
+           command == 'u' ? CommandEntry{ &CommandTable::setBaudRate,       4, SLOT_LINK,          false } :
+           command == 'l' ? CommandEntry{ &CommandTable::selfTest,          2, SLOT_LINK,          true } :
+           command == 'y' ? CommandEntry{ &CommandTable::downloadLog,       4, SLOT_FRAME_LOG,     false } :
+           command == 'Y' ? CommandEntry{ &CommandTable::clearLog,          0, SLOT_FRAME_LOG,     false } :
+                            CommandEntry{ nullptr,                          0, SLOT_UNKNOWN,       false };
+}
+
+// Index sequence 0..255 used to expand commandEntry() over every byte value
+template<uint8_t... I> struct CommandIndices {};
+template<unsigned N, uint8_t... I>
+struct MakeCommandIndices : MakeCommandIndices<N - 1, N - 1, I...> {};
+template<uint8_t... I>
+struct MakeCommandIndices<0, I...> { typedef CommandIndices<I...> type; };
+
+struct CommandTableData {
+    CommandEntry entries[256];
+};
+
+template<uint8_t... I>
+constexpr CommandTableData buildCommandTable(CommandIndices<I...>) {
+    return CommandTableData{ { commandEntry(I)... } };
+}
+
+// 256-entry table built at compile time and kept in flash
+static const CommandTableData COMMAND_TABLE PROGMEM =
+    buildCommandTable(MakeCommandIndices<256>::type());
+
+static inline void loadCommandEntry(uint8_t command, CommandEntry* entry) {
+    memcpy_P(entry, &COMMAND_TABLE.entries[command], sizeof(CommandEntry));
+}
+
+// Data bytes announced by a variable-length command's arguments
+static inline uint16_t commandDataLength(const CommandEntry& entry, const uint8_t* args) {
+    if (!entry.hasData) {
+        return 0;
+    }
+    return args[entry.argCount - 2] | (static_cast<uint16_t>(args[entry.argCount - 1]) << 8);
+}
+
+// ============================================
+// SpeeduinoProtocol
+// ============================================
+
+SpeeduinoProtocol::SpeeduinoProtocol(ISerialInterface* serial, EngineSimulator* simulator,
+                                     ITimeProvider* timeProvider, PageStore* pageStore)
     : serial(serial)
     , simulator(simulator)
+    , timeProvider(timeProvider)
+    , pageStore(pageStore)
+    , frameLog(nullptr)
+    , maxCommandsPerCall(PROTOCOL_MAX_COMMANDS_PER_CALL)
+    , maxProcessTimeUs(PROTOCOL_MAX_PROCESS_TIME_US)
+    , budgetExhausted(false)
+    , framedSession(false)
+    , framedRequest(false)
+    , strayBytes(0)
+    , layout(LAYOUT_LEGACY)
+    , rxState(RX_IDLE)
+    , rxCommand(0)
+    , rxExpected(0)
+    , rxCount(0)
+    , rxCrc(0)
+    , rxByteTime(0)
+    , streaming(false)
+    , streamFramed(false)
+    , streamInterval(1)
+    , streamOffset(0)
+    , streamLength(0)
+    , streamGeneration(0)
+    , deltaSequence(0)
+    , deltaBaseValid(false)
+    , deltaSinceKeyframe(0)
+    , deltaFrameCount(0)
+    , keyframeCount(0)
+    , baudRate(SERIAL_BAUD_RATE)
+    , fallbackBaudRate(SERIAL_BAUD_RATE)
+    , baudSwitchTime(0)
+    , baudPending(false)
+    , baudFallbackCount(0)
+    , selfTestBytes(0)
+    , selfTestErrors(0)
+    , downloading(false)
+    , downloadFramed(false)
+    , downloadOffset(0)
+    , downloadEnd(0)
     , commandCount(0)
     , errorCount(0)
     , lastCommandTime(0)
 {
+    memset(commandSlotCounts, 0, sizeof(commandSlotCounts));
+    memset(latencyHistogram, 0, sizeof(latencyHistogram));
+    memset(deltaBase, 0, sizeof(deltaBase));
+    
+    #if PROTOCOL_TX_SPANS > 0
+        txSpanCount = 0;
+        txScratchUsed = 0;
+        txUnflushed = false;
+    #endif
 }
 
 void SpeeduinoProtocol::begin() {
     serial->begin(SERIAL_BAUD_RATE);
+    baudRate = SERIAL_BAUD_RATE;
+    baudPending = false;
     commandCount = 0;
     errorCount = 0;
+    framedSession = false;
+    strayBytes = 0;
+    layout = LAYOUT_LEGACY;
+    deltaBaseValid = false;
+    deltaFrameCount = 0;
+    keyframeCount = 0;
+    streaming = false;
+    downloading = false;
+    rxState = RX_IDLE;
+    memset(commandSlotCounts, 0, sizeof(commandSlotCounts));
+    memset(latencyHistogram, 0, sizeof(latencyHistogram));
 }
 
-bool SpeeduinoProtocol::processCommands() {
-    if (serial->available() <= 0) {
-        return false;
+uint32_t SpeeduinoProtocol::getCommandCount(uint8_t command) const {
+    return commandSlotCounts[getCommandSlot(command)];
+}
+
+uint8_t SpeeduinoProtocol::getCommandSlot(uint8_t command) const {
+    CommandEntry entry;
+    loadCommandEntry(command, &entry);
+    return entry.statSlot;
+}
+
+uint32_t SpeeduinoProtocol::getLatencyCount(uint8_t command, uint8_t bucket) const {
+    if (bucket >= PROTOCOL_LATENCY_BUCKETS) {
+        return 0;
     }
+    return latencyHistogram[getCommandSlot(command)][bucket];
+}
+
+uint32_t SpeeduinoProtocol::getLatencyBucketFloorUs(uint8_t bucket) {
+    if (bucket == 0 || bucket >= PROTOCOL_LATENCY_BUCKETS) {
+        return 0;
+    }
+    return 1UL << (bucket - 1 + PROTOCOL_LATENCY_SHIFT);
+}
+
+void SpeeduinoProtocol::setProcessingBudget(uint8_t maxCommands, uint16_t maxTimeUs) {
+    maxCommandsPerCall = (maxCommands > 0) ? maxCommands : 1;
+    maxProcessTimeUs = maxTimeUs;
+}
+
+uint8_t SpeeduinoProtocol::processCommands() {
+    uint8_t handled = 0;
+    uint32_t startTime = (timeProvider != nullptr) ? timeProvider->micros() : 0;
+    bool budgetSpent = false;
     
-    // Read command byte
-    int cmdByte = serial->read();
-    if (cmdByte < 0) {
-        return false;
+    // Keep queued responses moving (no-op for synchronous transports)
+    serial->pollTransmit();
+    
+    if (baudPending) {
+        checkBaudRateFallback(startTime);
     }
     
-    char command = (char)cmdByte;
-    commandCount++;
+    // Drop a request whose remaining bytes never arrived; the next byte is
+    // then parsed as a new command or frame start, which resynchronizes.
+    // rxByteTime is when the last byte was consumed, not when it arrived:
+    // after a loop() stall the rest may already be waiting, so only an
+    // empty receive buffer counts as silence.
+    if (rxState != RX_IDLE && timeProvider != nullptr && serial->available() <= 0 &&
+        startTime - rxByteTime > SERIAL_TIMEOUT_MS * 1000UL) {
+        rxState = RX_IDLE;
+        errorCount++;
+    }
     
-    // Dispatch to appropriate handler
-    switch (command) {
-        case 'A':  // Real-time data (most common)
-            handleRealtimeData();
+    while (serial->available() > 0) {
+        if (handled >= maxCommandsPerCall) {
+            budgetSpent = true;
             break;
-            
-        case 'Q':  // Status request
-            handleStatusRequest();
+        }
+        
+        int rxByte = serial->read();
+        if (rxByte < 0) {
             break;
-            
-        case 'V':  // Version request (capital V)
-        case 'v':  // Also accept lowercase
-            handleVersionRequest();
+        }
+        
+        if (!receiveByte(rxByte)) {
+            continue;  // Request incomplete, keep collecting
+        }
+        handled++;
+        
+        // Leave the rest for the next pass once the time budget is spent
+        if (timeProvider != nullptr && maxProcessTimeUs > 0 &&
+            timeProvider->micros() - startTime >= maxProcessTimeUs) {
+            budgetSpent = true;
             break;
+        }
+    }
+    budgetExhausted = budgetSpent && serial->available() > 0;
+    
+    if (streaming) {
+        serviceStream();
+    }
+    if (downloading) {
+        serviceDownload();
+    }
+    
+    // Everything answered in this pass leaves in one gathered write
+    flushResponses();
+    
+    return handled;
+}
+
+bool SpeeduinoProtocol::receiveByte(uint8_t rxByte) {
+    uint32_t previousByteTime = rxByteTime;
+    if (timeProvider != nullptr) {
+        rxByteTime = timeProvider->micros();
+    }
+    
+    switch (rxState) {
+        case RX_IDLE: {
+            // A framed request starts with its payload length high byte
+            // (0x00/0x01), which is never a legacy command character
+            if (rxByte <= FRAME_MAX_SIZE_HIGH) {
+                commandCount++;
+                lastCommandTime = rxByteTime;
+                strayBytes = 0;
+                rxExpected = static_cast<uint16_t>(rxByte) << 8;
+                rxState = RX_FRAME_SIZE_LOW;
+                return false;
+            }
             
-        case 'S':  // Signature request
-            handleSignatureRequest();
-            break;
+            // A framed client never sends legacy commands: anything else is
+            // the rest of a frame whose header was lost (a stray 'M' must not
+            // write a page), dropped until the next frame start. Only a new
+            // client may speak legacy: after SERIAL_TIMEOUT_MS of silence, or
+            // without a clock after PROTOCOL_LEGACY_FALLBACK_BYTES dropped in
+            // a row. Dropped bytes are errors, not requests (no budget used).
+            if (framedSession) {
+                bool newClient = (timeProvider != nullptr)
+                    ? rxByteTime - previousByteTime > SERIAL_TIMEOUT_MS * 1000UL
+                    : strayBytes >= PROTOCOL_LEGACY_FALLBACK_BYTES;
+                if (!newClient) {
+                    if (strayBytes < 0xFF) {
+                        strayBytes++;
+                    }
+                    errorCount++;
+                    return false;
+                }
+            }
+            strayBytes = 0;
+            commandCount++;
+            lastCommandTime = rxByteTime;
             
-        case 'n':  // Page sizes
-            handlePageSizesRequest();
-            break;
+            CommandEntry entry;
+            loadCommandEntry(rxByte, &entry);
+            rxCount = 0;
+            if (entry.handler == nullptr || entry.argCount == 0) {
+                handleLegacyCommand(rxByte);
+                return true;
+            }
+            
+            rxCommand = rxByte;
+            rxExpected = entry.argCount;
+            rxState = RX_LEGACY_ARGS;
+            return false;
+        }
+        
+        case RX_LEGACY_ARGS: {
+            rxBuffer[rxCount++] = rxByte;
+            if (rxCount < rxExpected) {
+                return false;
+            }
             
-        // Additional commands can be added here:
-        // case 'B': handleBurnCommand(); break;
-        // case 'C': handleTestOutputs(); break;
-        // case 'E': handleErrorCodes(); break;
-        // case 'F': handleGetPage(); break;
-        // etc.
+            CommandEntry entry;
+            loadCommandEntry(rxCommand, &entry);
+            uint32_t total = rxExpected + (uint32_t)commandDataLength(entry, rxBuffer);
+            if (total > rxExpected) {
+                rxExpected = (total > 0xFFFF) ? 0xFFFF : total;
+                rxState = RX_LEGACY_DATA;
+                return false;
+            }
+            
+            rxState = RX_IDLE;
+            handleLegacyCommand(rxCommand);
+            return true;
+        }
+        
+        case RX_LEGACY_DATA:
+            // Oversized data is consumed but not stored (rejected once complete)
+            if (rxCount < PROTOCOL_RX_BUFFER_SIZE) {
+                rxBuffer[rxCount] = rxByte;
+            }
+            if (++rxCount < rxExpected) {
+                return false;
+            }
+            rxState = RX_IDLE;
+            handleLegacyCommand(rxCommand);
+            return true;
         
+        case RX_FRAME_SIZE_LOW:
+            rxExpected |= rxByte;
+            if (rxExpected == 0 || rxExpected > PROTOCOL_RX_BUFFER_SIZE) {
+                rxState = RX_IDLE;
+                errorCount++;  // Not a plausible header: dropped like a stray byte
+                return false;
+            }
+            rxCount = 0;
+            rxState = RX_FRAME_PAYLOAD;
+            return false;
+        
+        case RX_FRAME_PAYLOAD:
+            rxBuffer[rxCount++] = rxByte;
+            if (rxCount == rxExpected) {
+                rxCrc = 0;
+                rxCount = 0;
+                rxState = RX_FRAME_CRC;
+            }
+            return false;
+        
+        case RX_FRAME_CRC:
         default:
-            handleUnknownCommand(command);
-            errorCount++;
-            break;
+            rxCrc = (rxCrc << 8) | rxByte;
+            if (++rxCount < 4) {
+                return false;
+            }
+            rxState = RX_IDLE;
+            handleFrame(rxExpected, rxCrc);
+            return true;
+    }
+}
+
+void SpeeduinoProtocol::handleLegacyCommand(uint8_t command) {
+    CommandEntry entry;
+    loadCommandEntry(command, &entry);
+    
+    if (entry.handler == nullptr) {
+        errorCount++;
+        handleUnknownCommand(command);
+        recordCommand(SLOT_UNKNOWN);
+        return;
+    }
+    
+    // Argument and data bytes (if any) are already collected in rxBuffer
+    framedSession = false;
+    if (rxCount > PROTOCOL_RX_BUFFER_SIZE) {
+        sendError(RC_RANGE_ERROR);  // Data did not fit the receive buffer
+        errorCount++;
+    } else {
+        entry.handler(*this, rxBuffer);
+    }
+    recordCommand(entry.statSlot);
+}
+
+void SpeeduinoProtocol::handleFrame(uint16_t size, uint32_t receivedCrc) {
+    /**
+     * Framed request format:
+     * Bytes 0-1: Payload size (big-endian)
+     * Bytes 2..: Payload (command byte + arguments)
+     * Last 4 bytes: CRC32 of the payload (big-endian)
+     * 
+     * The payload is in rxBuffer. Anything that does not parse was already
+     * dropped by receiveByte(); the next byte is then examined as a
+     * potential frame start, which resynchronizes the stream.
+     */
+    
+    framedSession = true;
+    framedRequest = true;
+    
+    CommandEntry entry;
+    loadCommandEntry(rxBuffer[0], &entry);
+    
+    if (Crc32::compute(rxBuffer, size) != receivedCrc) {
+        sendError(RC_CRC_ERROR);
+        errorCount++;
+    } else if (entry.handler == nullptr) {
+        handleUnknownCommand(rxBuffer[0]);
+        errorCount++;
+        recordCommand(SLOT_UNKNOWN);
+    } else if (size - 1 < entry.argCount ||
+               size - 1 < entry.argCount + commandDataLength(entry, rxBuffer + 1)) {
+        sendError(RC_RANGE_ERROR);
+        errorCount++;
+    } else {
+        entry.handler(*this, rxBuffer + 1);
+        recordCommand(entry.statSlot);
+    }
+    
+    framedRequest = false;
+}
+
+// ============================================
+// Command Handlers
+// ============================================
+
+void CommandTable::realtimeData(SpeeduinoProtocol& protocol, const uint8_t*) {
+    // Send the last published snapshot straight from the session layout's
+    // buffer (never the working copy the simulator is mutating)
+    const EngineSnapshot& snapshot = protocol.simulator->getSnapshot();
+    protocol.sendResponseInPlace(snapshot.getChannels(protocol.layout),
+                                 EngineSnapshot::getChannelsSize(protocol.layout));
+}
+
+void CommandTable::rangedRead(SpeeduinoProtocol& protocol, const uint8_t* args) {
+    /**
+     * 'r' command request format (6 argument bytes after 'r'):
+     * Byte 0: CAN ID (ignored, the simulator is a single ECU)
+     * Byte 1: Sub-command (0x30 = output channels)
+     * Bytes 2-3: Offset into the output channels (little-endian)
+     * Bytes 4-5: Length (little-endian)
+     * 
+     * Response: 'length' bytes of the published output channels (session
+     * layout) starting at 'offset', sent straight from the snapshot buffer.
+     */
+    
+    uint16_t offset = args[2] | (static_cast<uint16_t>(args[3]) << 8);
+    uint16_t length = args[4] | (static_cast<uint16_t>(args[5]) << 8);
+    
+    if (args[1] != SpeeduinoProtocol::RANGED_READ_OUTPUT_CHANNELS || length == 0 ||
+        (uint32_t)offset + length > EngineSnapshot::getChannelsSize(protocol.layout)) {
+        protocol.sendError(SpeeduinoProtocol::RC_RANGE_ERROR);
+        protocol.errorCount++;
+        return;
+    }
+    
+    const uint8_t* channels = protocol.simulator->getSnapshot().getChannels(protocol.layout);
+    protocol.sendResponseInPlace(channels + offset, length);
+}
+
+void CommandTable::deltaRealtime(SpeeduinoProtocol& protocol, const uint8_t* args) {
+    /**
+     * 'e' command request format (2 argument bytes after 'e'):
+     * Bytes 0-1: Sequence of the last 'e' reply the client decoded
+     *            (little-endian, any value after connecting)
+     * 
+     * Response:
+     * Byte 0: 0x00 = keyframe, 0x01 = delta
+     * Bytes 1-2: Sequence of this reply (little-endian)
+     * Keyframe: the session layout's output channels
+     * Delta: one bit per channel byte (bit i & 7 of byte i >> 3 set = changed),
+     *        then the changed bytes in channel order
+     * 
+     * A delta refers to the previous reply and is only sent when the
+     * request acknowledges it; otherwise, after a layout change, every
+     * DELTA_KEYFRAME_INTERVAL frames, or when the delta would not be
+     * smaller, a keyframe is sent.
+     */
+    
+    const uint8_t* channels = protocol.simulator->getSnapshot().getChannels(protocol.layout);
+    uint16_t size = EngineSnapshot::getChannelsSize(protocol.layout);
+    uint16_t bitmapSize = (size + 7) / 8;
+    uint16_t ack = args[0] | (static_cast<uint16_t>(args[1]) << 8);
+    
+    uint8_t frame[3 + (OUTPUT_CHANNELS_MAX_SIZE + 7) / 8 + OUTPUT_CHANNELS_MAX_SIZE];
+    uint16_t length = 0;
+    
+    if (protocol.deltaBaseValid && ack == protocol.deltaSequence &&
+        protocol.deltaSinceKeyframe < DELTA_KEYFRAME_INTERVAL - 1) {
+        uint8_t* bitmap = &frame[3];
+        memset(bitmap, 0, bitmapSize);
+        length = 3 + bitmapSize;
+        
+        for (uint16_t i = 0; i < size && length < 3 + size; i++) {
+            if (channels[i] != protocol.deltaBase[i]) {
+                bitmap[i >> 3] |= 1 << (i & 7);
+                frame[length++] = channels[i];
+            }
+        }
+        if (length >= 3 + size) {
+            length = 0;  // Nothing saved: send a keyframe instead
+        }
+    }
+    
+    if (length > 0) {
+        frame[0] = 0x01;
+        protocol.deltaSinceKeyframe++;
+        protocol.deltaFrameCount++;
+    } else {
+        frame[0] = 0x00;
+        memcpy(&frame[3], channels, size);
+        length = 3 + size;
+        protocol.deltaSinceKeyframe = 0;
+        protocol.keyframeCount++;
+    }
+    
+    protocol.deltaSequence++;
+    frame[1] = static_cast<uint8_t>(protocol.deltaSequence & 0xFF);
+    frame[2] = static_cast<uint8_t>(protocol.deltaSequence >> 8);
+    memcpy(protocol.deltaBase, channels, size);
+    protocol.deltaBaseValid = true;
+    
+    protocol.sendResponse(frame, length);
+}
+
+// Constant replies, generated at compile time and kept in flash together
+// with their framed-mode CRC32 (return code RC_OK + data)
+#define FRAMED_CRC(reply, length) \
+    Crc32::finish(Crc32::updateConstant(Crc32::updateConstant(Crc32::begin(), SpeeduinoProtocol::RC_OK), \
+                                        reply, length))
+
+/**
+ * 'Q' command response format:
+ * Byte 0: Signature byte (0x00 = "speeduino")
+ * Byte 1: Status flags
+ * Byte 2: Number of pages
+ * Byte 3: Reserved
+ * 
+ * This is a simplified implementation.
+ * Real Speeduino sends more detailed status.
+ */
+static constexpr uint8_t STATUS_REPLY[4] PROGMEM = {
+    0x00,   // Signature byte
+    0x01,   // Status: running
+    0x01,   // Number of config pages (simplified)
+    0x00    // Reserved
+};
+
+/**
+ * 'V' command response:
+ * Returns firmware version string followed by newline
+ * Format: "speeduino YYYYMM.version"
+ * Example: "speeduino 202310.2.0"
+ * 
+ * The string terminator is not sent.
+ */
+static constexpr char VERSION_REPLY[] PROGMEM = "speeduino 202310-sim " FIRMWARE_VERSION "\n";
+static constexpr size_t VERSION_REPLY_LENGTH = sizeof(VERSION_REPLY) - 1;
+
+/**
+ * 'S' command response:
+ * Returns ECU signature for identification
+ * Format: 20 bytes signature, zero padded. The arrays hold one extra byte so
+ * a signature of exactly 20 characters still has room for its terminator;
+ * only SIGNATURE_REPLY_LENGTH bytes are ever sent.
+ * 
+ * This helps TunerStudio identify the ECU type. Each output channel layout
+ * has its own signature; the session's layout decides which one is sent.
+ */
+static constexpr size_t SIGNATURE_REPLY_LENGTH = 20;
+static_assert(sizeof(SPEEDUINO_SIGNATURE) - 1 <= SIGNATURE_REPLY_LENGTH,
+              "SPEEDUINO_SIGNATURE is longer than the 20-byte signature reply");
+static constexpr char SIGNATURE_REPLY[SIGNATURE_REPLY_LENGTH + 1] PROGMEM = SPEEDUINO_SIGNATURE;
+#if OUTPUT_LAYOUT_EXTENDED
+static_assert(sizeof(SPEEDUINO_SIGNATURE_EXTENDED) - 1 <= SIGNATURE_REPLY_LENGTH,
+              "SPEEDUINO_SIGNATURE_EXTENDED is longer than the 20-byte signature reply");
+static constexpr char SIGNATURE_REPLY_EXTENDED[SIGNATURE_REPLY_LENGTH + 1] PROGMEM = SPEEDUINO_SIGNATURE_EXTENDED;
+#endif
+
+/**
+ * 'n' command response:
+ * Returns the number and sizes of configuration pages
+ * 
+ * Format:
+ * Byte 0: Number of pages
+ * Bytes 1-2: Size of page 0 (little-endian)
+ * Bytes 3-4: Size of page 1 (little-endian)
+ * etc.
+ * 
+ * For simulator, we report minimal pages
+ */
+static constexpr uint8_t PAGE_SIZES_REPLY[7] PROGMEM = {
+    PAGE_COUNT,                             // Number of pages
+    PAGE_0_SIZE & 0xFF, PAGE_0_SIZE >> 8,   // Page 0: Settings page (288 bytes in real Speeduino, simplified to 32)
+    PAGE_1_SIZE & 0xFF, PAGE_1_SIZE >> 8,   // Page 1: Tuning page (256 bytes)
+    0, 0                                    // Page 2: Reserved
+};
+
+static constexpr uint32_t STATUS_REPLY_CRC = FRAMED_CRC(STATUS_REPLY, sizeof(STATUS_REPLY));
+static constexpr uint32_t VERSION_REPLY_CRC = FRAMED_CRC(VERSION_REPLY, VERSION_REPLY_LENGTH);
+static constexpr uint32_t SIGNATURE_REPLY_CRC = FRAMED_CRC(SIGNATURE_REPLY, SIGNATURE_REPLY_LENGTH);
+#if OUTPUT_LAYOUT_EXTENDED
+static constexpr uint32_t SIGNATURE_REPLY_EXTENDED_CRC = FRAMED_CRC(SIGNATURE_REPLY_EXTENDED,
+                                                                    SIGNATURE_REPLY_LENGTH);
+#endif
+
+// Signature reply (flash) of each output channel layout, nullptr if not built
+static const char* layoutSignature(OutputLayout layout, uint32_t* framedCrc) {
+    switch (layout) {
+        case LAYOUT_LEGACY:
+            *framedCrc = SIGNATURE_REPLY_CRC;
+            return SIGNATURE_REPLY;
+        #if OUTPUT_LAYOUT_EXTENDED
+        case LAYOUT_EXTENDED:
+            *framedCrc = SIGNATURE_REPLY_EXTENDED_CRC;
+            return SIGNATURE_REPLY_EXTENDED;
+        #endif
+        default:
+            *framedCrc = 0;
+            return nullptr;
+    }
+}
+static constexpr uint32_t PAGE_SIZES_REPLY_CRC = FRAMED_CRC(PAGE_SIZES_REPLY, sizeof(PAGE_SIZES_REPLY));
+
+void CommandTable::statusRequest(SpeeduinoProtocol& protocol, const uint8_t*) {
+    protocol.sendFlashResponse(STATUS_REPLY, sizeof(STATUS_REPLY), STATUS_REPLY_CRC);
+}
+
+void CommandTable::versionRequest(SpeeduinoProtocol& protocol, const uint8_t*) {
+    protocol.sendFlashResponse(reinterpret_cast<const uint8_t*>(VERSION_REPLY),
+                               VERSION_REPLY_LENGTH, VERSION_REPLY_CRC);
+}
+
+void CommandTable::signatureRequest(SpeeduinoProtocol& protocol, const uint8_t*) {
+    uint32_t framedCrc = SIGNATURE_REPLY_CRC;
+    const char* signature = layoutSignature(protocol.layout, &framedCrc);
+    if (signature == nullptr) {
+        signature = SIGNATURE_REPLY;
+        framedCrc = SIGNATURE_REPLY_CRC;
+    }
+    protocol.sendFlashResponse(reinterpret_cast<const uint8_t*>(signature),
+                               SIGNATURE_REPLY_LENGTH, framedCrc);
+}
+
+void CommandTable::selectSignature(SpeeduinoProtocol& protocol, const uint8_t* args) {
+    /**
+     * 's' command request format (20 argument bytes after 's'):
+     * Bytes 0-19: Signature of the wanted layout, zero padded as sent by 'S'
+     * 
+     * Switches this session's 'A'/'r'/'G' output channels (and the 'S'
+     * reply) to the layout with that signature. A running stream that no
+     * longer fits the layout is stopped.
+     * Response: output channel size of the layout (2 bytes, little-endian)
+     */
+    
+    for (uint8_t candidate = 0; candidate < LAYOUT_COUNT; candidate++) {
+        uint32_t framedCrc = 0;
+        const char* signature = layoutSignature(static_cast<OutputLayout>(candidate), &framedCrc);
+        if (signature == nullptr) {
+            continue;
+        }
+        
+        uint8_t i = 0;
+        while (i < SIGNATURE_REPLY_LENGTH && args[i] == pgm_read_byte(&signature[i])) {
+            i++;
+        }
+        if (i < SIGNATURE_REPLY_LENGTH) {
+            continue;
+        }
+        
+        protocol.layout = static_cast<OutputLayout>(candidate);
+        protocol.deltaBaseValid = false;
+        uint16_t size = EngineSnapshot::getChannelsSize(protocol.layout);
+        if ((uint32_t)protocol.streamOffset + protocol.streamLength > size) {
+            protocol.streaming = false;
+        }
+        
+        uint8_t response[2] = { static_cast<uint8_t>(size & 0xFF), static_cast<uint8_t>(size >> 8) };
+        protocol.sendResponse(response, sizeof(response));
+        return;
+    }
+    
+    protocol.sendError(SpeeduinoProtocol::RC_RANGE_ERROR);  // Unknown layout
+    protocol.errorCount++;
+}
+
+void CommandTable::pageSizesRequest(SpeeduinoProtocol& protocol, const uint8_t*) {
+    protocol.sendFlashResponse(PAGE_SIZES_REPLY, sizeof(PAGE_SIZES_REPLY), PAGE_SIZES_REPLY_CRC);
+}
+
+void CommandTable::diagnostics(SpeeduinoProtocol& protocol, const uint8_t* args) {
+    /**
+     * 'D' command request format (1 argument byte after 'D'):
+     * Byte 0: Command byte to report on
+     * 
+     * Response (multi-byte values little-endian):
+     * Byte 0: Number of latency buckets (N)
+     * Byte 1: Latency shift (bucket 0 < 1 << shift us, then doubling)
+     * Bytes 2-5: Times the command was handled
+     * Bytes 6..: N bucket counts, 4 bytes each
+     */
+    
+    uint8_t response[6 + 4 * PROTOCOL_LATENCY_BUCKETS];
+    uint32_t count = protocol.getCommandCount(args[0]);
+    
+    response[0] = PROTOCOL_LATENCY_BUCKETS;
+    response[1] = PROTOCOL_LATENCY_SHIFT;
+    for (uint8_t i = 0; i < 4; i++) {
+        response[2 + i] = static_cast<uint8_t>(count >> (8 * i));
+    }
+    for (uint8_t bucket = 0; bucket < PROTOCOL_LATENCY_BUCKETS; bucket++) {
+        uint32_t value = protocol.getLatencyCount(args[0], bucket);
+        for (uint8_t i = 0; i < 4; i++) {
+            response[6 + 4 * bucket + i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+    
+    protocol.sendResponse(response, sizeof(response));
+}
+
+void CommandTable::startStream(SpeeduinoProtocol& protocol, const uint8_t* args) {
+    /**
+     * 'G' command request format (5 argument bytes after 'G'):
+     * Byte 0: Interval in simulator ticks (0 is treated as 1)
+     * Bytes 1-2: Offset into the output channels (little-endian)
+     * Bytes 3-4: Length (little-endian, 0 = up to the end of the channels)
+     * 
+     * No direct reply: the first record (current snapshot) follows
+     * immediately and acknowledges the request. Records keep the framing
+     * mode of the 'G' request.
+     */
+    
+    uint16_t offset = args[1] | (static_cast<uint16_t>(args[2]) << 8);
+    uint16_t length = args[3] | (static_cast<uint16_t>(args[4]) << 8);
+    uint16_t size = EngineSnapshot::getChannelsSize(protocol.layout);
+    if (length == 0 && offset < size) {
+        length = size - offset;
+    }
+    
+    if (length == 0 || (uint32_t)offset + length > size) {
+        protocol.sendError(SpeeduinoProtocol::RC_RANGE_ERROR);
+        protocol.errorCount++;
+        return;
+    }
+    
+    protocol.streaming = true;
+    protocol.streamFramed = protocol.framedRequest;
+    protocol.streamInterval = (args[0] > 0) ? args[0] : 1;
+    protocol.streamOffset = offset;
+    protocol.streamLength = length;
+    
+    const EngineSnapshot& snapshot = protocol.simulator->getSnapshot();
+    protocol.sendStreamRecord(snapshot);
+}
+
+void CommandTable::stopStream(SpeeduinoProtocol& protocol, const uint8_t*) {
+    // Framed clients get an empty RC_OK frame marking the end of the
+    // stream; the legacy protocol has no reply
+    protocol.streaming = false;
+    if (protocol.framedRequest) {
+        protocol.sendResponse(nullptr, 0);
+    }
+}
+
+void CommandTable::readPage(SpeeduinoProtocol& protocol, const uint8_t* args) {
+    /**
+     * 'p' command request format (6 argument bytes after 'p'):
+     * Byte 0: CAN ID (ignored)
+     * Byte 1: Page number
+     * Bytes 2-3: Offset within the page (little-endian)
+     * Bytes 4-5: Length (little-endian)
+     * 
+     * Response: 'length' bytes of the page (RAM copy, including unburned
+     * changes)
+     */
+    
+    uint8_t page = args[1];
+    uint16_t offset = args[2] | (static_cast<uint16_t>(args[3]) << 8);
+    uint16_t length = args[4] | (static_cast<uint16_t>(args[5]) << 8);
+    
+    if (protocol.pageStore == nullptr || !PageStore::isValidRange(page, offset, length)) {
+        protocol.sendError(SpeeduinoProtocol::RC_RANGE_ERROR);
+        protocol.errorCount++;
+        return;
     }
     
-    return true;
+    protocol.sendResponseInPlace(protocol.pageStore->getPage(page) + offset, length);
 }
 
-void SpeeduinoProtocol::handleRealtimeData() {
-    // Get current engine status from simulator
-    const EngineStatus& status = simulator->getStatus();
+void CommandTable::writePage(SpeeduinoProtocol& protocol, const uint8_t* args) {
+    /**
+     * 'M' command request format (6 argument bytes + data after 'M'):
+     * Byte 0: CAN ID (ignored)
+     * Byte 1: Page number
+     * Bytes 2-3: Offset within the page (little-endian)
+     * Bytes 4-5: Length (little-endian)
+     * Bytes 6..: 'length' data bytes
+     * 
+     * Changes the RAM copy only; 'b'/'B' make it permanent.
+     * Response: none (legacy) / empty RC_OK frame (framed)
+     */
+    
+    uint8_t page = args[1];
+    uint16_t offset = args[2] | (static_cast<uint16_t>(args[3]) << 8);
+    uint16_t length = args[4] | (static_cast<uint16_t>(args[5]) << 8);
+    
+    // Replies queued earlier in this pass may reference the page in place
+    protocol.transmitQueued();
+    
+    if (protocol.pageStore == nullptr || !protocol.pageStore->write(page, offset, args + 6, length)) {
+        protocol.sendError(SpeeduinoProtocol::RC_RANGE_ERROR);
+        protocol.errorCount++;
+        return;
+    }
     
-    // Send entire structure as binary data
-    sendResponse((const uint8_t*)&status, sizeof(EngineStatus));
+    if (protocol.framedRequest) {
+        protocol.sendFrame(SpeeduinoProtocol::RC_OK, nullptr, 0);
+    }
 }
 
-void SpeeduinoProtocol::handleStatusRequest() {
+void CommandTable::burnPage(SpeeduinoProtocol& protocol, const uint8_t* args) {
     /**
-     * 'Q' command response format:
-     * Byte 0: Signature byte (0x00 = "speeduino")
-     * Byte 1: Status flags
-     * Byte 2: Number of pages
-     * Byte 3: Reserved
+     * 'b' command request format (2 argument bytes after 'b'):
+     * Byte 0: CAN ID (ignored)
+     * Byte 1: Page number
      * 
-     * This is a simplified implementation.
-     * Real Speeduino sends more detailed status.
+     * Writes the page's changed bytes to EEPROM/flash.
+     * Response: none (legacy) / empty RC_BURN_OK frame (framed)
      */
     
-    uint8_t response[4];
-    response[0] = 0x00;  // Signature byte
-    response[1] = 0x01;  // Status: running
-    response[2] = 0x01;  // Number of config pages (simplified)
-    response[3] = 0x00;  // Reserved
+    if (protocol.pageStore == nullptr || args[1] >= PAGE_COUNT) {
+        protocol.sendError(SpeeduinoProtocol::RC_RANGE_ERROR);
+        protocol.errorCount++;
+        return;
+    }
     
-    sendResponse(response, 4);
+    protocol.finishBurn(protocol.pageStore->burn(args[1]));
+}
+
+void CommandTable::burnAll(SpeeduinoProtocol& protocol, const uint8_t*) {
+    // 'B': burn every page with unburned changes
+    if (protocol.pageStore == nullptr) {
+        protocol.sendError(SpeeduinoProtocol::RC_RANGE_ERROR);
+        protocol.errorCount++;
+        return;
+    }
+    
+    protocol.finishBurn(protocol.pageStore->burnAll());
+}
+
+void CommandTable::startToothLog(SpeeduinoProtocol& protocol, const uint8_t*) {
+    protocol.setToothLogger(ToothLogMode::TOOTH);
+}
+
+void CommandTable::startCompositeLog(SpeeduinoProtocol& protocol, const uint8_t*) {
+    // 'X' is the cam variant of the composite logger in the real firmware;
+    // the simulated engine has no tertiary trigger, so both log the same
+    protocol.setToothLogger(ToothLogMode::COMPOSITE);
 }
 
-void SpeeduinoProtocol::handleVersionRequest() {
+void CommandTable::stopLogger(SpeeduinoProtocol& protocol, const uint8_t*) {
+    protocol.setToothLogger(ToothLogMode::OFF);
+}
+
+void CommandTable::toothLog(SpeeduinoProtocol& protocol, const uint8_t*) {
+    protocol.sendToothLog(ToothLogMode::TOOTH);
+}
+
+void CommandTable::compositeLog(SpeeduinoProtocol& protocol, const uint8_t*) {
+    protocol.sendToothLog(ToothLogMode::COMPOSITE);
+}
+
+// Link speeds accepted by 'u'
+static const uint32_t SUPPORTED_BAUD_RATES[] PROGMEM = { SERIAL_BAUD_RATES };
+
+void CommandTable::setBaudRate(SpeeduinoProtocol& protocol, const uint8_t* args) {
     /**
-     * 'V' command response:
-     * Returns firmware version string followed by newline
-     * Format: "speeduino YYYYMM.version"
-     * Example: "speeduino 202310.2.0"
+     * 'u' command request format (4 argument bytes after 'u'):
+     * Bytes 0-3: New baud rate (little-endian, one of SERIAL_BAUD_RATES)
+     * 
+     * Response (at the old rate): 0x00 (legacy) / empty RC_OK frame (framed).
+     * The client then switches its port and must send any other valid
+     * request within SERIAL_BAUD_CONFIRM_MS; otherwise the simulator returns
+     * to the old rate. Rejected (range error, no switch) on transports
+     * without a baud rate or without a time provider to time the fallback.
      */
     
-    const char* version = "speeduino 202310-sim " FIRMWARE_VERSION "\n";
-    sendString(version);
+    uint32_t requested = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        requested |= static_cast<uint32_t>(args[i]) << (8 * i);
+    }
+    
+    bool supported = false;
+    for (uint8_t i = 0; i < sizeof(SUPPORTED_BAUD_RATES) / sizeof(SUPPORTED_BAUD_RATES[0]); i++) {
+        if (pgm_read_dword(&SUPPORTED_BAUD_RATES[i]) == requested) {
+            supported = true;
+            break;
+        }
+    }
+    
+    if (!supported || protocol.timeProvider == nullptr) {
+        protocol.sendError(SpeeduinoProtocol::RC_RANGE_ERROR);
+        protocol.errorCount++;
+        return;
+    }
+    
+    protocol.switchBaudRate(requested);
 }
 
-void SpeeduinoProtocol::handleSignatureRequest() {
+void CommandTable::selfTest(SpeeduinoProtocol& protocol, const uint8_t* args) {
     /**
-     * 'S' command response:
-     * Returns ECU signature for identification
-     * Format: 20 bytes signature + version info
+     * 'l' command request format (2 argument bytes + data after 'l'):
+     * Bytes 0-1: Length N (little-endian)
+     * Bytes 2..: N bytes of selfTestPattern(0..N-1)
+     * 
+     * Response: number of received bytes that differed from the pattern
+     * (2 bytes, little-endian), followed by the N pattern bytes.
      * 
-     * This helps TunerStudio identify the ECU type
+     * The client checks the returned pattern, so one exchange measures
+     * corruption in both directions; timing repeated exchanges gives the
+     * link throughput.
      */
     
-    uint8_t signature[20];
-    memset(signature, 0, 20);
+    uint16_t length = args[0] | (static_cast<uint16_t>(args[1]) << 8);
+    const uint8_t* data = args + 2;
     
-    // Copy signature string (max 20 bytes)
-    const char* sigStr = SPEEDUINO_SIGNATURE;
-    size_t len = strlen(sigStr);
-    if (len > 20) len = 20;
-    memcpy(signature, sigStr, len);
+    uint16_t errors = 0;
+    uint8_t response[2 + PROTOCOL_RX_BUFFER_SIZE];
+    for (uint16_t i = 0; i < length; i++) {
+        uint8_t expected = SpeeduinoProtocol::selfTestPattern(i);
+        if (data[i] != expected) {
+            errors++;
+        }
+        response[2 + i] = expected;
+    }
+    response[0] = static_cast<uint8_t>(errors & 0xFF);
+    response[1] = static_cast<uint8_t>(errors >> 8);
     
-    sendResponse(signature, 20);
+    protocol.selfTestBytes += length;
+    protocol.selfTestErrors += errors;
+    protocol.sendResponse(response, 2 + length);
 }
 
-void SpeeduinoProtocol::handlePageSizesRequest() {
+void CommandTable::downloadLog(SpeeduinoProtocol& protocol, const uint8_t* args) {
     /**
-     * 'n' command response:
-     * Returns the number and sizes of configuration pages
+     * 'y' command request format (4 argument bytes after 'y'):
+     * Bytes 0-3: Log offset to start at (little-endian; 0 = from the
+     *            beginning, a later offset resumes an interrupted download)
      * 
-     * Format:
-     * Byte 0: Number of pages
-     * Bytes 1-2: Size of page 0 (little-endian)
-     * Bytes 3-4: Size of page 1 (little-endian)
-     * etc.
+     * No direct reply: chunks follow, one per loop pass while the transmit
+     * buffer has room (see serviceDownload()). They keep the framing mode
+     * of the 'y' request. A new 'y' restarts the download; an offset at or
+     * past the end stops it with the final chunk.
+     */
+    
+    if (protocol.frameLog == nullptr) {
+        protocol.sendError(SpeeduinoProtocol::RC_RANGE_ERROR);
+        protocol.errorCount++;
+        return;
+    }
+    
+    uint32_t offset = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        offset |= static_cast<uint32_t>(args[i]) << (8 * i);
+    }
+    
+    // Frames recorded meanwhile belong to the next download
+    protocol.downloading = true;
+    protocol.downloadFramed = protocol.framedRequest;
+    protocol.downloadEnd = protocol.frameLog->size();
+    protocol.downloadOffset = (offset < protocol.downloadEnd) ? offset : protocol.downloadEnd;
+}
+
+void CommandTable::clearLog(SpeeduinoProtocol& protocol, const uint8_t*) {
+    // Response: none (legacy) / empty RC_OK frame (framed); a download in
+    // progress ends without its final chunk
+    if (protocol.frameLog == nullptr || !protocol.frameLog->clear()) {
+        protocol.sendError(protocol.frameLog == nullptr ? SpeeduinoProtocol::RC_RANGE_ERROR
+                                                        : SpeeduinoProtocol::RC_BUSY_ERROR);
+        protocol.errorCount++;
+        return;
+    }
+    
+    protocol.downloading = false;
+    if (protocol.framedRequest) {
+        protocol.sendFrame(SpeeduinoProtocol::RC_OK, nullptr, 0);
+    }
+}
+
+// ============================================
+// Protocol Internals
+// ============================================
+
+void SpeeduinoProtocol::switchBaudRate(uint32_t newBaudRate) {
+    // The acknowledgement must leave at the old rate before the switch
+    if (framedRequest) {
+        sendFrame(RC_OK, nullptr, 0);
+    } else {
+        uint8_t ack = RC_OK;
+        sendResponse(&ack, 1);
+    }
+    transmitQueued();
+    serial->flush();
+    
+    if (!serial->setBaudRate(newBaudRate)) {
+        return;  // Transport without a baud rate: acknowledged, nothing to do
+    }
+    
+    if (!baudPending) {
+        fallbackBaudRate = baudRate;  // Keep the last confirmed rate
+    }
+    baudRate = newBaudRate;
+    baudPending = true;
+    baudSwitchTime = timeProvider->micros();
+    rxState = RX_IDLE;
+}
+
+void SpeeduinoProtocol::checkBaudRateFallback(uint32_t now) {
+    if (now - baudSwitchTime < SERIAL_BAUD_CONFIRM_MS * 1000UL) {
+        return;
+    }
+    
+    // The client never reached us at the new rate: go back to the old one
+    serial->flush();
+    serial->setBaudRate(fallbackBaudRate);
+    baudRate = fallbackBaudRate;
+    baudPending = false;
+    baudFallbackCount++;
+    rxState = RX_IDLE;
+}
+
+void SpeeduinoProtocol::finishBurn(bool burned) {
+    if (!burned) {
+        errorCount++;
+        sendError(RC_BUSY_ERROR);  // Storage failed, the page stays dirty
+    } else if (framedRequest) {
+        sendFrame(RC_BURN_OK, nullptr, 0);
+    }
+}
+
+void SpeeduinoProtocol::setToothLogger(ToothLogMode mode) {
+    // Response: none (legacy) / empty RC_OK frame (framed)
+    simulator->setToothLogMode(mode);
+    if (framedRequest) {
+        sendFrame(RC_OK, nullptr, 0);
+    }
+}
+
+void SpeeduinoProtocol::sendToothLog(ToothLogMode mode) {
+    /**
+     * 'T' / 'O' response: the TOOTH_LOG_SIZE oldest logged entries
+     * 'T': 4 bytes per entry, tooth gap in us (MSB first, as the firmware)
+     * 'O': 5 bytes per entry, timestamp in us (MSB first) followed by the
+     *      composite flags (CompositeLogBits)
+     * 
+     * Only sent once a full packet is logged (status1 bit 6 in the 'A'
+     * data); earlier requests get RC_BUSY_ERROR. Entries are encoded in
+     * small chunks straight into the transmit path, CRC included, so the
+     * reply is never staged in RAM as a whole.
+     * 
+     * The reply is always exactly TOOTH_LOG_SIZE entries, matching the
+     * frame header: entries the producer laps during the copy are dropped
+     * by read() and replaced with the next ones.
+     */
+    
+    ToothLog& log = simulator->getToothLog();
+    if (simulator->getToothLogMode() != mode) {
+        sendError(RC_RANGE_ERROR);  // That logger is not running
+        errorCount++;
+        return;
+    }
+    if (log.available() < TOOTH_LOG_SIZE) {
+        sendError(RC_BUSY_ERROR);
+        return;
+    }
+    
+    const uint8_t entrySize = (mode == ToothLogMode::COMPOSITE) ? 5 : 4;
+    const uint8_t chunkEntries = 8;
+    ToothLogEntry entries[chunkEntries];
+    uint8_t chunk[chunkEntries * 5];
+    
+    uint8_t returnCode = RC_OK;
+    uint32_t crc = Crc32::update(Crc32::begin(), &returnCode, 1);
+    if (framedRequest) {
+        writeFrameHeader(RC_OK, TOOTH_LOG_SIZE * entrySize);
+    }
+    
+    uint16_t sent = 0;
+    while (sent < TOOTH_LOG_SIZE) {
+        uint16_t wanted = TOOTH_LOG_SIZE - sent;
+        if (wanted > chunkEntries) {
+            wanted = chunkEntries;
+        }
+        uint16_t count = log.read(entries, wanted);
+        if (count == 0 && log.available() == 0) {
+            // Log cleared under us: pad rather than send a short packet
+            memset(entries, 0, sizeof(entries));
+            count = wanted;
+        }
+        
+        uint8_t* out = chunk;
+        for (uint16_t i = 0; i < count; i++) {
+            *out++ = static_cast<uint8_t>(entries[i].time >> 24);
+            *out++ = static_cast<uint8_t>(entries[i].time >> 16);
+            *out++ = static_cast<uint8_t>(entries[i].time >> 8);
+            *out++ = static_cast<uint8_t>(entries[i].time);
+            if (entrySize == 5) {
+                *out++ = entries[i].flags;
+            }
+        }
+        
+        crc = Crc32::update(crc, chunk, out - chunk);
+        queueCopy(chunk, out - chunk);
+        sent += count;
+    }
+    
+    if (framedRequest) {
+        writeFrameTrailer(Crc32::finish(crc));
+    }
+    finishResponse();
+}
+
+void SpeeduinoProtocol::serviceStream() {
+    const EngineSnapshot& snapshot = simulator->getSnapshot();
+    if (snapshot.generation - streamGeneration < streamInterval) {
+        return;
+    }
+    
+    // Never block the simulation behind a slow link: while the previous
+    // record is still draining, wait for the next pass. Ticks published in
+    // the meantime are skipped and show up as a sequence gap.
+    if (serial->pendingTransmit() > 0) {
+        return;
+    }
+    
+    sendStreamRecord(snapshot);
+}
+
+void SpeeduinoProtocol::sendStreamRecord(const EngineSnapshot& snapshot) {
+    /**
+     * Stream record format:
+     * Bytes 0-3: Sequence (snapshot generation, little-endian); advances by
+     *            the interval per record, a larger step means ticks were dropped
+     * Bytes 4..: Configured output channel subset (session layout)
+     */
+    
+    uint8_t record[4 + OUTPUT_CHANNELS_MAX_SIZE];
+    for (uint8_t i = 0; i < 4; i++) {
+        record[i] = static_cast<uint8_t>(snapshot.generation >> (8 * i));
+    }
+    memcpy(&record[4], snapshot.getChannels(layout) + streamOffset, streamLength);
+    
+    streamGeneration = snapshot.generation;
+    
+    bool wasFramed = framedRequest;
+    framedRequest = streamFramed;
+    sendResponse(record, 4 + streamLength);
+    framedRequest = wasFramed;
+}
+
+void SpeeduinoProtocol::serviceDownload() {
+    /**
+     * Log chunk format:
+     * Bytes 0-3: Offset of the chunk in the log (little-endian)
+     * Bytes 4-7: Log size when the download started (little-endian)
+     * Bytes 8-9: Data length N (little-endian, at most FRAME_LOG_CHUNK_SIZE;
+     *            0 = final chunk, the download is complete)
+     * Bytes 10..: N log bytes
+     * Last 4 bytes: CRC32 of bytes 0 to 9 + N (little-endian)
      * 
-     * For simulator, we report minimal pages
+     * The client appends chunks whose CRC matches at their offset and, after
+     * a gap or a bad chunk, resumes with 'y' at the first missing byte.
      */
     
-    uint8_t response[7];
-    response[0] = 2;         // Number of pages
+    // Queue a chunk only when it fits beside what is still draining, so
+    // the loop never blocks on the link
+    static const uint16_t CHUNK_OVERHEAD = 10 + 4 + 7;  // + frame header/trailer
+    static const size_t DRAIN_THRESHOLD =
+        (SERIAL_TX_RING_SIZE > FRAME_LOG_CHUNK_SIZE + CHUNK_OVERHEAD)
+            ? SERIAL_TX_RING_SIZE - (FRAME_LOG_CHUNK_SIZE + CHUNK_OVERHEAD) : 0;
+    if (serial->pendingTransmit() > DRAIN_THRESHOLD) {
+        return;
+    }
     
-    // Page 0: Settings page (288 bytes in real Speeduino)
-    response[1] = 32;        // Low byte (simplified to 32 bytes)
-    response[2] = 0;         // High byte
+    uint16_t length = 0;
+    uint32_t remaining = downloadEnd - downloadOffset;
+    const uint8_t* data = frameLog->read(downloadOffset, (remaining < FRAME_LOG_CHUNK_SIZE)
+                                                         ? remaining : FRAME_LOG_CHUNK_SIZE, &length);
     
-    // Page 1: Tuning page (256 bytes in real Speeduino)
-    response[3] = 0;         // Low byte (0 = 256)
-    response[4] = 1;         // High byte
+    uint8_t header[10];
+    for (uint8_t i = 0; i < 4; i++) {
+        header[i] = static_cast<uint8_t>(downloadOffset >> (8 * i));
+        header[4 + i] = static_cast<uint8_t>(downloadEnd >> (8 * i));
+    }
+    header[8] = static_cast<uint8_t>(length & 0xFF);
+    header[9] = static_cast<uint8_t>(length >> 8);
     
-    // Page 2: Reserved
-    response[5] = 0;
-    response[6] = 0;
+    uint32_t chunkCrc = Crc32::finish(Crc32::update(Crc32::update(Crc32::begin(), header, 10),
+                                                    data, length));
+    uint8_t trailer[4];
+    for (uint8_t i = 0; i < 4; i++) {
+        trailer[i] = static_cast<uint8_t>(chunkCrc >> (8 * i));
+    }
+    
+    // The data goes out straight from the log's chunk buffer
+    if (downloadFramed) {
+        uint8_t returnCode = RC_OK;
+        uint32_t crc = Crc32::update(Crc32::begin(), &returnCode, 1);
+        crc = Crc32::update(Crc32::update(crc, header, 10), data, length);
+        writeFrameHeader(RC_OK, sizeof(header) + length + sizeof(trailer));
+        queueCopy(header, sizeof(header));
+        queueSpan(data, length);
+        queueCopy(trailer, sizeof(trailer));
+        writeFrameTrailer(Crc32::finish(Crc32::update(crc, trailer, sizeof(trailer))));
+    } else {
+        queueCopy(header, sizeof(header));
+        queueSpan(data, length);
+        queueCopy(trailer, sizeof(trailer));
+    }
+    finishResponse();
     
-    sendResponse(response, 7);
+    downloadOffset += length;
+    if (length == 0) {
+        downloading = false;
+    }
+}
+
+void SpeeduinoProtocol::recordCommand(uint8_t slot) {
+    commandSlotCounts[slot]++;
+    
+    // A valid request that started after a baud rate switch confirms it
+    if (baudPending && slot != SLOT_UNKNOWN && (int32_t)(lastCommandTime - baudSwitchTime) > 0) {
+        baudPending = false;
+    }
+    
+    if (timeProvider == nullptr) {
+        return;
+    }
+    
+    // log2 bucket of the request-to-response latency
+    uint32_t latency = (timeProvider->micros() - lastCommandTime) >> PROTOCOL_LATENCY_SHIFT;
+    uint8_t bucket = 0;
+    while (latency > 0 && bucket < PROTOCOL_LATENCY_BUCKETS - 1) {
+        latency >>= 1;
+        bucket++;
+    }
+    
+    LatencyCount& counter = latencyHistogram[slot][bucket];
+    if (counter < (LatencyCount)~(LatencyCount)0) {
+        counter++;
+    }
 }
 
 void SpeeduinoProtocol::handleUnknownCommand(char cmd) {
@@ -180,17 +1336,199 @@ void SpeeduinoProtocol::handleUnknownCommand(char cmd) {
     #endif
     
     // Send error indicator (optional)
-    uint8_t error = 0xFF;
-    sendResponse(&error, 1);
+    sendError(RC_UNKNOWN_COMMAND);
 }
 
 void SpeeduinoProtocol::sendResponse(const uint8_t* data, size_t length) {
-    serial->write(data, length);
-    serial->flush();
+    if (framedRequest) {
+        sendFrame(RC_OK, data, length);
+        return;
+    }
+    
+    queueCopy(data, length);
+    finishResponse();
+}
+
+void SpeeduinoProtocol::sendResponseInPlace(const uint8_t* data, size_t length) {
+    // Like sendResponse(), but the data (snapshot, tune page) is referenced
+    // instead of copied and must stay unchanged until the pass is flushed
+    if (framedRequest) {
+        uint8_t returnCode = RC_OK;
+        uint32_t crc = Crc32::update(Crc32::begin(), &returnCode, 1);
+        writeFrameHeader(RC_OK, length);
+        queueSpan(data, length);
+        writeFrameTrailer(Crc32::finish(Crc32::update(crc, data, length)));
+    } else {
+        queueSpan(data, length);
+    }
+    finishResponse();
+}
+
+void SpeeduinoProtocol::sendError(uint8_t returnCode) {
+    if (framedRequest) {
+        sendFrame(returnCode, nullptr, 0);
+        return;
+    }
+    
+    // Legacy protocol has a single error indicator
+    uint8_t error = 0xFF;
+    queueCopy(&error, 1);
+    finishResponse();
+}
+
+void SpeeduinoProtocol::sendFrame(uint8_t returnCode, const uint8_t* data, size_t length) {
+    /**
+     * Framed response format:
+     * Bytes 0-1: Payload size (big-endian, return code + data)
+     * Byte 2: Return code
+     * Bytes 3..: Data (written straight from the caller's buffer)
+     * Last 4 bytes: CRC32 of return code + data (big-endian)
+     */
+    
+    uint32_t crc = Crc32::update(Crc32::begin(), &returnCode, 1);
+    crc = Crc32::finish(Crc32::update(crc, data, length));
+    
+    writeFrameHeader(returnCode, length);
+    queueCopy(data, length);
+    writeFrameTrailer(crc);
+    finishResponse();
+}
+
+void SpeeduinoProtocol::sendFlashResponse(const uint8_t* flashData, size_t length, uint32_t framedCrc) {
+    if (framedRequest) {
+        writeFrameHeader(RC_OK, length);
+        writeFlash(flashData, length);
+        writeFrameTrailer(framedCrc);
+    } else {
+        writeFlash(flashData, length);
+    }
+    finishResponse();
+}
+
+void SpeeduinoProtocol::writeFlash(const uint8_t* flashData, size_t length) {
+    #if PGM_DIRECT_ACCESS
+        queueSpan(flashData, length);
+    #else
+        // Separate flash address space: hand bytes to the driver one at a
+        // time instead of staging the reply in RAM
+        for (size_t i = 0; i < length; i++) {
+            uint8_t byte = pgm_read_byte(&flashData[i]);
+            queueCopy(&byte, 1);
+        }
+    #endif
+}
+
+void SpeeduinoProtocol::writeFrameHeader(uint8_t returnCode, size_t length) {
+    uint16_t size = length + 1;  // Return code + data
+    uint8_t header[3] = {
+        static_cast<uint8_t>(size >> 8),
+        static_cast<uint8_t>(size & 0xFF),
+        returnCode
+    };
+    queueCopy(header, sizeof(header));
+}
+
+void SpeeduinoProtocol::writeFrameTrailer(uint32_t crc) {
+    uint8_t trailer[4] = {
+        static_cast<uint8_t>(crc >> 24),
+        static_cast<uint8_t>(crc >> 16),
+        static_cast<uint8_t>(crc >> 8),
+        static_cast<uint8_t>(crc)
+    };
+    queueCopy(trailer, sizeof(trailer));
+}
+
+void SpeeduinoProtocol::finishResponse() {
+    // Gathered responses are flushed once per pass (flushResponses())
+    #if PROTOCOL_TX_SPANS == 0
+        // Queued transports drain in pollTransmit(); only block when writes are direct
+        if (!serial->isAsyncTransmit()) {
+            serial->flush();
+        }
+    #endif
 }
 
 void SpeeduinoProtocol::sendString(const char* str) {
-    size_t len = strlen(str);
-    serial->write((const uint8_t*)str, len);
-    serial->flush();
+    sendResponse((const uint8_t*)str, strlen(str));
+}
+
+// ============================================
+// Response Gathering
+// ============================================
+
+void SpeeduinoProtocol::queueSpan(const uint8_t* data, size_t length) {
+    #if PROTOCOL_TX_SPANS > 0
+        if (length == 0) {
+            return;
+        }
+        
+        // Continue the last piece when the data follows it in memory
+        // (copies in the scratch area, header + ranged read + trailer)
+        if (txSpanCount > 0) {
+            SerialSpan& last = txSpans[txSpanCount - 1];
+            if (last.data + last.length == data) {
+                last.length += length;
+                return;
+            }
+        }
+        
+        if (txSpanCount == PROTOCOL_TX_SPANS) {
+            transmitQueued();
+        }
+        txSpans[txSpanCount].data = data;
+        txSpans[txSpanCount].length = length;
+        txSpanCount++;
+    #else
+        if (length > 0) {
+            serial->write(data, length);
+        }
+    #endif
+}
+
+void SpeeduinoProtocol::queueCopy(const uint8_t* data, size_t length) {
+    #if PROTOCOL_TX_SPANS > 0
+        if (length == 0) {
+            return;
+        }
+        if (length > PROTOCOL_TX_SCRATCH_SIZE) {
+            // Too big to keep: send it with what is queued, still one write
+            queueSpan(data, length);
+            transmitQueued();
+            return;
+        }
+        
+        // Make room first, so the copy and its span are never separated by a flush
+        if (length > static_cast<size_t>(PROTOCOL_TX_SCRATCH_SIZE - txScratchUsed) || txSpanCount == PROTOCOL_TX_SPANS) {
+            transmitQueued();
+        }
+        uint8_t* copy = &txScratch[txScratchUsed];
+        memcpy(copy, data, length);
+        txScratchUsed += length;
+        queueSpan(copy, length);
+    #else
+        queueSpan(data, length);
+    #endif
+}
+
+void SpeeduinoProtocol::transmitQueued() {
+    #if PROTOCOL_TX_SPANS > 0
+        if (txSpanCount > 0) {
+            serial->writeSpans(txSpans, txSpanCount);
+            txUnflushed = true;
+        }
+        txSpanCount = 0;
+        txScratchUsed = 0;
+    #endif
+}
+
+void SpeeduinoProtocol::flushResponses() {
+    #if PROTOCOL_TX_SPANS > 0
+        transmitQueued();
+        
+        // Queued transports drain in pollTransmit(); only block when writes are direct
+        if (txUnflushed && !serial->isAsyncTransmit()) {
+            serial->flush();
+        }
+        txUnflushed = false;
+    #endif
 }
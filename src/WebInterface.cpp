@@ -132,6 +132,10 @@ void WebInterface::setupRoutes() {
         handleStatistics(request);
     });
     
+    server->on("/api/latency", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleLatency(request);
+    });
+    
     server->on("/api/setmode", HTTP_POST, [this](AsyncWebServerRequest* request) {
         handleSetMode(request);
     });
@@ -162,6 +166,11 @@ void WebInterface::handleStatistics(AsyncWebServerRequest* request) {
     request->send(200, "application/json", json);
 }
 
+void WebInterface::handleLatency(AsyncWebServerRequest* request) {
+    String json = getLatencyJSON();
+    request->send(200, "application/json", json);
+}
+
 void WebInterface::handleSetMode(AsyncWebServerRequest* request) {
     if (request->hasParam("mode", true)) {
         String modeStr = request->getParam("mode", true)->value();
@@ -333,7 +342,8 @@ String WebInterface::getStatusJSON() {
 }
 
 String WebInterface::getRealtimeJSON() {
-    const EngineStatus& status = simulator->getStatus();
+    const EngineSnapshot& snapshot = simulator->getSnapshot();
+    const EngineStatus& status = snapshot.status;
     
     StaticJsonDocument<512> doc;
     
@@ -347,6 +357,7 @@ String WebInterface::getRealtimeJSON() {
     doc["pw"] = status.getPulseWidth() / 10.0;
     doc["battery"] = status.batteryv / 10.0;
     doc["ve"] = status.ve;
+    doc["generation"] = snapshot.generation;
     
     String output;
     serializeJson(doc, output);
@@ -372,6 +383,51 @@ String WebInterface::getStatisticsJSON() {
     doc["runtime"] = simulator->getRuntime();
     doc["commands"] = protocol->getCommandCount();
     doc["errors"] = protocol->getErrorCount();
+    doc["baudRate"] = protocol->getBaudRate();
+    doc["toothLogDropped"] = simulator->getToothLog().getDropped();
+    doc["catchUpSteps"] = simulator->getCatchUpSteps();
+    doc["skippedSteps"] = simulator->getSkippedSteps();
+    doc["clampedUpdates"] = simulator->getClampedUpdates();
+    
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+static_assert(PROTOCOL_COMMAND_SLOTS <= 32, "getLatencyJSON() tracks slots in a 32-bit mask");
+
+String WebInterface::getLatencyJSON() {
+    DynamicJsonDocument doc(4096);
+    
+    JsonArray floors = doc.createNestedArray("bucketFloorUs");
+    for (uint8_t bucket = 0; bucket < SpeeduinoProtocol::LATENCY_BUCKETS; bucket++) {
+        floors.add(SpeeduinoProtocol::getLatencyBucketFloorUs(bucket));
+    }
+    
+    // One entry per statistics slot that has seen traffic (aliases and
+    // unknown bytes share slots, so report each slot once)
+    JsonArray commands = doc.createNestedArray("commands");
+    uint32_t reportedSlots = 0;
+    for (uint16_t command = 0; command < 256; command++) {
+        uint8_t slot = protocol->getCommandSlot(command);
+        if ((reportedSlots & (1UL << slot)) || protocol->getCommandCount(command) == 0) {
+            continue;
+        }
+        reportedSlots |= 1UL << slot;
+        
+        JsonObject entry = commands.createNestedObject();
+        if (slot == 0) {
+            entry["command"] = "unknown";
+        } else {
+            char name[2] = { static_cast<char>(command), '\0' };
+            entry["command"] = name;
+        }
+        entry["count"] = protocol->getCommandCount(command);
+        JsonArray histogram = entry.createNestedArray("latency");
+        for (uint8_t bucket = 0; bucket < SpeeduinoProtocol::LATENCY_BUCKETS; bucket++) {
+            histogram.add(protocol->getLatencyCount(command, bucket));
+        }
+    }
     
     String output;
     serializeJson(doc, output);
@@ -9,8 +9,10 @@
  * 
  * Features:
  * - Realistic I4 engine simulation
- * - Speeduino protocol compatibility (commands A, Q, V, S, n)
+ * - Speeduino protocol compatibility (commands A, r, e, Q, V, S/s, n, D, G/g, p, M, b/B, H/h/T, J/j/X/x/O, u, l, y/Y)
  * - Web interface for monitoring and control (ESP only)
+ * - Speeduino protocol over TCP, several clients at once (ESP only)
+ * - Onboard frame log, downloadable with 'y' (ESP only)
  * - Platform-specific optimizations
  */
 
@@ -21,12 +23,18 @@
 #include "EngineStatus.h"
 #include "EngineSimulator.h"
 #include "SpeeduinoProtocol.h"
+#include "PageStore.h"
+#include "FrameLog.h"
 #include "PlatformAdapters.h"
 
 #ifdef ENABLE_WEB_INTERFACE
   #include "WebInterface.h"
 #endif
 
+#ifdef ENABLE_WIFI
+  #include "ProtocolServer.h"
+#endif
+
 //NodeMCU 12 with OLED
 #include <Wire.h>
 #include <U8x8lib.h>
@@ -37,13 +45,20 @@ U8X8_SSD1306_128X64_NONAME_SW_I2C u8x8(/* clock=*/ 12, /* data=*/ 14, /* reset=*
 ISerialInterface* serialInterface = nullptr;
 ITimeProvider* timeProvider = nullptr;
 IRandomProvider* randomProvider = nullptr;
+INonVolatileStorage* tuneStorage = nullptr;
+PageStore* pageStore = nullptr;
 EngineSimulator* engineSimulator = nullptr;
 SpeeduinoProtocol* protocol = nullptr;
+FrameLog* frameLog = nullptr;
 
 #ifdef ENABLE_WEB_INTERFACE
   WebInterface* webInterface = nullptr;
 #endif
 
+#ifdef ENABLE_WIFI
+  ProtocolServer* protocolServer = nullptr;
+#endif
+
 // Status LED pin (if available)
 #ifdef LED_BUILTIN
   #define STATUS_LED LED_BUILTIN
@@ -118,12 +133,39 @@ void setup() {
     engineSimulator->initialize();
     Serial.println("✓ Engine simulator ready");
     
+    // Load the burned tune (pages stay in RAM only without storage)
+    Serial.println("Loading tune pages...");
+    tuneStorage = createStorage();
+    pageStore = new PageStore(tuneStorage);
+    if (pageStore->begin()) {
+        Serial.println("✓ Burned tune loaded");
+    } else {
+        Serial.println("✓ No burned tune, using defaults");
+    }
+    
     // Create protocol handler
     Serial.println("Initializing protocol handler...");
-    protocol = new SpeeduinoProtocol(serialInterface, engineSimulator);
+    protocol = new SpeeduinoProtocol(serialInterface, engineSimulator, timeProvider, pageStore);
     protocol->begin();
     Serial.println("✓ Protocol handler ready");
     
+    // Record frames for 'y' download where there is a file system for them
+    IFrameLogStorage* frameLogStorage = createFrameLogStorage();
+    if (frameLogStorage != nullptr) {
+        frameLog = new FrameLog(engineSimulator, frameLogStorage);
+        if (frameLog->begin()) {
+            protocol->setFrameLog(frameLog);
+            Serial.print("✓ Frame log ready (");
+            Serial.print(frameLog->size());
+            Serial.println(" bytes recorded)");
+        } else {
+            Serial.println("✗ Frame log storage failed");
+            delete frameLog;
+            delete frameLogStorage;
+            frameLog = nullptr;
+        }
+    }
+    
     #ifdef ENABLE_WEB_INTERFACE
         // Initialize web interface (ESP32/ESP8266 only)
         Serial.println("Initializing web interface...");
@@ -148,9 +190,25 @@ void setup() {
         }
     #endif
     
+    #ifdef ENABLE_WIFI
+        // TunerStudio, dashes and loggers over WiFi, each with its own session
+        protocolServer = new ProtocolServer(engineSimulator, timeProvider, pageStore);
+        protocolServer->setFrameLog(frameLog);
+        if (protocolServer->listen(PROTOCOL_TCP_PORT)) {
+            Serial.print("✓ Protocol on TCP port ");
+            Serial.println(PROTOCOL_TCP_PORT);
+        }
+    #endif
+    
     Serial.println("\nSimulator started!");
     Serial.println("Waiting for commands on serial port...\n");
     
+    // Queue responses instead of blocking loop() until each frame leaves the
+    // UART. From here on the protocol owns the port: direct Serial prints
+    // would bypass the TX ring and land inside a queued frame.
+    Serial.flush();
+    serialInterface->setAsyncTransmit(true);
+    
     // LED off to indicate ready
     #if STATUS_LED >= 0
         digitalWrite(STATUS_LED, LOW);
@@ -167,10 +225,12 @@ void loop() {
     
     // Update engine simulation
     if (engineSimulator->update()) {
-        // State changed, print status on Arduino (not on ESP to avoid spam)
+        // State changed, print status on Arduino (not on ESP to avoid spam),
+        // only until a client talks and never over a queued response
         #ifdef MINIMAL_FEATURES
             static uint32_t lastPrint = 0;
-            if (millis() - lastPrint > 5000) {  // Every 5 seconds
+            if (millis() - lastPrint > 5000 &&  // Every 5 seconds
+                protocol->getCommandCount() == 0 && serialInterface->pendingTransmit() == 0) {
                 const EngineStatus& status = engineSimulator->getStatus();
                 Serial.print("Mode: ");
                 Serial.print((int)engineSimulator->getMode());
@@ -186,8 +246,14 @@ void loop() {
         #endif
     }
     
-    // Process serial commands
-    if (protocol->processCommands()) {
+    // Record the new snapshot when a frame is due
+    if (frameLog != nullptr) {
+        frameLog->update();
+    }
+    
+    // Process serial commands (drains the RX buffer up to the per-call budget)
+    uint8_t commandsHandled = protocol->processCommands();
+    if (commandsHandled > 0) {
         lastActivityTime = millis();
         ledState = true;
         
@@ -204,9 +270,24 @@ void loop() {
         #endif
     }
     
+    #ifdef ENABLE_WIFI
+        // TCP sessions: parse all clients, then one write per client
+        if (protocolServer->update() > 0) {
+            lastActivityTime = millis();
+        }
+    #endif
+    
     #ifdef ENABLE_WEB_INTERFACE
-        // Update web interface
-        webInterface->update();
+        // Update web interface, unless the budget ran out mid-burst and
+        // more commands are already waiting to be answered (at most
+        // PROTOCOL_MAX_WEB_SKIPS passes in a row, so the UI always gets a turn)
+        static uint8_t webSkips = 0;
+        if (protocol->isBudgetExhausted() && webSkips < PROTOCOL_MAX_WEB_SKIPS) {
+            webSkips++;
+        } else {
+            webSkips = 0;
+            webInterface->update();
+        }
     #endif
     
     // Yield to other tasks (important for ESP8266)
@@ -7,33 +7,61 @@
  */
 
 #include <unity.h>
+#include <stdio.h>
+#include <stddef.h>
 #include "../include/EngineSimulator.h"
 #include "../include/SpeeduinoProtocol.h"
 #include "../include/PlatformAdapters.h"
+#include "../include/Crc32.h"
+#include "../include/PageStore.h"
+#include "../include/ProtocolServer.h"
+#include "../include/FrameLog.h"
+#include "../include/FixedPoint.h"
+#include "../include/FastRandom.h"
 
 // Mock serial for protocol testing
 class MockSerial : public ISerialInterface {
 private:
-    uint8_t inputBuffer[256];
+    uint8_t inputBuffer[512];
     size_t inputSize = 0;
     size_t inputPos = 0;
+    size_t availableLimit = (size_t)-1;   // Bytes "arrived" so far (split delivery)
     
-    uint8_t outputBuffer[512];
+    uint8_t outputBuffer[1024];
     size_t outputSize = 0;
     
+    // Transmit emulation: flush() waits for unflushed bytes at flushCostUs each
+    bool asyncTx = false;
+    uint32_t flushCostUs = 0;
+    size_t unflushed = 0;
+    uint32_t flushCount = 0;
+    uint32_t pollCount = 0;
+    uint32_t gatherCount = 0;
+    bool ready = true;
+    uint32_t baudRate = 0;
+    
 public:
-    void begin(uint32_t) override {}
+    void begin(uint32_t baud) override {
+        baudRate = baud;
+    }
     
-    bool isReady() override {
+    bool setBaudRate(uint32_t baud) override {
+        baudRate = baud;
+        inputPos = inputSize;   // Unread input is lost while switching
         return true;
     }
     
+    bool isReady() override {
+        return ready;
+    }
+    
     int available() override {
-        return inputSize - inputPos;
+        size_t arrived = (inputSize < availableLimit) ? inputSize : availableLimit;
+        return (inputPos < arrived) ? arrived - inputPos : 0;
     }
     
     int read() override {
-        if (inputPos < inputSize) {
+        if (available() > 0) {
             return inputBuffer[inputPos++];
         }
         return -1;
@@ -41,7 +69,7 @@ public:
     
     size_t readBytes(uint8_t* buffer, size_t length) override {
         size_t count = 0;
-        while (count < length && inputPos < inputSize) {
+        while (count < length && available() > 0) {
             buffer[count++] = inputBuffer[inputPos++];
         }
         return count;
@@ -50,6 +78,7 @@ public:
     size_t write(uint8_t byte) override {
         if (outputSize < sizeof(outputBuffer)) {
             outputBuffer[outputSize++] = byte;
+            unflushed++;
             return 1;
         }
         return 0;
@@ -61,11 +90,47 @@ public:
             outputBuffer[outputSize++] = buffer[i];
             written++;
         }
+        unflushed += written;
         return written;
     }
     
+    size_t writeSpans(const SerialSpan* spans, uint8_t count) override {
+        gatherCount++;
+        return ISerialInterface::writeSpans(spans, count);
+    }
+    
     void flush() override {
-        // No-op for mock
+        flushCount++;
+        if (flushCostUs > 0) {
+            delayMicroseconds(unflushed * flushCostUs);
+        }
+        unflushed = 0;
+    }
+    
+    bool setAsyncTransmit(bool enabled) override {
+        asyncTx = enabled;
+        return true;
+    }
+    
+    bool isAsyncTransmit() const override {
+        return asyncTx;
+    }
+    
+    void pollTransmit() override {
+        pollCount++;
+    }
+    
+    void setFlushCost(uint32_t usPerByte) {
+        flushCostUs = usPerByte;
+    }
+    
+    uint32_t getFlushCount() const { return flushCount; }
+    uint32_t getPollCount() const { return pollCount; }
+    uint32_t getGatherCount() const { return gatherCount; }
+    uint32_t getBaudRate() const { return baudRate; }
+    
+    void setReady(bool isReady) {
+        ready = isReady;
     }
     
     void addInput(uint8_t byte) {
@@ -78,20 +143,141 @@ public:
         outputSize = 0;
     }
     
+    void setAvailableLimit(size_t bytes) {
+        availableLimit = bytes;
+    }
+    
     void clear() {
         inputSize = 0;
         inputPos = 0;
         outputSize = 0;
+        availableLimit = (size_t)-1;
     }
     
     size_t getOutputSize() const { return outputSize; }
     const uint8_t* getOutput() const { return outputBuffer; }
 };
 
+// Mock tune storage: EEPROM/flash stand-in with per-cell wear counters
+class MockStorage : public INonVolatileStorage {
+private:
+    uint8_t cells[PAGE_STORAGE_SIZE];
+    uint16_t wear[PAGE_STORAGE_SIZE];   // Writes per cell
+    uint32_t writeCostUs = 0;           // Simulated cell write time
+    uint32_t commitCount = 0;
+    
+public:
+    MockStorage() {
+        memset(cells, 0xFF, sizeof(cells));  // Erased
+        memset(wear, 0, sizeof(wear));
+    }
+    
+    bool begin() override {
+        return true;
+    }
+    
+    uint8_t read(uint16_t address) override {
+        return (address < sizeof(cells)) ? cells[address] : 0xFF;
+    }
+    
+    bool write(uint16_t address, const uint8_t* data, uint16_t length) override {
+        if ((uint32_t)address + length > sizeof(cells)) {
+            return false;
+        }
+        for (uint16_t i = 0; i < length; i++) {
+            cells[address + i] = data[i];
+            wear[address + i]++;
+        }
+        if (writeCostUs > 0) {
+            delayMicroseconds(length * writeCostUs);
+        }
+        return true;
+    }
+    
+    bool commit() override {
+        commitCount++;
+        return true;
+    }
+    
+    void setWriteCost(uint32_t usPerByte) {
+        writeCostUs = usPerByte;
+    }
+    
+    uint16_t getWear(uint16_t address) const { return wear[address]; }
+    
+    uint32_t getTotalWear() const {
+        uint32_t total = 0;
+        for (uint16_t i = 0; i < PAGE_STORAGE_SIZE; i++) {
+            total += wear[i];
+        }
+        return total;
+    }
+    
+    uint16_t getMaxWear() const {
+        uint16_t max = 0;
+        for (uint16_t i = 0; i < PAGE_STORAGE_SIZE; i++) {
+            if (wear[i] > max) max = wear[i];
+        }
+        return max;
+    }
+    
+    uint32_t getCommitCount() const { return commitCount; }
+};
+
+// Mock frame log file: RAM stand-in with an adjustable capacity
+class MockFrameLogStorage : public IFrameLogStorage {
+private:
+    uint8_t data[4096];
+    uint32_t length = 0;
+    uint32_t capacity = sizeof(data);
+    
+public:
+    bool begin() override {
+        return true;
+    }
+    
+    uint32_t size() override {
+        return length;
+    }
+    
+    bool append(const uint8_t* bytes, uint16_t count) override {
+        if (length + count > capacity) {
+            return false;
+        }
+        memcpy(&data[length], bytes, count);
+        length += count;
+        return true;
+    }
+    
+    uint16_t read(uint32_t offset, uint8_t* buffer, uint16_t count) override {
+        if (offset >= length) {
+            return 0;
+        }
+        if (count > length - offset) {
+            count = length - offset;
+        }
+        memcpy(buffer, &data[offset], count);
+        return count;
+    }
+    
+    bool clear() override {
+        length = 0;
+        return true;
+    }
+    
+    void setCapacity(uint32_t bytes) {
+        capacity = (bytes < sizeof(data)) ? bytes : sizeof(data);
+    }
+    
+    const uint8_t* getData() const { return data; }
+};
+
 // Global test fixtures
 EngineSimulator* simulator = nullptr;
 SpeeduinoProtocol* protocol = nullptr;
 MockSerial* mockSerial = nullptr;
+MockStorage* mockStorage = nullptr;
+PageStore* pageStore = nullptr;
 ITimeProvider* timeProvider = nullptr;
 IRandomProvider* randomProvider = nullptr;
 
@@ -102,11 +288,15 @@ void setUp(void) {
     
     simulator = new EngineSimulator(timeProvider, randomProvider);
     mockSerial = new MockSerial();
-    protocol = new SpeeduinoProtocol(mockSerial, simulator);
+    mockStorage = new MockStorage();
+    pageStore = new PageStore(mockStorage);
+    protocol = new SpeeduinoProtocol(mockSerial, simulator, timeProvider, pageStore);
 }
 
 void tearDown(void) {
     delete protocol;
+    delete pageStore;
+    delete mockStorage;
     delete simulator;
     delete mockSerial;
     delete randomProvider;
@@ -200,6 +390,118 @@ void test_engine_status_size() {
     TEST_ASSERT_EQUAL(79, sizeof(EngineStatus));
 }
 
+void test_snapshot_generation_increments() {
+    simulator->initialize();
+    uint32_t initial = simulator->getGeneration();
+    TEST_ASSERT_GREATER_THAN(0, initial);
+    
+    // No tick due yet: nothing new published
+    simulator->update();
+    TEST_ASSERT_EQUAL(initial, simulator->getGeneration());
+    
+    delay(UPDATE_INTERVAL_MS);
+    TEST_ASSERT_TRUE(simulator->update());
+    TEST_ASSERT_EQUAL(initial + 1, simulator->getGeneration());
+}
+
+void test_snapshot_stable_across_update() {
+    simulator->initialize();
+    simulator->setMode(EngineMode::ACCELERATION);
+    
+    // Hold a reference to the published frame while the next tick runs
+    const EngineSnapshot& held = simulator->getSnapshot();
+    EngineStatus copy = held.status;
+    uint32_t heldGeneration = held.generation;
+    
+    delay(UPDATE_INTERVAL_MS);
+    simulator->update();
+    
+    TEST_ASSERT_NOT_EQUAL(heldGeneration, simulator->getGeneration());
+    TEST_ASSERT_EQUAL(heldGeneration, held.generation);
+    TEST_ASSERT_EQUAL_MEMORY(&copy, &held.status, sizeof(EngineStatus));
+}
+
+void test_update_catches_up_late_steps() {
+    simulator->initialize();
+    uint32_t start = timeProvider->millis();
+    uint32_t generation = simulator->getGeneration();
+    
+    // Three ticks due: every step simulated, one snapshot published
+    delay(3 * UPDATE_INTERVAL_MS + UPDATE_INTERVAL_MS / 2);
+    TEST_ASSERT_TRUE(simulator->update());
+    uint32_t expected = (timeProvider->millis() - start) / SIM_STEP_MS;
+    TEST_ASSERT_UINT32_WITHIN(1, expected, simulator->getStepCount());
+    TEST_ASSERT_EQUAL(generation + 1, simulator->getGeneration());
+    TEST_ASSERT_EQUAL(simulator->getStepCount() - 1, simulator->getCatchUpSteps());
+    
+    // A loop slower than the step still keeps simulated time on wall time;
+    // what is short of a step carries over
+    for (int i = 0; i < 10; i++) {
+        delay(SIM_STEP_MS * 3 / 2 + 1);
+        simulator->update();
+    }
+    expected = (timeProvider->millis() - start) / SIM_STEP_MS;
+    TEST_ASSERT_UINT32_WITHIN(1, expected, simulator->getStepCount());
+    TEST_ASSERT_EQUAL(0, simulator->getSkippedSteps());
+}
+
+void test_update_clamps_long_stall() {
+    simulator->initialize();
+    uint32_t start = timeProvider->millis();
+    
+    delay((UPDATE_MAX_STEPS + 4) * SIM_STEP_MS + SIM_STEP_MS / 2);
+    TEST_ASSERT_TRUE(simulator->update());
+    uint32_t due = (timeProvider->millis() - start) / SIM_STEP_MS;
+    TEST_ASSERT_EQUAL(UPDATE_MAX_STEPS, simulator->getStepCount());
+    TEST_ASSERT_EQUAL(UPDATE_MAX_STEPS - 1, simulator->getCatchUpSteps());
+    TEST_ASSERT_UINT32_WITHIN(1, due - UPDATE_MAX_STEPS, simulator->getSkippedSteps());
+    TEST_ASSERT_EQUAL(1, simulator->getClampedUpdates());
+    
+    // Dropped time is not made up later
+    simulator->update();
+    TEST_ASSERT_LESS_OR_EQUAL(UPDATE_MAX_STEPS + 1, simulator->getStepCount());
+    
+    // Nor does it count toward the time spent in a mode: cranking lasts
+    // over a second of simulated steps, however long the stall
+    simulator->initialize();
+    for (uint8_t i = 0; i < 1000 / (UPDATE_MAX_STEPS * SIM_STEP_MS) + 2; i++) {
+        delay(2 * UPDATE_MAX_STEPS * SIM_STEP_MS);
+        simulator->update();
+        if (simulator->getStepCount() * SIM_STEP_MS <= 1000) {
+            TEST_ASSERT_EQUAL(EngineMode::STARTUP, simulator->getMode());
+        }
+    }
+}
+
+void test_stage_schedule() {
+    // Every stage runs on whole steps; the crank is followed at least as
+    // closely as the temperatures
+    for (uint8_t stage = 0; stage < STAGE_COUNT; stage++) {
+        uint16_t period = EngineSimulator::getStagePeriodMs((SimStage)stage);
+        TEST_ASSERT_GREATER_OR_EQUAL(SIM_STEP_MS, period);
+        TEST_ASSERT_EQUAL(0, period % SIM_STEP_MS);
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(EngineSimulator::getStagePeriodMs(STAGE_THERMAL),
+                              EngineSimulator::getStagePeriodMs(STAGE_RPM));
+    TEST_ASSERT_EQUAL(0, EngineSimulator::getStagePeriodMs(STAGE_COUNT));
+}
+
+void test_rpm_ramp_at_stage_rate() {
+    simulator->initialize();
+    simulator->setMode(EngineMode::LIGHT_LOAD);  // 200 RPM/s toward cruise
+    
+    for (int i = 0; i < 10; i++) {
+        delay(UPDATE_INTERVAL_MS);
+        simulator->update();
+    }
+    
+    // Sub-RPM steps of a short stage period add up instead of truncating
+    const EngineStatus& status = simulator->getStatus();
+    uint32_t expected = 200UL * simulator->getStepCount() * SIM_STEP_MS / 1000;
+    TEST_ASSERT_GREATER_THAN(0, expected);
+    TEST_ASSERT_UINT32_WITHIN(1, expected, status.getRPM());
+}
+
 void test_runtime_tracking() {
     simulator->initialize();
     
@@ -231,6 +533,46 @@ void test_command_A_realtime_data() {
     TEST_ASSERT_EQUAL_INT('A', output[0]);  // Response echo
 }
 
+static void addRangedRead(uint16_t offset, uint16_t length) {
+    mockSerial->addInput('r');
+    mockSerial->addInput(0x00);  // CAN ID
+    mockSerial->addInput(SpeeduinoProtocol::RANGED_READ_OUTPUT_CHANNELS);
+    mockSerial->addInput(offset & 0xFF);
+    mockSerial->addInput(offset >> 8);
+    mockSerial->addInput(length & 0xFF);
+    mockSerial->addInput(length >> 8);
+}
+
+void test_command_r_ranged_read() {
+    simulator->initialize();
+    protocol->begin();
+    
+    // RPM (bytes 15-16) as a dashboard would request it
+    addRangedRead(15, 2);
+    mockSerial->clearOutput();
+    
+    TEST_ASSERT_EQUAL(1, protocol->processCommands());
+    TEST_ASSERT_EQUAL(2, mockSerial->getOutputSize());
+    
+    const uint8_t* channels = (const uint8_t*)&simulator->getStatus();
+    TEST_ASSERT_EQUAL_MEMORY(&channels[15], mockSerial->getOutput(), 2);
+    TEST_ASSERT_EQUAL(0, protocol->getErrorCount());
+}
+
+void test_command_r_out_of_range() {
+    simulator->initialize();
+    protocol->begin();
+    
+    addRangedRead(70, 10);  // Runs past byte 78
+    mockSerial->clearOutput();
+    
+    protocol->processCommands();
+    
+    TEST_ASSERT_EQUAL(1, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_HEX8(0xFF, mockSerial->getOutput()[0]);
+    TEST_ASSERT_EQUAL(1, protocol->getErrorCount());
+}
+
 void test_command_V_version() {
     protocol->begin();
     
@@ -320,6 +662,23 @@ void test_command_counter() {
     TEST_ASSERT_EQUAL(initialCount + 3, protocol->getCommandCount());
 }
 
+void test_per_command_counts() {
+    simulator->initialize();
+    protocol->begin();
+    
+    const char commands[] = "AAVvZ";
+    for (size_t i = 0; i < sizeof(commands) - 1; i++) {
+        mockSerial->addInput(commands[i]);
+    }
+    protocol->processCommands();
+    
+    TEST_ASSERT_EQUAL(2, protocol->getCommandCount('A'));
+    TEST_ASSERT_EQUAL(2, protocol->getCommandCount('V'));  // 'V' and 'v' share a slot
+    TEST_ASSERT_EQUAL(0, protocol->getCommandCount('Q'));
+    TEST_ASSERT_EQUAL(1, protocol->getCommandCount('Z'));  // Unknown commands
+    TEST_ASSERT_EQUAL(5, protocol->getCommandCount());
+}
+
 void test_no_command_available() {
     protocol->begin();
     
@@ -331,32 +690,2120 @@ void test_no_command_available() {
 }
 
 // ============================================
-// Main Test Runner
+// Drain Mode Tests
 // ============================================
 
-void setup() {
-    delay(2000);  // Wait for serial to stabilize
+// TunerStudio connect handshake and expected total response length
+static const char HANDSHAKE[] = "QSnA";
+static const size_t HANDSHAKE_RESPONSE_SIZE = 4 + 20 + 7 + sizeof(EngineStatus);
+
+// Simulated cost of the rest of loop() (LED, web stack, OLED)
+static const uint32_t LOOP_OVERHEAD_US = 1000;
+
+static uint32_t runHandshake(uint8_t* passes) {
+    for (size_t i = 0; i < sizeof(HANDSHAKE) - 1; i++) {
+        mockSerial->addInput(HANDSHAKE[i]);
+    }
     
-    UNITY_BEGIN();
+    uint32_t start = timeProvider->micros();
+    *passes = 0;
+    while (mockSerial->getOutputSize() < HANDSHAKE_RESPONSE_SIZE && *passes < 20) {
+        protocol->processCommands();
+        simulator->update();
+        timeProvider->delayMicroseconds(LOOP_OVERHEAD_US);
+        (*passes)++;
+    }
+    return timeProvider->micros() - start;
+}
+
+void test_drain_handshake_single_call() {
+    simulator->initialize();
+    protocol->begin();
     
-    // Engine Simulator Tests
-    RUN_TEST(test_simulator_initialization);
-    RUN_TEST(test_rpm_stays_within_bounds);
-    RUN_TEST(test_coolant_temperature_increases);
-    RUN_TEST(test_map_correlates_with_throttle);
-    RUN_TEST(test_volumetric_efficiency);
-    RUN_TEST(test_engine_status_size);
-    RUN_TEST(test_runtime_tracking);
+    for (size_t i = 0; i < sizeof(HANDSHAKE) - 1; i++) {
+        mockSerial->addInput(HANDSHAKE[i]);
+    }
     
-    // Protocol Tests
-    RUN_TEST(test_command_A_realtime_data);
-    RUN_TEST(test_command_V_version);
-    RUN_TEST(test_command_Q_status);
-    RUN_TEST(test_command_S_signature);
-    RUN_TEST(test_command_n_page_sizes);
-    RUN_TEST(test_unknown_command);
-    RUN_TEST(test_command_counter);
-    RUN_TEST(test_no_command_available);
+    uint8_t handled = protocol->processCommands();
+    
+    TEST_ASSERT_EQUAL(4, handled);
+    TEST_ASSERT_EQUAL(HANDSHAKE_RESPONSE_SIZE, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL(0, mockSerial->available());
+}
+
+void test_drain_respects_command_budget() {
+    simulator->initialize();
+    protocol->begin();
+    protocol->setProcessingBudget(2, 0);
+    
+    for (size_t i = 0; i < sizeof(HANDSHAKE) - 1; i++) {
+        mockSerial->addInput(HANDSHAKE[i]);
+    }
+    
+    TEST_ASSERT_EQUAL(2, protocol->processCommands());
+    TEST_ASSERT_EQUAL(2, mockSerial->available());
+    TEST_ASSERT_TRUE(protocol->isBudgetExhausted());
+    
+    // Budget used up exactly by the last waiting command: nothing left over
+    TEST_ASSERT_EQUAL(2, protocol->processCommands());
+    TEST_ASSERT_FALSE(protocol->isBudgetExhausted());
+    TEST_ASSERT_EQUAL(0, protocol->processCommands());
+    TEST_ASSERT_FALSE(protocol->isBudgetExhausted());
+}
+
+void test_handshake_latency_drain_vs_single() {
+    simulator->initialize();
+    protocol->begin();
+    
+    // Before: one command per loop() pass
+    uint8_t singlePasses = 0;
+    protocol->setProcessingBudget(1, 0);
+    uint32_t singleUs = runHandshake(&singlePasses);
+    
+    // After: drain mode with default budget
+    mockSerial->clear();
+    uint8_t drainPasses = 0;
+    protocol->setProcessingBudget(PROTOCOL_MAX_COMMANDS_PER_CALL, PROTOCOL_MAX_PROCESS_TIME_US);
+    uint32_t drainUs = runHandshake(&drainPasses);
+    
+    char message[96];
+    snprintf(message, sizeof(message), "Handshake latency: single %lu us (%u passes), drain %lu us (%u passes)",
+             (unsigned long)singleUs, singlePasses, (unsigned long)drainUs, drainPasses);
+    TEST_MESSAGE(message);
+    
+    TEST_ASSERT_EQUAL(4, singlePasses);
+    TEST_ASSERT_EQUAL(1, drainPasses);
+    TEST_ASSERT_LESS_THAN(singleUs, drainUs);
+}
+
+// ============================================
+// Async Transmit Tests
+// ============================================
+
+// One byte at 115200 baud (10 bits per byte)
+static const uint32_t UART_US_PER_BYTE = 87;
+static const uint32_t EEPROM_US_PER_BYTE = 3300;    // AVR EEPROM erase + write
+
+void test_sync_transmit_flushes_each_response() {
+    simulator->initialize();
+    protocol->begin();
+    
+    mockSerial->addInput('A');
+    mockSerial->addInput('Q');
+    protocol->processCommands();
+    
+    #if PROTOCOL_TX_SPANS > 0
+        // Both responses leave in one gathered write, flushed once
+        TEST_ASSERT_EQUAL(1, mockSerial->getFlushCount());
+    #else
+        TEST_ASSERT_EQUAL(2, mockSerial->getFlushCount());
+    #endif
+}
+
+void test_async_transmit_skips_flush() {
+    simulator->initialize();
+    protocol->begin();
+    mockSerial->setAsyncTransmit(true);
+    
+    mockSerial->addInput('A');
+    mockSerial->addInput('Q');
+    protocol->processCommands();
+    
+    TEST_ASSERT_EQUAL(0, mockSerial->getFlushCount());
+    TEST_ASSERT_EQUAL(sizeof(EngineStatus) + 4, mockSerial->getOutputSize());
+}
+
+void test_loop_time_async_vs_sync() {
+    simulator->initialize();
+    protocol->begin();
+    mockSerial->setFlushCost(UART_US_PER_BYTE);
+    
+    // Before: flush() after the 'A' frame blocks until it leaves the UART
+    mockSerial->addInput('A');
+    uint32_t start = timeProvider->micros();
+    protocol->processCommands();
+    simulator->update();
+    uint32_t syncUs = timeProvider->micros() - start;
+    
+    // After: frame is queued and the loop pass returns immediately
+    mockSerial->clear();
+    mockSerial->setAsyncTransmit(true);
+    mockSerial->addInput('A');
+    start = timeProvider->micros();
+    protocol->processCommands();
+    simulator->update();
+    uint32_t asyncUs = timeProvider->micros() - start;
+    
+    char message[80];
+    snprintf(message, sizeof(message), "Loop time with 'A' poll: sync %lu us, async %lu us",
+             (unsigned long)syncUs, (unsigned long)asyncUs);
+    TEST_MESSAGE(message);
+    
+    TEST_ASSERT_GREATER_OR_EQUAL(sizeof(EngineStatus) * UART_US_PER_BYTE, syncUs);
+    TEST_ASSERT_LESS_THAN(syncUs / 4, asyncUs);
+}
+
+// ============================================
+// Latency Statistics Tests
+// ============================================
+
+static uint8_t latencyBucketOf(uint8_t command) {
+    uint8_t found = SpeeduinoProtocol::LATENCY_BUCKETS;
+    for (uint8_t bucket = 0; bucket < SpeeduinoProtocol::LATENCY_BUCKETS; bucket++) {
+        if (protocol->getLatencyCount(command, bucket) > 0) {
+            TEST_ASSERT_EQUAL(SpeeduinoProtocol::LATENCY_BUCKETS, found);  // Exactly one sample
+            found = bucket;
+        }
+    }
+    TEST_ASSERT_TRUE(found < SpeeduinoProtocol::LATENCY_BUCKETS);
+    return found;
+}
+
+void test_latency_histogram_buckets() {
+    simulator->initialize();
+    protocol->begin();
+    mockSerial->setFlushCost(UART_US_PER_BYTE);
+    
+    mockSerial->addInput('A');
+    protocol->processCommands();
+    uint32_t flushUs = sizeof(EngineStatus) * UART_US_PER_BYTE;
+    uint8_t bucket = latencyBucketOf('A');
+    
+    #if PROTOCOL_TX_SPANS > 0
+        // Gathered responses are flushed after the pass: only handling time counts
+        TEST_ASSERT_LESS_THAN(flushUs, SpeeduinoProtocol::getLatencyBucketFloorUs(bucket));
+    #else
+        // The synchronous flush dominates; the bucket must cover it
+        TEST_ASSERT_LESS_OR_EQUAL(flushUs, SpeeduinoProtocol::getLatencyBucketFloorUs(bucket));
+        if (bucket + 1 < SpeeduinoProtocol::LATENCY_BUCKETS) {
+            TEST_ASSERT_GREATER_THAN(flushUs, SpeeduinoProtocol::getLatencyBucketFloorUs(bucket + 1));
+        }
+    #endif
+    
+    // Nothing recorded for commands that were not sent
+    for (uint8_t bucket = 0; bucket < SpeeduinoProtocol::LATENCY_BUCKETS; bucket++) {
+        TEST_ASSERT_EQUAL(0, protocol->getLatencyCount('Q', bucket));
+    }
+    TEST_ASSERT_EQUAL(1, protocol->getCommandCount('A'));
+}
+
+void test_command_D_diagnostics() {
+    simulator->initialize();
+    protocol->begin();
+    
+    mockSerial->addInput('A');
+    mockSerial->addInput('A');
+    protocol->processCommands();
+    
+    mockSerial->clearOutput();
+    mockSerial->addInput('D');
+    mockSerial->addInput('A');
+    protocol->processCommands();
+    
+    const uint8_t* output = mockSerial->getOutput();
+    TEST_ASSERT_EQUAL(6 + 4 * SpeeduinoProtocol::LATENCY_BUCKETS, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL(SpeeduinoProtocol::LATENCY_BUCKETS, output[0]);
+    TEST_ASSERT_EQUAL(PROTOCOL_LATENCY_SHIFT, output[1]);
+    TEST_ASSERT_EQUAL(2, output[2] | (output[3] << 8) | ((uint32_t)output[4] << 16) | ((uint32_t)output[5] << 24));
+    
+    uint32_t samples = 0;
+    for (uint8_t bucket = 0; bucket < SpeeduinoProtocol::LATENCY_BUCKETS; bucket++) {
+        const uint8_t* value = &output[6 + 4 * bucket];
+        TEST_ASSERT_EQUAL(protocol->getLatencyCount('A', bucket),
+                          value[0] | (value[1] << 8) | ((uint32_t)value[2] << 16) | ((uint32_t)value[3] << 24));
+        samples += protocol->getLatencyCount('A', bucket);
+    }
+    TEST_ASSERT_EQUAL(2, samples);
+    TEST_ASSERT_EQUAL(1, protocol->getCommandCount('D'));
+}
+
+// ============================================
+// Streaming Tests
+// ============================================
+
+static void addStreamStart(uint8_t interval, uint16_t offset, uint16_t length) {
+    mockSerial->addInput('G');
+    mockSerial->addInput(interval);
+    mockSerial->addInput(offset & 0xFF);
+    mockSerial->addInput(offset >> 8);
+    mockSerial->addInput(length & 0xFF);
+    mockSerial->addInput(length >> 8);
+}
+
+static uint32_t streamSequence(const uint8_t* record) {
+    return record[0] | (record[1] << 8) | ((uint32_t)record[2] << 16) | ((uint32_t)record[3] << 24);
+}
+
+// Advance the simulation by one tick and let the protocol push
+static void streamTick() {
+    delay(UPDATE_INTERVAL_MS);
+    TEST_ASSERT_TRUE(simulator->update());
+    mockSerial->clearOutput();
+    protocol->processCommands();
+}
+
+void test_stream_pushes_every_tick() {
+    simulator->initialize();
+    protocol->begin();
+    
+    addStreamStart(1, 0, 0);  // Full EngineStatus every tick
+    protocol->processCommands();
+    TEST_ASSERT_TRUE(protocol->isStreaming());
+    
+    // Immediate first record acknowledges the request
+    TEST_ASSERT_EQUAL(4 + sizeof(EngineStatus), mockSerial->getOutputSize());
+    uint32_t sequence = streamSequence(mockSerial->getOutput());
+    TEST_ASSERT_EQUAL(simulator->getGeneration(), sequence);
+    
+    for (uint8_t i = 0; i < 3; i++) {
+        streamTick();
+        TEST_ASSERT_EQUAL(4 + sizeof(EngineStatus), mockSerial->getOutputSize());
+        TEST_ASSERT_EQUAL(++sequence, streamSequence(mockSerial->getOutput()));
+        TEST_ASSERT_EQUAL_MEMORY(&simulator->getStatus(), mockSerial->getOutput() + 4, sizeof(EngineStatus));
+    }
+    
+    // Nothing new without a tick
+    mockSerial->clearOutput();
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(0, mockSerial->getOutputSize());
+    
+    mockSerial->addInput('g');
+    protocol->processCommands();
+    TEST_ASSERT_FALSE(protocol->isStreaming());
+    streamTick();
+    TEST_ASSERT_EQUAL(0, mockSerial->getOutputSize());
+}
+
+void test_stream_subset_and_interval() {
+    simulator->initialize();
+    protocol->begin();
+    
+    addStreamStart(2, offsetof(EngineStatus, rpmlo), 2);  // RPM only, every other tick
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(4 + 2, mockSerial->getOutputSize());
+    uint32_t sequence = streamSequence(mockSerial->getOutput());
+    
+    streamTick();
+    TEST_ASSERT_EQUAL(0, mockSerial->getOutputSize());
+    streamTick();
+    TEST_ASSERT_EQUAL(4 + 2, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL(sequence + 2, streamSequence(mockSerial->getOutput()));
+    TEST_ASSERT_EQUAL_MEMORY((const uint8_t*)&simulator->getStatus() + offsetof(EngineStatus, rpmlo), mockSerial->getOutput() + 4, 2);
+}
+
+void test_stream_out_of_range() {
+    protocol->begin();
+    
+    addStreamStart(1, sizeof(EngineStatus) - 1, 2);
+    protocol->processCommands();
+    
+    TEST_ASSERT_FALSE(protocol->isStreaming());
+    TEST_ASSERT_EQUAL(1, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_HEX8(0xFF, mockSerial->getOutput()[0]);
+}
+
+// ============================================
+// Framed Protocol Tests
+// ============================================
+
+static void addFrame(const uint8_t* payload, uint16_t size, bool corruptCrc = false) {
+    uint32_t crc = Crc32::compute(payload, size);
+    if (corruptCrc) {
+        crc ^= 0x01;
+    }
+    
+    mockSerial->addInput(size >> 8);
+    mockSerial->addInput(size & 0xFF);
+    for (uint16_t i = 0; i < size; i++) {
+        mockSerial->addInput(payload[i]);
+    }
+    mockSerial->addInput(crc >> 24);
+    mockSerial->addInput(crc >> 16);
+    mockSerial->addInput(crc >> 8);
+    mockSerial->addInput(crc);
+}
+
+// Validate a framed response; returns the return code byte
+static uint8_t checkFrame(const uint8_t* frame, size_t frameSize, uint16_t expectedData) {
+    uint16_t size = (frame[0] << 8) | frame[1];
+    TEST_ASSERT_EQUAL(expectedData + 1, size);
+    TEST_ASSERT_EQUAL(size + 6, frameSize);
+    
+    uint32_t crc = ((uint32_t)frame[2 + size] << 24) | ((uint32_t)frame[3 + size] << 16) |
+                   ((uint32_t)frame[4 + size] << 8) | frame[5 + size];
+    TEST_ASSERT_EQUAL_HEX32(Crc32::compute(&frame[2], size), crc);
+    return frame[2];
+}
+
+void test_crc32_known_value() {
+    const uint8_t check[] = "123456789";
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926UL, Crc32::compute(check, 9));
+    
+    // Compile-time variant used for the flash-resident replies
+    static_assert(Crc32::finish(Crc32::updateConstant(Crc32::begin(), "123456789", 9)) == 0xCBF43926UL,
+                  "constexpr CRC32 mismatch");
+}
+
+void test_framed_status_request() {
+    protocol->begin();
+    
+    const uint8_t payload[] = { 'Q' };
+    addFrame(payload, sizeof(payload));
+    mockSerial->clearOutput();
+    
+    protocol->processCommands();
+    
+    uint8_t rc = checkFrame(mockSerial->getOutput(), mockSerial->getOutputSize(), 4);
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK, rc);
+    TEST_ASSERT_TRUE(protocol->isFramedSession());
+}
+
+void test_framed_crc_error_and_resync() {
+    simulator->initialize();
+    protocol->begin();
+    
+    const uint8_t payload[] = { 'A' };
+    addFrame(payload, sizeof(payload), true);
+    mockSerial->addInput('Z');  // Line noise after the corrupt frame
+    addFrame(payload, sizeof(payload));
+    mockSerial->clearOutput();
+    
+    protocol->processCommands();
+    
+    // CRC error frame (7 bytes), noise dropped silently, then the 'A' frame
+    const uint8_t* output = mockSerial->getOutput();
+    TEST_ASSERT_EQUAL(7 + sizeof(EngineStatus) + 7, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_CRC_ERROR, checkFrame(output, 7, 0));
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK,
+                           checkFrame(&output[7], sizeof(EngineStatus) + 7, sizeof(EngineStatus)));
+    TEST_ASSERT_EQUAL(2, protocol->getErrorCount());
+}
+
+void test_legacy_command_after_framed_session() {
+    protocol->begin();
+    
+    const uint8_t payload[] = { 'S' };
+    addFrame(payload, sizeof(payload));
+    protocol->processCommands();
+    TEST_ASSERT_TRUE(protocol->isFramedSession());
+    
+    // Back to back it is taken as the tail of a frame and dropped
+    mockSerial->clearOutput();
+    mockSerial->addInput('S');
+    protocol->processCommands();
+    TEST_ASSERT_TRUE(protocol->isFramedSession());
+    TEST_ASSERT_EQUAL(0, mockSerial->getOutputSize());
+    
+    // After a quiet period it is a new legacy client
+    delay(SERIAL_TIMEOUT_MS + 10);
+    mockSerial->addInput('S');
+    protocol->processCommands();
+    
+    TEST_ASSERT_FALSE(protocol->isFramedSession());
+    TEST_ASSERT_EQUAL(20, mockSerial->getOutputSize());
+}
+
+void test_framed_session_legacy_fallback() {
+    // Without a clock there is no quiet period to detect a new client
+    SpeeduinoProtocol clockless(mockSerial, simulator, nullptr, nullptr);
+    clockless.begin();
+    const uint8_t payload[] = { 'Q' };
+    addFrame(payload, sizeof(payload));
+    clockless.processCommands();
+    TEST_ASSERT_TRUE(clockless.isFramedSession());
+    mockSerial->clearOutput();
+    
+    // Dropped bytes use neither the command budget nor the counters
+    uint32_t commands = clockless.getCommandCount();
+    clockless.setProcessingBudget(2, 0);
+    for (uint8_t i = 0; i < PROTOCOL_LEGACY_FALLBACK_BYTES; i++) {
+        mockSerial->addInput('Q');
+    }
+    TEST_ASSERT_EQUAL(0, clockless.processCommands());
+    TEST_ASSERT_FALSE(clockless.isBudgetExhausted());
+    TEST_ASSERT_EQUAL(0, mockSerial->available());
+    TEST_ASSERT_EQUAL(commands, clockless.getCommandCount());
+    TEST_ASSERT_EQUAL(0, mockSerial->getOutputSize());
+    
+    // A client that keeps asking in legacy is answered in the end
+    mockSerial->addInput('Q');
+    TEST_ASSERT_EQUAL(1, clockless.processCommands());
+    TEST_ASSERT_EQUAL(4, mockSerial->getOutputSize());
+    TEST_ASSERT_FALSE(clockless.isFramedSession());
+}
+
+void test_framed_lost_header_not_executed() {
+    simulator->initialize();
+    protocol->begin();
+    
+    const uint8_t payload[] = { 'Q' };
+    addFrame(payload, sizeof(payload));
+    protocol->processCommands();
+    mockSerial->clearOutput();
+    
+    // A page write frame that lost its two header bytes
+    const uint8_t write[] = { 'M', 0, 1, 0, 0, 1, 0, 0x5A };
+    for (uint8_t i = 0; i < sizeof(write); i++) {
+        mockSerial->addInput(write[i]);
+    }
+    uint32_t errors = protocol->getErrorCount();
+    protocol->processCommands();
+    
+    // 'M' is dropped, not run as a legacy page write (the zero bytes after it
+    // are then examined as a frame start)
+    TEST_ASSERT_EQUAL(0, protocol->getCommandCount('M'));
+    TEST_ASSERT_GREATER_THAN(errors, protocol->getErrorCount());
+    TEST_ASSERT_TRUE(protocol->isFramedSession());
+    
+    // The next complete frame is answered
+    delay(SERIAL_TIMEOUT_MS + 10);
+    protocol->processCommands();
+    mockSerial->clearOutput();
+    addFrame(payload, sizeof(payload));
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK,
+                           checkFrame(mockSerial->getOutput(), mockSerial->getOutputSize(), 4));
+}
+
+void test_crc32_cost_per_frame() {
+    simulator->initialize();
+    const uint8_t* frame = (const uint8_t*)&simulator->getStatus();
+    const uint16_t iterations = 1000;  // Total microseconds == nanoseconds per frame
+    
+    volatile uint32_t checksum = 0;
+    uint32_t start = timeProvider->micros();
+    for (uint16_t i = 0; i < iterations; i++) {
+        checksum = Crc32::compute(frame, sizeof(EngineStatus));
+    }
+    uint32_t elapsed = timeProvider->micros() - start;
+    
+    char message[80];
+    snprintf(message, sizeof(message), "CRC32 per 'A' frame (%s table): %lu ns",
+             CRC32_NIBBLE_TABLE ? "nibble" : "byte",
+             (unsigned long)elapsed);
+    TEST_MESSAGE(message);
+    
+    TEST_ASSERT_EQUAL_HEX32(Crc32::compute(frame, sizeof(EngineStatus)), checksum);
+}
+
+// ============================================
+// Request Parser Tests
+// ============================================
+
+void test_ranged_read_split_across_calls() {
+    simulator->initialize();
+    protocol->begin();
+    
+    const uint8_t request[] = { 'r', 0x00, SpeeduinoProtocol::RANGED_READ_OUTPUT_CHANNELS, 4, 0, 8, 0 };
+    for (uint8_t i = 0; i < 3; i++) {
+        mockSerial->addInput(request[i]);
+    }
+    
+    // Incomplete request: nothing answered, nothing blocks
+    TEST_ASSERT_EQUAL(0, protocol->processCommands());
+    TEST_ASSERT_EQUAL(0, mockSerial->getOutputSize());
+    
+    for (uint8_t i = 3; i < sizeof(request); i++) {
+        mockSerial->addInput(request[i]);
+    }
+    TEST_ASSERT_EQUAL(1, protocol->processCommands());
+    TEST_ASSERT_EQUAL(8, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_MEMORY((const uint8_t*)&simulator->getStatus() + 4, mockSerial->getOutput(), 8);
+    TEST_ASSERT_EQUAL(0, protocol->getErrorCount());
+}
+
+void test_frame_split_across_calls() {
+    protocol->begin();
+    
+    const uint8_t payload[] = { 'Q' };
+    addFrame(payload, sizeof(payload));
+    
+    // One byte per loop() pass
+    uint8_t completed = 0;
+    for (uint8_t i = 0; i < 2 + sizeof(payload) + 4; i++) {
+        mockSerial->setAvailableLimit(i + 1);
+        completed += protocol->processCommands();
+        if (i < 2 + sizeof(payload) + 3) {
+            TEST_ASSERT_EQUAL(0, mockSerial->getOutputSize());
+        }
+    }
+    
+    TEST_ASSERT_EQUAL(1, completed);
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK,
+                           checkFrame(mockSerial->getOutput(), mockSerial->getOutputSize(), 4));
+}
+
+void test_partial_request_timeout_resync() {
+    protocol->begin();
+    
+    // Truncated 'r' request, then silence
+    mockSerial->addInput('r');
+    mockSerial->addInput(0x00);
+    TEST_ASSERT_EQUAL(0, protocol->processCommands());
+    
+    delay(SERIAL_TIMEOUT_MS + 10);
+    
+    // Silence seen by a pass: the stale request is dropped, and 'Q' is
+    // parsed as a command, not an argument
+    TEST_ASSERT_EQUAL(0, protocol->processCommands());
+    mockSerial->addInput('Q');
+    TEST_ASSERT_EQUAL(1, protocol->processCommands());
+    TEST_ASSERT_EQUAL(4, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL(1, protocol->getErrorCount());
+    TEST_ASSERT_EQUAL(0, protocol->getCommandCount('r'));
+}
+
+void test_partial_request_survives_loop_stall() {
+    simulator->initialize();
+    protocol->begin();
+    
+    const uint8_t request[] = { 'r', 0x00, SpeeduinoProtocol::RANGED_READ_OUTPUT_CHANNELS, 4, 0, 8, 0 };
+    mockSerial->addInput(request[0]);
+    mockSerial->addInput(request[1]);
+    TEST_ASSERT_EQUAL(0, protocol->processCommands());
+    
+    // The rest arrives while loop() is stalled past SERIAL_TIMEOUT_MS
+    for (uint8_t i = 2; i < sizeof(request); i++) {
+        mockSerial->addInput(request[i]);
+    }
+    delay(SERIAL_TIMEOUT_MS + 10);
+    
+    TEST_ASSERT_EQUAL(1, protocol->processCommands());
+    TEST_ASSERT_EQUAL(8, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL(0, protocol->getErrorCount());
+    TEST_ASSERT_EQUAL(1, protocol->getCommandCount('r'));
+}
+
+// ============================================
+// Tune Page Tests
+// ============================================
+
+static void addPageCommand(char command, uint8_t page, uint16_t offset, uint16_t length) {
+    mockSerial->addInput(command);
+    mockSerial->addInput(0);  // CAN ID
+    mockSerial->addInput(page);
+    mockSerial->addInput(offset & 0xFF);
+    mockSerial->addInput(offset >> 8);
+    mockSerial->addInput(length & 0xFF);
+    mockSerial->addInput(length >> 8);
+}
+
+static void addPageWrite(uint8_t page, uint16_t offset, const uint8_t* data, uint16_t length) {
+    addPageCommand('M', page, offset, length);
+    for (uint16_t i = 0; i < length; i++) {
+        mockSerial->addInput(data[i]);
+    }
+}
+
+void test_page_write_and_read() {
+    protocol->begin();
+    TEST_ASSERT_FALSE(pageStore->begin());  // Blank storage
+    
+    const uint8_t data[] = { 10, 20, 30, 40 };
+    addPageWrite(1, 100, data, sizeof(data));
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(0, mockSerial->getOutputSize());  // Legacy 'M' has no reply
+    
+    addPageCommand('p', 1, 99, 6);
+    protocol->processCommands();
+    
+    const uint8_t expected[] = { 0, 10, 20, 30, 40, 0 };
+    TEST_ASSERT_EQUAL(sizeof(expected), mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_MEMORY(expected, mockSerial->getOutput(), sizeof(expected));
+    TEST_ASSERT_EQUAL(0, protocol->getErrorCount());
+}
+
+void test_page_range_errors() {
+    protocol->begin();
+    pageStore->begin();
+    
+    addPageCommand('p', 0, PAGE_0_SIZE - 2, 4);    // Past the end of page 0
+    addPageCommand('p', PAGE_COUNT, 0, 1);         // No such page
+    mockSerial->addInput('b');
+    mockSerial->addInput(0);
+    mockSerial->addInput(PAGE_COUNT);
+    protocol->processCommands();
+    
+    TEST_ASSERT_EQUAL(3, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL(3, protocol->getErrorCount());
+}
+
+void test_burn_writes_only_changed_bytes() {
+    protocol->begin();
+    pageStore->begin();
+    
+    // First burn of a blank store writes the complete tune plus its marker
+    mockSerial->addInput('B');
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(PAGE_STORAGE_SIZE, mockStorage->getTotalWear());
+    
+    // Two changed bytes, one unchanged byte in between
+    const uint8_t data[] = { 1, 0, 2 };
+    addPageWrite(1, 10, data, sizeof(data));
+    mockSerial->addInput('b');
+    mockSerial->addInput(0);
+    mockSerial->addInput(1);
+    protocol->processCommands();
+    
+    TEST_ASSERT_EQUAL(PAGE_STORAGE_SIZE + 2, mockStorage->getTotalWear());
+    TEST_ASSERT_EQUAL(2, mockStorage->getWear(PAGE_0_SIZE + 10));
+    TEST_ASSERT_EQUAL(1, mockStorage->getWear(PAGE_0_SIZE + 11));
+    TEST_ASSERT_FALSE(pageStore->isDirty(1));
+    
+    // Re-sending identical data and burning again costs no writes
+    addPageWrite(1, 10, data, sizeof(data));
+    mockSerial->addInput('B');
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(PAGE_STORAGE_SIZE + 2, mockStorage->getTotalWear());
+    
+    // The burned tune survives a restart
+    PageStore reloaded(mockStorage);
+    TEST_ASSERT_TRUE(reloaded.begin());
+    TEST_ASSERT_EQUAL_MEMORY(pageStore->getPage(1), reloaded.getPage(1), PAGE_1_SIZE);
+}
+
+void test_framed_page_commands() {
+    protocol->begin();
+    pageStore->begin();
+    
+    uint8_t write[7 + 2] = { 'M', 0, 0, 4, 0, 2, 0, 0xAB, 0xCD };
+    addFrame(write, sizeof(write));
+    const uint8_t burn[] = { 'b', 0, 0 };
+    addFrame(burn, sizeof(burn));
+    const uint8_t read[] = { 'p', 0, 0, 4, 0, 2, 0 };
+    addFrame(read, sizeof(read));
+    protocol->processCommands();
+    
+    const uint8_t* output = mockSerial->getOutput();
+    TEST_ASSERT_EQUAL(7 + 7 + 9, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK, checkFrame(output, 7, 0));
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_BURN_OK, checkFrame(&output[7], 7, 0));
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK, checkFrame(&output[14], 9, 2));
+    TEST_ASSERT_EQUAL_HEX8(0xAB, output[17]);
+    TEST_ASSERT_EQUAL_HEX8(0xCD, output[18]);
+    
+    // Announced data longer than the frame is rejected
+    mockSerial->clearOutput();
+    write[5] = 3;
+    addFrame(write, sizeof(write));
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_RANGE_ERROR,
+                           checkFrame(mockSerial->getOutput(), mockSerial->getOutputSize(), 0));
+}
+
+void test_oversized_page_write_resync() {
+    protocol->begin();
+    pageStore->begin();
+    
+    // Arguments + data one byte larger than the receive buffer: the data is
+    // consumed (not parsed as commands) and the request rejected
+    const uint16_t length = PROTOCOL_RX_BUFFER_SIZE - 6 + 1;
+    addPageCommand('M', 1, 0, length);
+    for (uint16_t i = 0; i < length; i++) {
+        mockSerial->addInput('Q');
+    }
+    mockSerial->addInput('Q');
+    protocol->processCommands();
+    
+    TEST_ASSERT_EQUAL(1 + 4, mockSerial->getOutputSize());  // Error byte, then one 'Q' reply
+    TEST_ASSERT_EQUAL_HEX8(0xFF, mockSerial->getOutput()[0]);
+    TEST_ASSERT_EQUAL(0, pageStore->getPage(1)[0]);
+}
+
+void test_burn_throughput_and_wear() {
+    protocol->begin();
+    pageStore->begin();
+    mockStorage->setWriteCost(EEPROM_US_PER_BYTE);
+    
+    uint32_t start = timeProvider->micros();
+    TEST_ASSERT_TRUE(pageStore->burnAll());
+    uint32_t fullUs = timeProvider->micros() - start;
+    
+    // Typical tuning edit: a few cells of the tuning page, burned repeatedly
+    const uint16_t burns = 20;
+    start = timeProvider->micros();
+    for (uint16_t i = 0; i < burns; i++) {
+        uint8_t cell[4] = { (uint8_t)i, (uint8_t)(i + 1), (uint8_t)(i + 2), (uint8_t)(i + 3) };
+        pageStore->write(1, 64, cell, sizeof(cell));
+        TEST_ASSERT_TRUE(pageStore->burn(1));
+    }
+    uint32_t editUs = (timeProvider->micros() - start) / burns;
+    
+    char message[96];
+    snprintf(message, sizeof(message), "Burn: full tune %lu us, 4-byte edit %lu us, max cell wear %u",
+             (unsigned long)fullUs, (unsigned long)editUs, (unsigned)mockStorage->getMaxWear());
+    TEST_MESSAGE(message);
+    
+    TEST_ASSERT_LESS_THAN(fullUs / 10, editUs);
+    TEST_ASSERT_EQUAL(1 + burns, mockStorage->getMaxWear());
+    TEST_ASSERT_EQUAL(1, mockStorage->getWear(0));  // Untouched page 0 written once
+}
+
+// ============================================
+// Response Gathering Tests
+// ============================================
+
+void test_pipelined_responses_gathered() {
+    simulator->initialize();
+    simulator->update();
+    protocol->begin();
+    pageStore->begin();
+    
+    // 'A', then a framed page read and 'Q' pipelined into one pass
+    mockSerial->addInput('A');
+    const uint8_t read[] = { 'p', 0, 1, 8, 0, 16, 0 };
+    addFrame(read, sizeof(read));
+    const uint8_t status[] = { 'Q' };
+    addFrame(status, sizeof(status));
+    TEST_ASSERT_EQUAL(3, protocol->processCommands());
+    
+    const size_t channels = sizeof(EngineStatus);
+    const uint8_t* output = mockSerial->getOutput();
+    TEST_ASSERT_EQUAL(channels + 23 + 11, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_MEMORY(simulator->getSnapshot().getChannels(LAYOUT_LEGACY), output, channels);
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK, checkFrame(&output[channels], 23, 16));
+    TEST_ASSERT_EQUAL_MEMORY(pageStore->getPage(1) + 8, &output[channels + 3], 16);
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK, checkFrame(&output[channels + 23], 11, 4));
+    
+    #if PROTOCOL_TX_SPANS > 0
+        TEST_ASSERT_EQUAL(1, mockSerial->getGatherCount());
+        TEST_ASSERT_EQUAL(1, mockSerial->getFlushCount());
+    #endif
+}
+
+void test_gathered_page_read_before_write() {
+    protocol->begin();
+    pageStore->begin();
+    uint8_t before[2];
+    memcpy(before, pageStore->getPage(0), sizeof(before));
+    
+    // A read queued in place must not see a write later in the same pass
+    const uint8_t read[] = { 'p', 0, 0, 0, 0, 2, 0 };
+    const uint8_t write[7 + 2] = { 'M', 0, 0, 0, 0, 2, 0, 0x5A, 0xA5 };
+    TEST_ASSERT_FALSE(before[0] == 0x5A && before[1] == 0xA5);
+    addFrame(read, sizeof(read));
+    addFrame(write, sizeof(write));
+    addFrame(read, sizeof(read));
+    protocol->processCommands();
+    
+    const uint8_t* output = mockSerial->getOutput();
+    TEST_ASSERT_EQUAL(9 + 7 + 9, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK, checkFrame(output, 9, 2));
+    TEST_ASSERT_EQUAL_MEMORY(before, &output[3], 2);
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK, checkFrame(&output[9], 7, 0));
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK, checkFrame(&output[16], 9, 2));
+    TEST_ASSERT_EQUAL_HEX8(0x5A, output[19]);
+    TEST_ASSERT_EQUAL_HEX8(0xA5, output[20]);
+}
+
+// ============================================
+// Flash Reply Tests
+// ============================================
+
+void test_flash_replies_legacy_and_framed() {
+    protocol->begin();
+    const char commands[] = { 'Q', 'S', 'V', 'n' };
+    
+    for (uint8_t i = 0; i < sizeof(commands); i++) {
+        uint8_t legacy[64];
+        protocol->begin();  // New legacy session (a framed one drops legacy bytes)
+        mockSerial->clearOutput();
+        mockSerial->addInput(commands[i]);
+        protocol->processCommands();
+        size_t legacySize = mockSerial->getOutputSize();
+        TEST_ASSERT_TRUE(legacySize > 0 && legacySize <= sizeof(legacy));
+        memcpy(legacy, mockSerial->getOutput(), legacySize);
+        
+        // Same bytes inside the frame, with a valid precomputed CRC
+        const uint8_t payload[] = { (uint8_t)commands[i] };
+        mockSerial->clearOutput();
+        addFrame(payload, sizeof(payload));
+        protocol->processCommands();
+        const uint8_t* frame = mockSerial->getOutput();
+        TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK,
+                               checkFrame(frame, mockSerial->getOutputSize(), legacySize));
+        TEST_ASSERT_EQUAL_MEMORY(legacy, &frame[3], legacySize);
+    }
+}
+
+// ============================================
+// Output Layout Tests
+// ============================================
+
+static void addSignatureSelect(const char* signature) {
+    mockSerial->addInput('s');
+    size_t length = strlen(signature);
+    for (uint8_t i = 0; i < 20; i++) {
+        mockSerial->addInput(i < length ? signature[i] : 0);
+    }
+}
+
+void test_legacy_layout_is_default() {
+    protocol->begin();
+    simulator->initialize();
+    
+    TEST_ASSERT_EQUAL(LAYOUT_LEGACY, protocol->getOutputLayout());
+    TEST_ASSERT_EQUAL(sizeof(EngineStatus), EngineSnapshot::getChannelsSize(LAYOUT_LEGACY));
+    
+    // Selecting the legacy signature explicitly is accepted too
+    addSignatureSelect(SPEEDUINO_SIGNATURE);
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(2, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL(sizeof(EngineStatus),
+                      mockSerial->getOutput()[0] | (mockSerial->getOutput()[1] << 8));
+    
+    // Unknown signature: error, layout unchanged
+    mockSerial->clearOutput();
+    addSignatureSelect("speeduino 199901");
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(1, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_HEX8(0xFF, mockSerial->getOutput()[0]);
+    TEST_ASSERT_EQUAL(LAYOUT_LEGACY, protocol->getOutputLayout());
+}
+
+void test_extended_layout_select() {
+    protocol->begin();
+    simulator->initialize();
+    simulator->setMode(EngineMode::LIGHT_LOAD);
+    for (int i = 0; i < 5; i++) {
+        delay(UPDATE_INTERVAL_MS);
+        simulator->update();
+    }
+    
+    addSignatureSelect(SPEEDUINO_SIGNATURE_EXTENDED);
+    protocol->processCommands();
+    
+#if OUTPUT_LAYOUT_EXTENDED
+    TEST_ASSERT_EQUAL(2, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL(sizeof(ExtendedStatus),
+                      mockSerial->getOutput()[0] | (mockSerial->getOutput()[1] << 8));
+    TEST_ASSERT_EQUAL(LAYOUT_EXTENDED, protocol->getOutputLayout());
+    
+    // 'S' now reports the extended signature
+    mockSerial->clearOutput();
+    mockSerial->addInput('S');
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(20, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_STRING_LEN(SPEEDUINO_SIGNATURE_EXTENDED, (const char*)mockSerial->getOutput(),
+                                 strlen(SPEEDUINO_SIGNATURE_EXTENDED));
+    
+    // 'A' sends the extended buffer: legacy channels at their table
+    // positions, extended-only channels filled by the simulator
+    mockSerial->clearOutput();
+    mockSerial->addInput('A');
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(sizeof(ExtendedStatus), mockSerial->getOutputSize());
+    
+    const uint8_t* output = mockSerial->getOutput();
+    const EngineSnapshot& snapshot = simulator->getSnapshot();
+    TEST_ASSERT_EQUAL_MEMORY(&snapshot.extended, output, sizeof(ExtendedStatus));
+    TEST_ASSERT_EQUAL_HEX8(snapshot.status.secl, output[offsetof(ExtendedStatus, secl)]);
+    TEST_ASSERT_EQUAL_HEX8(snapshot.status.rpmlo, output[offsetof(ExtendedStatus, rpmlo)]);
+    TEST_ASSERT_EQUAL_HEX8(snapshot.status.rpmhi, output[offsetof(ExtendedStatus, rpmhi)]);
+    TEST_ASSERT_EQUAL_MEMORY(snapshot.status.canin, &output[offsetof(ExtendedStatus, canin)], 32);
+    TEST_ASSERT_EQUAL(snapshot.status.getPulseWidth(),
+                      output[offsetof(ExtendedStatus, pw2)] | (output[offsetof(ExtendedStatus, pw2) + 1] << 8));
+    TEST_ASSERT_EQUAL(snapshot.status.ve, output[offsetof(ExtendedStatus, ve1)]);
+    
+    // 'r' may read past the legacy size
+    mockSerial->clearOutput();
+    addRangedRead(sizeof(EngineStatus), sizeof(ExtendedStatus) - sizeof(EngineStatus));
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(sizeof(ExtendedStatus) - sizeof(EngineStatus), mockSerial->getOutputSize());
+    
+    // begin() returns to the legacy layout
+    protocol->begin();
+    TEST_ASSERT_EQUAL(LAYOUT_LEGACY, protocol->getOutputLayout());
+#else
+    // Not built: the extended signature is unknown
+    TEST_ASSERT_EQUAL(1, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL(LAYOUT_LEGACY, protocol->getOutputLayout());
+#endif
+}
+
+void test_output_layout_per_session() {
+    // Two sessions on one simulator, each with its own layout
+    MockSerial* otherSerial = new MockSerial();
+    SpeeduinoProtocol* other = new SpeeduinoProtocol(otherSerial, simulator, timeProvider);
+    protocol->begin();
+    other->begin();
+    simulator->initialize();
+    
+    addSignatureSelect(SPEEDUINO_SIGNATURE_EXTENDED);
+    protocol->processCommands();
+    mockSerial->clearOutput();
+    
+    mockSerial->addInput('A');
+    otherSerial->addInput('A');
+    protocol->processCommands();
+    other->processCommands();
+    
+    TEST_ASSERT_EQUAL(EngineSnapshot::getChannelsSize(protocol->getOutputLayout()), mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL(sizeof(EngineStatus), otherSerial->getOutputSize());
+    TEST_ASSERT_EQUAL(LAYOUT_LEGACY, other->getOutputLayout());
+    
+    delete other;
+    delete otherSerial;
+}
+
+// ============================================
+// Delta Frame Tests
+// ============================================
+
+static void requestDelta(uint16_t ack) {
+    mockSerial->clear();
+    mockSerial->addInput('e');
+    mockSerial->addInput(ack & 0xFF);
+    mockSerial->addInput(ack >> 8);
+    protocol->processCommands();
+}
+
+// Client side: apply an 'e' reply to the decoded channels, return its sequence
+static uint16_t applyDeltaReply(uint8_t* channels, uint16_t size) {
+    const uint8_t* reply = mockSerial->getOutput();
+    uint16_t bitmapSize = (size + 7) / 8;
+    
+    if (reply[0] == 0x00) {
+        TEST_ASSERT_EQUAL(3 + size, mockSerial->getOutputSize());
+        memcpy(channels, &reply[3], size);
+    } else {
+        TEST_ASSERT_EQUAL_HEX8(0x01, reply[0]);
+        const uint8_t* changed = &reply[3 + bitmapSize];
+        for (uint16_t i = 0; i < size; i++) {
+            if (reply[3 + (i >> 3)] & (1 << (i & 7))) {
+                channels[i] = *changed++;
+            }
+        }
+        TEST_ASSERT_EQUAL(changed - reply, mockSerial->getOutputSize());
+    }
+    return reply[1] | (reply[2] << 8);
+}
+
+void test_delta_frames_track_snapshot() {
+    uint8_t decoded[sizeof(EngineStatus)];
+    protocol->begin();
+    simulator->initialize();
+    simulator->setMode(EngineMode::ACCELERATION);
+    
+    // First reply is always a keyframe
+    requestDelta(0);
+    TEST_ASSERT_EQUAL_HEX8(0x00, mockSerial->getOutput()[0]);
+    uint16_t sequence = applyDeltaReply(decoded, sizeof(decoded));
+    
+    for (int i = 0; i < 10; i++) {
+        delay(UPDATE_INTERVAL_MS);
+        simulator->update();
+        
+        requestDelta(sequence);
+        TEST_ASSERT_EQUAL_HEX8(0x01, mockSerial->getOutput()[0]);
+        TEST_ASSERT_LESS_THAN(3 + sizeof(EngineStatus), mockSerial->getOutputSize());
+        sequence = applyDeltaReply(decoded, sizeof(decoded));
+        TEST_ASSERT_EQUAL_MEMORY(&simulator->getSnapshot().status, decoded, sizeof(decoded));
+    }
+    TEST_ASSERT_EQUAL(10, protocol->getDeltaFrameCount());
+    TEST_ASSERT_EQUAL(1, protocol->getKeyframeCount());
+}
+
+void test_delta_keyframe_recovery() {
+    uint8_t decoded[sizeof(EngineStatus)];
+    protocol->begin();
+    simulator->initialize();
+    
+    requestDelta(0);
+    uint16_t sequence = applyDeltaReply(decoded, sizeof(decoded));
+    
+    // Reply lost: the client still acknowledges the older frame
+    requestDelta(sequence);
+    requestDelta(sequence);
+    TEST_ASSERT_EQUAL_HEX8(0x00, mockSerial->getOutput()[0]);
+    sequence = applyDeltaReply(decoded, sizeof(decoded));
+    
+    // Periodic keyframe even when every reply arrives
+    uint8_t keyframes = 0;
+    for (int i = 0; i < DELTA_KEYFRAME_INTERVAL; i++) {
+        requestDelta(sequence);
+        keyframes += (mockSerial->getOutput()[0] == 0x00);
+        sequence = applyDeltaReply(decoded, sizeof(decoded));
+    }
+    TEST_ASSERT_EQUAL(1, keyframes);
+    TEST_ASSERT_EQUAL_MEMORY(&simulator->getSnapshot().status, decoded, sizeof(decoded));
+}
+
+void test_delta_bandwidth() {
+    // Bytes per frame while driving, against 79-byte 'A' polls
+    uint8_t decoded[sizeof(EngineStatus)];
+    const int frames = 200;
+    protocol->begin();
+    simulator->initialize();
+    simulator->setMode(EngineMode::LIGHT_LOAD);
+    
+    requestDelta(0);
+    uint16_t sequence = applyDeltaReply(decoded, sizeof(decoded));
+    
+    uint32_t bytes = 0;
+    for (int i = 0; i < frames; i++) {
+        delay(UPDATE_INTERVAL_MS / 10);
+        simulator->update();
+        requestDelta(sequence);
+        bytes += mockSerial->getOutputSize();
+        sequence = applyDeltaReply(decoded, sizeof(decoded));
+    }
+    TEST_ASSERT_EQUAL_MEMORY(&simulator->getSnapshot().status, decoded, sizeof(decoded));
+    TEST_ASSERT_LESS_THAN((uint32_t)frames * sizeof(EngineStatus), bytes);
+    
+    char message[96];
+    snprintf(message, sizeof(message), "Delta frames: %lu bytes/frame vs %u ('A'), %lu.%lux frame rate",
+             (unsigned long)(bytes / frames), (unsigned)sizeof(EngineStatus),
+             (unsigned long)((uint32_t)frames * sizeof(EngineStatus) / bytes),
+             (unsigned long)((uint32_t)frames * sizeof(EngineStatus) * 10 / bytes % 10));
+    TEST_MESSAGE(message);
+}
+
+// ============================================
+// Protocol Server Tests
+// ============================================
+
+void test_protocol_server_independent_sessions() {
+    ProtocolServer server(simulator, timeProvider, pageStore);
+    MockSerial clients[PROTOCOL_SERVER_MAX_SESSIONS + 1];
+    simulator->initialize();
+    
+    for (uint8_t i = 0; i < PROTOCOL_SERVER_MAX_SESSIONS; i++) {
+        TEST_ASSERT_EQUAL(i, server.attach(&clients[i]));
+        TEST_ASSERT_TRUE(clients[i].isAsyncTransmit());
+    }
+    TEST_ASSERT_EQUAL(-1, server.attach(&clients[PROTOCOL_SERVER_MAX_SESSIONS]));
+    TEST_ASSERT_EQUAL(1, server.getRejectedCount());
+    
+    // Different requests per client, answered in one pass without flushes
+    clients[0].addInput('A');
+    clients[1].addInput('Q');
+    clients[1].addInput('A');
+    TEST_ASSERT_EQUAL(3, server.update());
+    
+    const EngineSnapshot& snapshot = simulator->getSnapshot();
+    TEST_ASSERT_EQUAL(sizeof(EngineStatus), clients[0].getOutputSize());
+    TEST_ASSERT_EQUAL_MEMORY(&snapshot.status, clients[0].getOutput(), sizeof(EngineStatus));
+    TEST_ASSERT_EQUAL(4 + sizeof(EngineStatus), clients[1].getOutputSize());
+    TEST_ASSERT_EQUAL_MEMORY(&snapshot.status, clients[1].getOutput() + 4, sizeof(EngineStatus));
+    TEST_ASSERT_EQUAL(0, clients[2].getOutputSize());
+    
+    // Leftovers are sent before parsing, this pass's responses after it
+    for (uint8_t i = 0; i < PROTOCOL_SERVER_MAX_SESSIONS; i++) {
+        TEST_ASSERT_EQUAL(0, clients[i].getFlushCount());
+        TEST_ASSERT_EQUAL(2, clients[i].getPollCount());
+    }
+    TEST_ASSERT_EQUAL(2, server.getSession(1)->getCommandCount());
+    TEST_ASSERT_EQUAL(0, server.getSession(2)->getCommandCount());
+}
+
+void test_protocol_server_ends_closed_sessions() {
+    ProtocolServer server(simulator, timeProvider);
+    MockSerial first;
+    MockSerial second;
+    simulator->initialize();
+    
+    server.attach(&first);
+    server.attach(&second);
+    first.setReady(false);
+    second.addInput('A');
+    server.update();
+    
+    TEST_ASSERT_EQUAL(1, server.getSessionCount());
+    TEST_ASSERT_NULL(server.getSession(0));
+    TEST_ASSERT_EQUAL(sizeof(EngineStatus), second.getOutputSize());
+    
+    // The freed slot is reused with fresh session state
+    MockSerial third;
+    TEST_ASSERT_EQUAL(0, server.attach(&third));
+    TEST_ASSERT_EQUAL(0, server.getSession(0)->getCommandCount());
+    TEST_ASSERT_EQUAL(3, server.getAcceptedCount());
+}
+
+void test_protocol_server_throughput() {
+    // Host stand-in for N TCP clients: every client polls 'A' in each pass
+    const uint8_t polls = 8;
+    const uint16_t passes = 200;
+    ProtocolServer server(simulator, timeProvider);
+    MockSerial clients[PROTOCOL_SERVER_MAX_SESSIONS];
+    simulator->initialize();
+    simulator->update();
+    
+    for (uint8_t i = 0; i < PROTOCOL_SERVER_MAX_SESSIONS; i++) {
+        server.attach(&clients[i]);
+    }
+    
+    uint32_t frames = 0;
+    uint32_t elapsed = 0;
+    for (uint16_t pass = 0; pass < passes; pass++) {
+        for (uint8_t i = 0; i < PROTOCOL_SERVER_MAX_SESSIONS; i++) {
+            clients[i].clear();
+            for (uint8_t j = 0; j < polls; j++) {
+                clients[i].addInput('A');
+            }
+        }
+        
+        uint32_t start = timeProvider->micros();
+        frames += server.update();
+        elapsed += timeProvider->micros() - start;
+        
+        for (uint8_t i = 0; i < PROTOCOL_SERVER_MAX_SESSIONS; i++) {
+            TEST_ASSERT_EQUAL(polls * sizeof(EngineStatus), clients[i].getOutputSize());
+        }
+    }
+    TEST_ASSERT_EQUAL((uint32_t)passes * polls * PROTOCOL_SERVER_MAX_SESSIONS, frames);
+    
+    char message[96];
+    snprintf(message, sizeof(message), "%u clients: %lu 'A' frames/s (%lu ns per frame)",
+             PROTOCOL_SERVER_MAX_SESSIONS,
+             (unsigned long)(elapsed > 0 ? (uint64_t)frames * 1000000UL / elapsed : 0),
+             (unsigned long)((uint64_t)elapsed * 1000UL / frames));
+    TEST_MESSAGE(message);
+}
+
+// ============================================
+// Link Tests
+// ============================================
+
+static void addBaudRequest(uint32_t baud) {
+    mockSerial->addInput('u');
+    for (uint8_t i = 0; i < 4; i++) {
+        mockSerial->addInput(static_cast<uint8_t>(baud >> (8 * i)));
+    }
+}
+
+void test_baud_switch_confirmed() {
+    protocol->begin();
+    simulator->initialize();
+    TEST_ASSERT_EQUAL_UINT32(SERIAL_BAUD_RATE, mockSerial->getBaudRate());
+    
+    // Unsupported rate: error byte, no switch
+    addBaudRequest(12345);
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(1, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_HEX8(0xFF, mockSerial->getOutput()[0]);
+    TEST_ASSERT_EQUAL_UINT32(SERIAL_BAUD_RATE, protocol->getBaudRate());
+    mockSerial->clear();
+    
+    // Acknowledged at the old rate, then switched
+    addBaudRequest(1000000);
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(1, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK, mockSerial->getOutput()[0]);
+    TEST_ASSERT_EQUAL_UINT32(1000000, mockSerial->getBaudRate());
+    TEST_ASSERT_TRUE(protocol->isBaudRatePending());
+    mockSerial->clear();
+    
+    // A valid request at the new rate confirms it for good
+    delay(2);
+    mockSerial->addInput('S');
+    protocol->processCommands();
+    TEST_ASSERT_FALSE(protocol->isBaudRatePending());
+    
+    delay(SERIAL_BAUD_CONFIRM_MS + 10);
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL_UINT32(1000000, mockSerial->getBaudRate());
+    TEST_ASSERT_EQUAL(0, protocol->getBaudFallbackCount());
+}
+
+void test_baud_switch_falls_back() {
+    protocol->begin();
+    simulator->initialize();
+    
+    addBaudRequest(57600);
+    mockSerial->addInput('S');  // Sent before the client switched: discarded
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL_UINT32(57600, mockSerial->getBaudRate());
+    
+    // Only garbage arrives at the new rate
+    mockSerial->addInput(0xF3);
+    protocol->processCommands();
+    TEST_ASSERT_TRUE(protocol->isBaudRatePending());
+    
+    delay(SERIAL_BAUD_CONFIRM_MS + 10);
+    protocol->processCommands();
+    TEST_ASSERT_FALSE(protocol->isBaudRatePending());
+    TEST_ASSERT_EQUAL_UINT32(SERIAL_BAUD_RATE, mockSerial->getBaudRate());
+    TEST_ASSERT_EQUAL_UINT32(SERIAL_BAUD_RATE, protocol->getBaudRate());
+    TEST_ASSERT_EQUAL(1, protocol->getBaudFallbackCount());
+}
+
+void test_link_self_test() {
+    const uint16_t length = PROTOCOL_RX_BUFFER_SIZE - 2;
+    protocol->begin();
+    simulator->initialize();
+    
+    mockSerial->addInput('l');
+    mockSerial->addInput(length & 0xFF);
+    mockSerial->addInput(length >> 8);
+    for (uint16_t i = 0; i < length; i++) {
+        uint8_t byte = SpeeduinoProtocol::selfTestPattern(i);
+        mockSerial->addInput((i == 5 || i == 40) ? byte ^ 0x10 : byte);  // Two bit errors
+    }
+    protocol->processCommands();
+    
+    const uint8_t* output = mockSerial->getOutput();
+    TEST_ASSERT_EQUAL(2 + length, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL(2, output[0] | (output[1] << 8));
+    for (uint16_t i = 0; i < length; i++) {
+        TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::selfTestPattern(i), output[2 + i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(length, protocol->getSelfTestBytes());
+    TEST_ASSERT_EQUAL_UINT32(2, protocol->getSelfTestErrors());
+    
+    // Too long for the receive buffer: consumed and rejected
+    mockSerial->clear();
+    mockSerial->addInput('l');
+    mockSerial->addInput((length + 1) & 0xFF);
+    mockSerial->addInput((length + 1) >> 8);
+    for (uint16_t i = 0; i <= length; i++) {
+        mockSerial->addInput(SpeeduinoProtocol::selfTestPattern(i));
+    }
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(1, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_HEX8(0xFF, mockSerial->getOutput()[0]);
+}
+
+// ============================================
+// Tooth Logger Tests
+// ============================================
+
+static const uint8_t STATUS1_TOOTH_LOG_READY = 0x40;
+
+// Spin the engine up so the trigger wheel turns at a useful speed
+static void startEngine() {
+    simulator->initialize();
+    simulator->setMode(EngineMode::ACCELERATION);
+    for (int i = 0; i < 20; i++) {
+        delay(UPDATE_INTERVAL_MS);
+        simulator->update();
+    }
+}
+
+static bool runUntilToothLogReady() {
+    for (int i = 0; i < 100; i++) {
+        delay(UPDATE_INTERVAL_MS);
+        simulator->update();
+        if (simulator->getStatus().status1 & STATUS1_TOOTH_LOG_READY) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t readLE32(const uint8_t* data) {
+    return data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+// Tooth / composite log entry times (MSB first, as the firmware sends them)
+static uint32_t readBE32(const uint8_t* data) {
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+void test_tooth_log_ring_overwrites_oldest() {
+    ToothLog* log = new ToothLog();
+    ToothLogEntry entries[4];
+    
+    for (uint32_t i = 0; i < TOOTH_LOG_BUFFER_SIZE + 10; i++) {
+        log->push(i, 0);
+    }
+    TEST_ASSERT_EQUAL(TOOTH_LOG_BUFFER_SIZE, log->available());
+    
+    // The 10 oldest entries were overwritten and are counted, not returned
+    TEST_ASSERT_EQUAL(4, log->read(entries, 4));
+    TEST_ASSERT_EQUAL(10, log->getDropped());
+    for (uint8_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(10 + i, entries[i].time);
+    }
+    TEST_ASSERT_EQUAL(TOOTH_LOG_BUFFER_SIZE - 4, log->available());
+    
+    log->clear();
+    TEST_ASSERT_EQUAL(0, log->available());
+    TEST_ASSERT_EQUAL(0, log->read(entries, 4));
+    delete log;
+}
+
+void test_tooth_logger_gaps() {
+    protocol->begin();
+    startEngine();
+    
+    mockSerial->addInput('H');
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(0, mockSerial->getOutputSize());  // Legacy start has no reply
+    TEST_ASSERT_TRUE(runUntilToothLogReady());
+    
+    mockSerial->addInput('T');
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(TOOTH_LOG_SIZE * 4, mockSerial->getOutputSize());
+    
+    // Even gaps, stretched to twice the length by the missing tooth once
+    // every TRIGGER_TEETH - TRIGGER_MISSING_TEETH teeth
+    const uint8_t* output = mockSerial->getOutput();
+    uint16_t rpm = simulator->getStatus().getRPM();
+    uint32_t expectedGap = 60000000UL / ((uint32_t)rpm * TRIGGER_TEETH);
+    int lastLong = -1;
+    uint16_t longGaps = 0;
+    for (uint16_t i = 1; i < TOOTH_LOG_SIZE; i++) {
+        uint32_t gap = readBE32(&output[4 * i]);
+        uint32_t previous = readBE32(&output[4 * (i - 1)]);
+        TEST_ASSERT_GREATER_THAN(expectedGap / 2, gap);
+        TEST_ASSERT_LESS_THAN(expectedGap * 3, gap);
+        
+        if (gap > previous + previous / 2) {
+            TEST_ASSERT_LESS_THAN(previous * 2 + previous / 10, gap);
+            if (lastLong >= 0) {
+                TEST_ASSERT_EQUAL(TRIGGER_TEETH - TRIGGER_MISSING_TEETH, i - lastLong);
+            }
+            lastLong = i;
+            longGaps++;
+        }
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL((TOOTH_LOG_SIZE - 1) / (TRIGGER_TEETH - TRIGGER_MISSING_TEETH), longGaps);
+    
+    mockSerial->clear();
+    mockSerial->addInput('h');
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(ToothLogMode::OFF, simulator->getToothLogMode());
+}
+
+void test_composite_logger_framed() {
+    protocol->begin();
+    startEngine();
+    
+    const uint8_t start[] = { 'J' };
+    addFrame(start, sizeof(start));
+    const uint8_t fetch[] = { 'O' };
+    addFrame(fetch, sizeof(fetch));  // Nothing logged yet
+    const uint8_t wrongLogger[] = { 'T' };
+    addFrame(wrongLogger, sizeof(wrongLogger));
+    protocol->processCommands();
+    
+    const uint8_t* output = mockSerial->getOutput();
+    TEST_ASSERT_EQUAL(3 * 7, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK, checkFrame(output, 7, 0));
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_BUSY_ERROR, checkFrame(&output[7], 7, 0));
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_RANGE_ERROR, checkFrame(&output[14], 7, 0));
+    
+    TEST_ASSERT_TRUE(runUntilToothLogReady());
+    mockSerial->clearOutput();
+    addFrame(fetch, sizeof(fetch));
+    protocol->processCommands();
+    
+    const uint16_t dataSize = TOOTH_LOG_SIZE * 5;
+    output = mockSerial->getOutput();
+    TEST_ASSERT_EQUAL(dataSize + 7, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK, checkFrame(output, dataSize + 7, dataSize));
+    
+    // Timestamps increase; primary teeth are trigger events, cam edges are not
+    uint16_t camEdges = 0;
+    uint16_t synced = 0;
+    for (uint16_t i = 0; i < TOOTH_LOG_SIZE; i++) {
+        const uint8_t* entry = &output[3 + 5 * i];
+        uint8_t flags = entry[4];
+        if (i > 0) {
+            TEST_ASSERT_GREATER_THAN(readBE32(entry - 5), readBE32(entry));
+        }
+        TEST_ASSERT_EQUAL((flags & COMPOSITE_LOG_PRI) != 0, (flags & COMPOSITE_LOG_TRIG) != 0);
+        if (flags & COMPOSITE_LOG_SEC) camEdges++;
+        if (flags & COMPOSITE_LOG_SYNC) synced++;
+    }
+    
+    // Sync follows the first missing tooth, the cam edge comes every second
+    // revolution (a packet shorter than that may show neither)
+    if (TOOTH_LOG_SIZE > 2 * TRIGGER_TEETH) {
+        TEST_ASSERT_GREATER_THAN(0, synced);
+        TEST_ASSERT_GREATER_OR_EQUAL(1, camEdges);
+    }
+}
+
+void test_tooth_log_overload_drops_oldest() {
+    protocol->begin();
+    startEngine();
+    
+    mockSerial->addInput('H');
+    protocol->processCommands();
+    delay(UPDATE_INTERVAL_MS);
+    simulator->update();
+    
+    // Nobody fetches for a while: the ring wraps instead of holding up the loop
+    for (int i = 0; i < 30; i++) {
+        delay(UPDATE_INTERVAL_MS);
+        simulator->update();
+    }
+    ToothLog& log = simulator->getToothLog();
+    TEST_ASSERT_EQUAL(TOOTH_LOG_BUFFER_SIZE, log.available());
+    
+    // A stall beyond UPDATE_MAX_STEPS: the dropped time's teeth are counted,
+    // not generated
+    uint32_t pushed = log.getPushed();
+    delay(1500);
+    uint32_t start = timeProvider->micros();
+    simulator->update();
+    uint32_t updateUs = timeProvider->micros() - start;
+    
+    TEST_ASSERT_GREATER_THAN(0, log.getDropped());
+    TEST_ASSERT_LESS_THAN(20000, updateUs);
+    uint32_t simulatedTeeth = ((uint32_t)UPDATE_MAX_STEPS * SIM_STEP_MS * RPM_MAX / 60000 + 1) * TRIGGER_TEETH;
+    TEST_ASSERT_LESS_OR_EQUAL(simulatedTeeth, log.getPushed() - pushed);
+    
+    // The newest entries are still served as a normal packet
+    mockSerial->addInput('T');
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(TOOTH_LOG_SIZE * 4, mockSerial->getOutputSize());
+    TEST_ASSERT_GREATER_THAN(0, readBE32(mockSerial->getOutput()));
+}
+
+// ============================================
+// Frame Log Tests
+// ============================================
+
+// Fill the log with a known byte pattern
+static void fillFrameLog(MockFrameLogStorage* storage, uint32_t bytes) {
+    for (uint32_t i = 0; i < bytes; i++) {
+        uint8_t byte = (uint8_t)(i * 7 + (i >> 8));
+        storage->append(&byte, 1);
+    }
+}
+
+// Check one legacy 'y' chunk; returns its data length
+static uint16_t checkLogChunk(const uint8_t* chunk, size_t chunkSize, uint32_t offset, uint32_t end) {
+    uint16_t length = chunk[8] | (chunk[9] << 8);
+    TEST_ASSERT_EQUAL(10 + length + 4, chunkSize);
+    TEST_ASSERT_EQUAL_UINT32(offset, readLE32(&chunk[0]));
+    TEST_ASSERT_EQUAL_UINT32(end, readLE32(&chunk[4]));
+    TEST_ASSERT_EQUAL_HEX32(Crc32::compute(chunk, 10 + length), readLE32(&chunk[10 + length]));
+    return length;
+}
+
+static void addLogDownload(uint32_t offset, bool framed) {
+    const uint8_t request[] = { 'y', (uint8_t)offset, (uint8_t)(offset >> 8),
+                                (uint8_t)(offset >> 16), (uint8_t)(offset >> 24) };
+    if (framed) {
+        addFrame(request, sizeof(request));
+    } else {
+        for (uint8_t i = 0; i < sizeof(request); i++) {
+            mockSerial->addInput(request[i]);
+        }
+    }
+}
+
+void test_frame_log_records_snapshots() {
+    MockFrameLogStorage* storage = new MockFrameLogStorage();
+    FrameLog* log = new FrameLog(simulator, storage);
+    simulator->initialize();
+    TEST_ASSERT_TRUE(log->begin());
+    
+    // First snapshot right away, then one every FRAME_LOG_INTERVAL ticks
+    TEST_ASSERT_TRUE(log->update());
+    TEST_ASSERT_FALSE(log->update());
+    uint32_t firstGeneration = simulator->getGeneration();
+    for (int i = 0; i < FRAME_LOG_INTERVAL * 2; i++) {
+        delay(UPDATE_INTERVAL_MS);
+        simulator->update();
+        log->update();
+    }
+    uint32_t ticks = simulator->getGeneration() - firstGeneration;
+    TEST_ASSERT_EQUAL_UINT32(1 + ticks / FRAME_LOG_INTERVAL, log->getRecordCount());
+    TEST_ASSERT_EQUAL_UINT32(log->getRecordCount() * FRAME_LOG_RECORD_SIZE, log->size());
+    
+    // Records hold the generation and the 'A' bytes of their snapshot
+    const uint8_t* records = storage->getData();
+    TEST_ASSERT_EQUAL_UINT32(firstGeneration, readLE32(records));
+    for (uint32_t i = 1; i < log->getRecordCount(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(firstGeneration + i * FRAME_LOG_INTERVAL,
+                                 readLE32(&records[i * FRAME_LOG_RECORD_SIZE]));
+    }
+    
+    // Full storage: the oldest frames are kept, the rest counted as dropped
+    uint32_t fullSize = log->size();
+    storage->setCapacity(fullSize);
+    for (int i = 0; i < FRAME_LOG_INTERVAL; i++) {
+        delay(UPDATE_INTERVAL_MS);
+        simulator->update();
+        log->update();
+    }
+    TEST_ASSERT_EQUAL(1, log->getDroppedCount());
+    TEST_ASSERT_EQUAL_UINT32(fullSize, log->size());
+    
+    delete log;
+    delete storage;
+}
+
+void test_frame_log_download_chunks() {
+    const uint32_t logBytes = 2 * FRAME_LOG_CHUNK_SIZE + 88;
+    MockFrameLogStorage* storage = new MockFrameLogStorage();
+    FrameLog* log = new FrameLog(simulator, storage);
+    fillFrameLog(storage, logBytes);
+    TEST_ASSERT_TRUE(log->begin());
+    protocol->setFrameLog(log);
+    protocol->begin();
+    
+    // One chunk per pass, then a final empty chunk
+    addLogDownload(0, false);
+    uint32_t offset = 0;
+    uint8_t chunks = 0;
+    do {
+        mockSerial->clearOutput();
+        protocol->processCommands();
+        const uint8_t* output = mockSerial->getOutput();
+        uint16_t length = checkLogChunk(output, mockSerial->getOutputSize(), offset, logBytes);
+        TEST_ASSERT_EQUAL_MEMORY(&storage->getData()[offset], &output[10], length);
+        offset += length;
+        chunks++;
+    } while (protocol->isDownloading() && chunks < 10);
+    
+    TEST_ASSERT_FALSE(protocol->isDownloading());
+    TEST_ASSERT_EQUAL(4, chunks);
+    TEST_ASSERT_EQUAL_UINT32(logBytes, offset);
+    
+    // Nothing more until the next request
+    mockSerial->clearOutput();
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(0, mockSerial->getOutputSize());
+    
+    delete log;
+    delete storage;
+}
+
+void test_frame_log_resume_framed_and_clear() {
+    const uint32_t logBytes = 2 * FRAME_LOG_CHUNK_SIZE + 88;
+    MockFrameLogStorage* storage = new MockFrameLogStorage();
+    FrameLog* log = new FrameLog(simulator, storage);
+    fillFrameLog(storage, logBytes);
+    TEST_ASSERT_TRUE(log->begin());
+    protocol->setFrameLog(log);
+    protocol->begin();
+    
+    // Resume after the first two chunks: the tail, framed like the request
+    addLogDownload(2 * FRAME_LOG_CHUNK_SIZE, true);
+    protocol->processCommands();
+    const uint8_t* output = mockSerial->getOutput();
+    TEST_ASSERT_EQUAL(7 + 14 + 88, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK, checkFrame(output, 7 + 14 + 88, 14 + 88));
+    TEST_ASSERT_EQUAL(88, checkLogChunk(&output[3], 14 + 88, 2 * FRAME_LOG_CHUNK_SIZE, logBytes));
+    TEST_ASSERT_EQUAL_MEMORY(&storage->getData()[2 * FRAME_LOG_CHUNK_SIZE], &output[13], 88);
+    
+    mockSerial->clearOutput();
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK, checkFrame(mockSerial->getOutput(), 7 + 14, 14));
+    TEST_ASSERT_EQUAL(0, checkLogChunk(&mockSerial->getOutput()[3], 14, logBytes, logBytes));
+    TEST_ASSERT_FALSE(protocol->isDownloading());
+    
+    // 'Y' erases the log
+    mockSerial->clearOutput();
+    const uint8_t clear[] = { 'Y' };
+    addFrame(clear, sizeof(clear));
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL_HEX8(SpeeduinoProtocol::RC_OK, checkFrame(mockSerial->getOutput(), 7, 0));
+    TEST_ASSERT_EQUAL_UINT32(0, log->size());
+    
+    // Without a log the command is rejected (legacy client, after a pause)
+    protocol->setFrameLog(nullptr);
+    mockSerial->clear();
+    delay(SERIAL_TIMEOUT_MS + 10);
+    addLogDownload(0, false);
+    protocol->processCommands();
+    TEST_ASSERT_EQUAL(1, mockSerial->getOutputSize());
+    TEST_ASSERT_EQUAL_HEX8(0xFF, mockSerial->getOutput()[0]);
+    TEST_ASSERT_FALSE(protocol->isDownloading());
+    
+    delete log;
+    delete storage;
+}
+
+void test_frame_log_download_throughput() {
+    const uint32_t logBytes = 16 * FRAME_LOG_CHUNK_SIZE;
+    MockFrameLogStorage* storage = new MockFrameLogStorage();
+    FrameLog* log = new FrameLog(simulator, storage);
+    fillFrameLog(storage, logBytes);
+    TEST_ASSERT_TRUE(log->begin());
+    protocol->setFrameLog(log);
+    protocol->begin();
+    
+    addLogDownload(0, false);
+    uint32_t wireBytes = 0;
+    uint32_t start = timeProvider->micros();
+    do {
+        mockSerial->clearOutput();
+        protocol->processCommands();
+        wireBytes += mockSerial->getOutputSize();
+    } while (protocol->isDownloading());
+    uint32_t elapsedUs = timeProvider->micros() - start;
+    TEST_ASSERT_EQUAL_UINT32(logBytes + 17 * 14, wireBytes);
+    
+    // An hour of recording at 2 Mbaud (10 bits per byte on the wire)
+    uint32_t hourBytes = 3600UL * (1000 / UPDATE_INTERVAL_MS) / FRAME_LOG_INTERVAL * FRAME_LOG_RECORD_SIZE;
+    uint32_t hourWire = (uint32_t)((uint64_t)hourBytes * wireBytes / logBytes);
+    
+    char message[112];
+    snprintf(message, sizeof(message), "Frame log: %lu us/chunk, %lu%% payload, 1 h (%lu KB) in %lu s at 2 Mbaud",
+             (unsigned long)(elapsedUs / 17), (unsigned long)((uint64_t)logBytes * 100 / wireBytes),
+             (unsigned long)(hourBytes / 1024), (unsigned long)(hourWire / 200000 + 1));
+    TEST_MESSAGE(message);
+    
+    delete log;
+    delete storage;
+}
+
+// ============================================
+// Tune Table Tests
+// ============================================
+
+void test_table_lookup_at_breakpoints() {
+    Table3D& ve = simulator->getVETable();
+    
+    // On a breakpoint pair the lookup is exactly the cell
+    for (uint8_t row = 0; row < TABLE3D_SIZE; row++) {
+        for (uint8_t col = 0; col < TABLE3D_SIZE; col++) {
+            TEST_ASSERT_EQUAL_UINT8(ve.getValue(row, col), ve.lookup(ve.getRpmBin(col), ve.getLoadBin(row)));
+        }
+    }
+    
+    // Beyond the axes: clamped to the edge cells
+    const uint8_t last = TABLE3D_SIZE - 1;
+    TEST_ASSERT_EQUAL_UINT8(ve.getValue(0, 0), ve.lookup(0, 0));
+    TEST_ASSERT_EQUAL_UINT8(ve.getValue(last, last), ve.lookup(20000, 250));
+    TEST_ASSERT_EQUAL_UINT8(ve.getValue(0, last), ve.lookup(20000, 0));
+    TEST_ASSERT_EQUAL_UINT8(ve.getValue(last, 0), ve.lookup(0, 250));
+}
+
+void test_table_bilinear_interpolation() {
+    Table3D& spark = simulator->getSparkTable();
+    spark.invalidate();
+    
+    // Every cell interior at a quarter and at the middle, against floating point
+    for (uint8_t row = 0; row + 1 < TABLE3D_SIZE; row++) {
+        for (uint8_t col = 0; col + 1 < TABLE3D_SIZE; col++) {
+            uint16_t rpmLow = spark.getRpmBin(col);
+            uint16_t loadLow = spark.getLoadBin(row);
+            float rpmSpan = spark.getRpmBin(col + 1) - rpmLow;
+            float loadSpan = spark.getLoadBin(row + 1) - loadLow;
+            
+            for (uint8_t quarter = 1; quarter <= 2; quarter++) {
+                uint16_t rpm = rpmLow + (uint16_t)(rpmSpan * quarter / 4);
+                uint16_t load = loadLow + (uint16_t)(loadSpan * quarter / 4);
+                float fx = (rpm - rpmLow) / rpmSpan;
+                float fy = (load - loadLow) / loadSpan;
+                float bottom = spark.getValue(row, col) * (1 - fx) + spark.getValue(row, col + 1) * fx;
+                float top = spark.getValue(row + 1, col) * (1 - fx) + spark.getValue(row + 1, col + 1) * fx;
+                float expected = bottom * (1 - fy) + top * fy;
+                
+                uint8_t value = spark.lookup(rpm, load);
+                TEST_ASSERT_TRUE(value >= expected - 1.0f && value <= expected + 1.0f);
+            }
+        }
+    }
+    
+    // Moving within a bin pair reuses the cached bins; crossing into the
+    // next RPM bin searches that axis once
+    spark.lookup(2100, 60);
+    uint32_t searches = spark.getBinSearches();
+    for (uint16_t rpm = 2100; rpm < 2500; rpm += 10) {
+        spark.lookup(rpm, 60);
+    }
+    TEST_ASSERT_EQUAL_UINT32(searches, spark.getBinSearches());
+    spark.lookup(2600, 60);
+    TEST_ASSERT_EQUAL_UINT32(searches + 1, spark.getBinSearches());
+}
+
+// Pre-table VE / advance branch ladders, the baseline for the lookup cost
+static uint8_t ladderVE(uint16_t rpm, uint8_t tps) {
+    uint8_t baseVE;
+    if (rpm < 1000) {
+        baseVE = 45;
+    } else if (rpm < 2000) {
+        baseVE = 55 + (rpm - 1000) / 50;
+    } else if (rpm < 4000) {
+        baseVE = 75 + (rpm - 2000) / 100;
+    } else if (rpm < 5500) {
+        baseVE = 85 + (rpm - 4000) / 200;
+    } else {
+        baseVE = 90 - (rpm - 5500) / 100;
+    }
+    baseVE = (baseVE * (50 + tps / 2)) / 100;
+    if (baseVE > 100) baseVE = 100;
+    if (baseVE < 30) baseVE = 30;
+    return baseVE;
+}
+
+static uint8_t ladderAdvance(uint16_t rpm, uint8_t load) {
+    uint8_t baseAdvance = TIMING_IDLE;
+    if (rpm > 1000) {
+        baseAdvance += (rpm - 1000) / 200;
+    }
+    if (load > 80) {
+        baseAdvance -= (load - 80) / 4;
+    } else if (load < 40) {
+        baseAdvance += (40 - load) / 8;
+    }
+    if (baseAdvance > TIMING_MAX) baseAdvance = TIMING_MAX;
+    if (baseAdvance < 5) baseAdvance = 5;
+    return baseAdvance;
+}
+
+void test_table_lookup_cost() {
+    Table3D& ve = simulator->getVETable();
+    Table3D& spark = simulator->getSparkTable();
+    const uint16_t iterations = 1000;  // Total microseconds == nanoseconds per VE + spark pair
+    
+    // A slow sweep like consecutive fuel / ignition stages (a few RPM and
+    // a fraction of a kPa apart), so most lookups stay within cached bins
+    volatile uint8_t sink = 0;
+    uint32_t start = timeProvider->micros();
+    for (uint16_t i = 0; i < iterations; i++) {
+        uint16_t rpm = 800 + i * 5;
+        uint8_t load = 30 + i / 16;
+        sink = ladderVE(rpm, load) + ladderAdvance(rpm, load);
+    }
+    uint32_t ladderNs = timeProvider->micros() - start;
+    
+    ve.invalidate();
+    spark.invalidate();
+    uint32_t searches = ve.getBinSearches() + spark.getBinSearches();
+    start = timeProvider->micros();
+    for (uint16_t i = 0; i < iterations; i++) {
+        uint16_t rpm = 800 + i * 5;
+        uint8_t load = 30 + i / 16;
+        sink = ve.lookup(rpm, load) + spark.lookup(rpm, load);
+    }
+    uint32_t cachedNs = timeProvider->micros() - start;
+    searches = ve.getBinSearches() + spark.getBinSearches() - searches;
+    
+    start = timeProvider->micros();
+    for (uint16_t i = 0; i < iterations; i++) {
+        uint16_t rpm = 800 + i * 5;
+        uint8_t load = 30 + i / 16;
+        ve.invalidate();
+        spark.invalidate();
+        sink = ve.lookup(rpm, load) + spark.lookup(rpm, load);
+    }
+    uint32_t searchNs = timeProvider->micros() - start;
+    (void)sink;
+    
+    char message[112];
+    #if defined(F_CPU)
+        // On the board: CPU cycles (Uno / Mega: 16 per microsecond)
+        const uint32_t scale = F_CPU / 1000000UL;
+        const char* unit = "cycles";
+    #else
+        const uint32_t scale = 1000;
+        const char* unit = "ns";
+    #endif
+    snprintf(message, sizeof(message), "VE + spark: ladder %lu, table %lu (%lu%% bin searches), uncached %lu %s",
+             (unsigned long)(ladderNs * scale / 1000), (unsigned long)(cachedNs * scale / 1000),
+             (unsigned long)(searches * 100UL / (4UL * iterations)), (unsigned long)(searchNs * scale / 1000), unit);
+    TEST_MESSAGE(message);
+    
+    // Sweeping slowly, nearly every axis lookup hits the cache
+    TEST_ASSERT_LESS_THAN(4UL * iterations / 10, searches);
+}
+
+// ============================================
+// Fixed Point Tests
+// ============================================
+
+void test_fixed_point_division_exact() {
+    // Multiply-shift is monotonic, so matching '/' on both sides of every
+    // step (k * d - 1 and k * d) proves it exact for everything in between
+    for (uint32_t k = 1; k <= 2000; k++) {
+        TEST_ASSERT_EQUAL_UINT32((k * 10 - 1) / 10, fpDiv10(k * 10 - 1));
+        TEST_ASSERT_EQUAL_UINT32(k, fpDiv10(k * 10));
+        TEST_ASSERT_EQUAL_UINT32((k * 100 - 1) / 100, fpDiv100(k * 100 - 1));
+        TEST_ASSERT_EQUAL_UINT32(k, fpDiv100(k * 100));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFUL / 100, fpDiv100(0xFFFFFFFFUL));
+    
+    // Signed: truncated toward zero like '/'
+    const int32_t values[] = { -32768, -1001, -999, -100, -99, -11, -10, -9, -1, 0, 1, 9, 99, 32767 };
+    for (uint8_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        TEST_ASSERT_EQUAL_INT32(values[i] / 10, fpDiv10Signed(values[i]));
+        TEST_ASSERT_EQUAL_INT32(values[i] / 100, fpDiv100Signed(values[i]));
+    }
+}
+
+void test_fixed_point_lerp() {
+    TEST_ASSERT_EQUAL_UINT16(40 * 256, fpLerp(40, 90, 0));
+    TEST_ASSERT_EQUAL_UINT16(90 * 256, fpLerp(40, 90, 256));
+    TEST_ASSERT_EQUAL_UINT16(65 * 256, fpLerp(40, 90, 128));
+    TEST_ASSERT_EQUAL_UINT16(255 * 256, fpLerp(255, 255, 100));
+    
+    TEST_ASSERT_EQUAL_UINT8(40, fpLerpRound(40 * 256, 90 * 256, 0));
+    TEST_ASSERT_EQUAL_UINT8(90, fpLerpRound(40 * 256, 90 * 256, 256));
+    TEST_ASSERT_EQUAL_UINT8(255, fpLerpRound(255 * 256, 255 * 256, 128));
+    
+    // 10.5 rounds up, 10.25 down
+    TEST_ASSERT_EQUAL_UINT8(11, fpLerpRound(10 * 256, 11 * 256, 128));
+    TEST_ASSERT_EQUAL_UINT8(10, fpLerpRound(10 * 256, 11 * 256, 64));
+}
+
+void test_fixed_point_cost() {
+    const uint16_t iterations = 1000;  // Total microseconds == nanoseconds per operation
+    
+    // Fuel stage operand, read through volatile so nothing is folded
+    volatile uint16_t product = 357 * 111;
+    volatile uint32_t sink = 0;
+    
+    uint32_t start = timeProvider->micros();
+    for (uint16_t i = 0; i < iterations; i++) {
+        sink = product / 100;
+    }
+    uint32_t div100Ns = timeProvider->micros() - start;
+    
+    start = timeProvider->micros();
+    for (uint16_t i = 0; i < iterations; i++) {
+        sink = fpDiv100(product);
+    }
+    uint32_t fpDiv100Ns = timeProvider->micros() - start;
+    (void)sink;
+    
+    char message[64];
+    #if defined(F_CPU)
+        // On the board: CPU cycles (Uno / Mega: 16 per microsecond)
+        const uint32_t scale = F_CPU / 1000000UL;
+        const char* unit = "cycles";
+    #else
+        const uint32_t scale = 1000;
+        const char* unit = "ns";
+    #endif
+    snprintf(message, sizeof(message), "/100 %lu vs fpDiv100 %lu %s",
+             (unsigned long)(div100Ns * scale / 1000), (unsigned long)(fpDiv100Ns * scale / 1000), unit);
+    TEST_MESSAGE(message);
+    
+    #if defined(__AVR__)
+        // The reason the helper exists: on the Uno / Mega it must win
+        TEST_ASSERT_LESS_THAN(div100Ns, fpDiv100Ns);
+    #endif
+}
+
+// ============================================
+// Random Tests
+// ============================================
+
+void test_fast_random_reproducible() {
+    FastRandom first;
+    FastRandom second;
+    first.seed(12345);
+    second.seed(12345);
+    for (uint8_t i = 0; i < 100; i++) {
+        TEST_ASSERT_EQUAL_UINT32(first.next(), second.next());
+    }
+    
+    second.seed(12346);
+    TEST_ASSERT_NOT_EQUAL(first.next(), second.next());
+    
+    // Zero would be a fixed point of xorshift
+    first.seed(0);
+    TEST_ASSERT_NOT_EQUAL(0, first.next());
+    TEST_ASSERT_NOT_EQUAL(0, first.next());
+}
+
+void test_fast_random_bounds() {
+    FastRandom rng;
+    rng.seed(7);
+    
+    // Arduino random() semantics: [min, max), every value reachable
+    uint32_t seen = 0;
+    for (uint16_t i = 0; i < 2000; i++) {
+        int32_t value = rng.random(-10, 10);
+        TEST_ASSERT_TRUE(value >= -10 && value < 10);
+        seen |= 1UL << (value + 10);
+    }
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFF, seen);
+    for (uint16_t i = 0; i < 200; i++) {
+        int32_t value = rng.random(100);
+        TEST_ASSERT_TRUE(value >= 0 && value < 100);
+    }
+    TEST_ASSERT_EQUAL_INT32(5, rng.random(5, 5));
+    
+    // Noise: [-range, range], centered
+    uint8_t pool[NOISE_POOL_SIZE];
+    int32_t sum = 0;
+    seen = 0;
+    for (uint8_t batch = 0; batch < 32; batch++) {
+        rng.fillNoise(pool, sizeof(pool));
+        for (uint8_t i = 0; i < sizeof(pool); i++) {
+            int8_t noise = FastRandom::boundNoise(pool[i], 3);
+            TEST_ASSERT_TRUE(noise >= -3 && noise <= 3);
+            seen |= 1UL << (noise + 3);
+            sum += noise;
+        }
+    }
+    TEST_ASSERT_EQUAL_HEX32(0x7F, seen);
+    TEST_ASSERT_INT32_WITHIN(32 * NOISE_POOL_SIZE / 10, 0, sum);
+    TEST_ASSERT_EQUAL_INT8(0, FastRandom::boundNoise(0xFF, 0));
+    TEST_ASSERT_EQUAL_INT8(-5, FastRandom::boundNoise(0x00, 5));
+    TEST_ASSERT_EQUAL_INT8(5, FastRandom::boundNoise(0xFF, 5));
+}
+
+void test_random_draw_cost() {
+    const uint16_t iterations = 1024;  // Multiple of NOISE_POOL_SIZE
+    volatile int32_t sink = 0;
+    
+    // Sensor noise (+/-2, like MAP) through the interface, inline, and pooled
+    uint32_t start = timeProvider->micros();
+    for (uint16_t i = 0; i < iterations; i++) {
+        sink = randomProvider->random(-2, 3);
+    }
+    uint32_t providerUs = timeProvider->micros() - start;
+    
+    FastRandom rng;
+    rng.seed(1);
+    start = timeProvider->micros();
+    for (uint16_t i = 0; i < iterations; i++) {
+        sink = rng.random(-2, 3);
+    }
+    uint32_t inlineUs = timeProvider->micros() - start;
+    
+    uint8_t pool[NOISE_POOL_SIZE];
+    start = timeProvider->micros();
+    for (uint16_t i = 0; i < iterations; i += NOISE_POOL_SIZE) {
+        rng.fillNoise(pool, NOISE_POOL_SIZE);
+        for (uint8_t j = 0; j < NOISE_POOL_SIZE; j++) {
+            sink = FastRandom::boundNoise(pool[j], 2);
+        }
+    }
+    uint32_t pooledUs = timeProvider->micros() - start;
+    (void)sink;
+    
+    char message[96];
+    snprintf(message, sizeof(message), "Noise draw: IRandomProvider %lu ns, FastRandom %lu ns, pooled %lu ns",
+             (unsigned long)(providerUs * 1000UL / iterations), (unsigned long)(inlineUs * 1000UL / iterations),
+             (unsigned long)(pooledUs * 1000UL / iterations));
+    TEST_MESSAGE(message);
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+void setup() {
+    delay(2000);  // Wait for serial to stabilize
+    
+    UNITY_BEGIN();
+    
+    // Engine Simulator Tests
+    RUN_TEST(test_simulator_initialization);
+    RUN_TEST(test_rpm_stays_within_bounds);
+    RUN_TEST(test_coolant_temperature_increases);
+    RUN_TEST(test_map_correlates_with_throttle);
+    RUN_TEST(test_volumetric_efficiency);
+    RUN_TEST(test_engine_status_size);
+    RUN_TEST(test_snapshot_generation_increments);
+    RUN_TEST(test_snapshot_stable_across_update);
+    RUN_TEST(test_update_catches_up_late_steps);
+    RUN_TEST(test_update_clamps_long_stall);
+    RUN_TEST(test_stage_schedule);
+    RUN_TEST(test_rpm_ramp_at_stage_rate);
+    RUN_TEST(test_runtime_tracking);
+    
+    // Protocol Tests
+    RUN_TEST(test_command_A_realtime_data);
+    RUN_TEST(test_command_r_ranged_read);
+    RUN_TEST(test_command_r_out_of_range);
+    RUN_TEST(test_command_V_version);
+    RUN_TEST(test_command_Q_status);
+    RUN_TEST(test_command_S_signature);
+    RUN_TEST(test_command_n_page_sizes);
+    RUN_TEST(test_unknown_command);
+    RUN_TEST(test_command_counter);
+    RUN_TEST(test_per_command_counts);
+    RUN_TEST(test_no_command_available);
+    
+    // Drain Mode Tests
+    RUN_TEST(test_drain_handshake_single_call);
+    RUN_TEST(test_drain_respects_command_budget);
+    RUN_TEST(test_handshake_latency_drain_vs_single);
+    
+    // Async Transmit Tests
+    RUN_TEST(test_sync_transmit_flushes_each_response);
+    RUN_TEST(test_async_transmit_skips_flush);
+    RUN_TEST(test_loop_time_async_vs_sync);
+    
+    // Latency Statistics Tests
+    RUN_TEST(test_latency_histogram_buckets);
+    RUN_TEST(test_command_D_diagnostics);
+    
+    // Streaming Tests
+    RUN_TEST(test_stream_pushes_every_tick);
+    RUN_TEST(test_stream_subset_and_interval);
+    RUN_TEST(test_stream_out_of_range);
+    
+    // Framed Protocol Tests
+    RUN_TEST(test_crc32_known_value);
+    RUN_TEST(test_framed_status_request);
+    RUN_TEST(test_framed_crc_error_and_resync);
+    RUN_TEST(test_framed_lost_header_not_executed);
+    RUN_TEST(test_framed_session_legacy_fallback);
+    RUN_TEST(test_legacy_command_after_framed_session);
+    RUN_TEST(test_crc32_cost_per_frame);
+    
+    // Request Parser Tests
+    RUN_TEST(test_ranged_read_split_across_calls);
+    RUN_TEST(test_frame_split_across_calls);
+    RUN_TEST(test_partial_request_timeout_resync);
+    RUN_TEST(test_partial_request_survives_loop_stall);
+    
+    // Tune Page Tests
+    RUN_TEST(test_page_write_and_read);
+    RUN_TEST(test_page_range_errors);
+    RUN_TEST(test_burn_writes_only_changed_bytes);
+    RUN_TEST(test_framed_page_commands);
+    RUN_TEST(test_oversized_page_write_resync);
+    RUN_TEST(test_burn_throughput_and_wear);
+    
+    // Response Gathering Tests
+    RUN_TEST(test_pipelined_responses_gathered);
+    RUN_TEST(test_gathered_page_read_before_write);
+    
+    // Flash Reply Tests
+    RUN_TEST(test_flash_replies_legacy_and_framed);
+    
+    // Output Layout Tests
+    RUN_TEST(test_legacy_layout_is_default);
+    RUN_TEST(test_extended_layout_select);
+    RUN_TEST(test_output_layout_per_session);
+    
+    // Delta Frame Tests
+    RUN_TEST(test_delta_frames_track_snapshot);
+    RUN_TEST(test_delta_keyframe_recovery);
+    RUN_TEST(test_delta_bandwidth);
+    
+    // Protocol Server Tests
+    RUN_TEST(test_protocol_server_independent_sessions);
+    RUN_TEST(test_protocol_server_ends_closed_sessions);
+    RUN_TEST(test_protocol_server_throughput);
+    
+    // Link Tests
+    RUN_TEST(test_baud_switch_confirmed);
+    RUN_TEST(test_baud_switch_falls_back);
+    RUN_TEST(test_link_self_test);
+    
+    // Tooth Logger Tests
+    RUN_TEST(test_tooth_log_ring_overwrites_oldest);
+    RUN_TEST(test_tooth_logger_gaps);
+    RUN_TEST(test_composite_logger_framed);
+    RUN_TEST(test_tooth_log_overload_drops_oldest);
+    
+    // Frame Log Tests
+    RUN_TEST(test_frame_log_records_snapshots);
+    RUN_TEST(test_frame_log_download_chunks);
+    RUN_TEST(test_frame_log_resume_framed_and_clear);
+    RUN_TEST(test_frame_log_download_throughput);
+    
+    // Tune Table Tests
+    RUN_TEST(test_table_lookup_at_breakpoints);
+    RUN_TEST(test_table_bilinear_interpolation);
+    RUN_TEST(test_table_lookup_cost);
+    
+    // Fixed Point Tests
+    RUN_TEST(test_fixed_point_division_exact);
+    RUN_TEST(test_fixed_point_lerp);
+    RUN_TEST(test_fixed_point_cost);
+    
+    // Random Tests
+    RUN_TEST(test_fast_random_reproducible);
+    RUN_TEST(test_fast_random_bounds);
+    RUN_TEST(test_random_draw_cost);
     
     UNITY_END();
 }
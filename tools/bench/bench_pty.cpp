@@ -0,0 +1,295 @@
+/**
+ * @file bench_pty.cpp
+ * @brief Protocol round-trip benchmark over a pseudo-terminal
+ * 
+ * A server thread runs EngineSimulator + SpeeduinoProtocol on the master
+ * side of a PTY the way loop() does on the board (update, then
+ * processCommands). A client thread opens the slave side like TunerStudio,
+ * sends one request at a time and waits for the complete response.
+ * 
+ * Scenarios:
+ * - A: Legacy 'A' realtime polls
+ * - r: Framed 'r' reads of the full output channel block (TunerStudio)
+ * - mixed: Framed 'A', full and partial 'r', 'Q' and a 64-byte page read
+ *   (one framed session: the simulator drops legacy bytes within it)
+ * 
+ * Output is one JSON object: per scenario round-trip latency percentiles,
+ * frames per second, CPU per frame (server thread and whole process), and
+ * the server's wall time per frame split between processCommands() and
+ * update(). Build commands: tools/README.md
+ */
+
+#include "EngineSimulator.h"
+#include "SpeeduinoProtocol.h"
+#include "PageStore.h"
+#include "Crc32.h"
+#include "HostPlatform.h"
+#include "PtySerial.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+// ============================================
+// Timing
+// ============================================
+
+static uint64_t nowNs(clockid_t clock = CLOCK_MONOTONIC) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+// ============================================
+// Server (the simulator side of the PTY)
+// ============================================
+
+struct ServerStats {
+    uint64_t cpuNs;             // Server thread CPU time
+    uint64_t processNs;         // Wall time inside processCommands()
+    uint64_t updateNs;          // Wall time inside update()
+    uint32_t updates;           // update() calls that produced a new cycle
+    uint32_t commands;
+};
+
+static void runServer(PtySerial* serial, std::atomic<bool>* running, ServerStats* stats) {
+    HostTimeProvider clock;
+    HostRandomProvider random;
+    random.seed(12345);
+    MemoryStorage storage;
+    PageStore pages(&storage);
+    EngineSimulator simulator(&clock, &random);
+    SpeeduinoProtocol protocol(serial, &simulator, &clock, &pages);
+    
+    pages.begin();
+    simulator.initialize();
+    protocol.begin();
+    memset(stats, 0, sizeof(*stats));
+    
+    uint64_t cpuStart = nowNs(CLOCK_THREAD_CPUTIME_ID);
+    while (running->load(std::memory_order_relaxed)) {
+        // Sleep in the kernel until a request arrives (1 ms keeps the
+        // simulator ticking while idle)
+        serial->waitReadable(1);
+        
+        uint64_t t0 = nowNs();
+        if (simulator.update()) {
+            stats->updates++;
+        }
+        uint64_t t1 = nowNs();
+        stats->commands += protocol.processCommands();
+        uint64_t t2 = nowNs();
+        
+        stats->updateNs += t1 - t0;
+        stats->processNs += t2 - t1;
+    }
+    stats->cpuNs = nowNs(CLOCK_THREAD_CPUTIME_ID) - cpuStart;
+}
+
+// ============================================
+// Client (TunerStudio side)
+// ============================================
+
+struct Request {
+    std::vector<uint8_t> bytes;
+    size_t responseLength;      // 0 = framed, length taken from the header
+};
+
+static Request legacy(const uint8_t* bytes, size_t length, size_t responseLength) {
+    Request request;
+    request.bytes.assign(bytes, bytes + length);
+    request.responseLength = responseLength;
+    return request;
+}
+
+static Request framed(const uint8_t* payload, size_t length) {
+    uint32_t crc = Crc32::compute(payload, length);
+    Request request;
+    request.bytes.push_back(static_cast<uint8_t>(length >> 8));
+    request.bytes.push_back(static_cast<uint8_t>(length));
+    request.bytes.insert(request.bytes.end(), payload, payload + length);
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        request.bytes.push_back(static_cast<uint8_t>(crc >> shift));
+    }
+    request.responseLength = 0;
+    return request;
+}
+
+/**
+ * @brief Read exactly 'length' bytes (false on a 1 s stall)
+ */
+static bool readExact(int fd, uint8_t* buffer, size_t length) {
+    size_t got = 0;
+    while (got < length) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 1000) <= 0) {
+            return false;
+        }
+        ssize_t count = read(fd, buffer + got, length - got);
+        if (count <= 0) {
+            return false;
+        }
+        got += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+/**
+ * @brief Send one request and wait for its complete response
+ * @return false if the response is missing, short or an error
+ */
+static bool roundTrip(int fd, const Request& request) {
+    uint8_t response[1024];
+    if (write(fd, request.bytes.data(), request.bytes.size()) != (ssize_t)request.bytes.size()) {
+        return false;
+    }
+    
+    if (request.responseLength > 0) {
+        return readExact(fd, response, request.responseLength) && response[0] != 0xFF;
+    }
+    
+    // Framed: [size BE16][return code][data][CRC32]
+    if (!readExact(fd, response, 2)) {
+        return false;
+    }
+    size_t size = (static_cast<size_t>(response[0]) << 8) | response[1];
+    if (size == 0 || size + 4 > sizeof(response) || !readExact(fd, response, size + 4)) {
+        return false;
+    }
+    return response[0] == SpeeduinoProtocol::RC_OK;
+}
+
+static std::vector<Request> buildScenario(const char* name) {
+    const uint16_t channels = EngineSnapshot::getChannelsSize(LAYOUT_LEGACY);
+    const uint8_t poll[] = { 'A' };
+    const uint8_t status[] = { 'Q' };
+    const uint8_t readAll[] = { 'r', 0x00, 0x30, 0x00, 0x00,
+                                static_cast<uint8_t>(channels), static_cast<uint8_t>(channels >> 8) };
+    const uint8_t readPart[] = { 'r', 0x00, 0x30, 0x04, 0x00, 0x10, 0x00 };
+    const uint8_t pageRead[] = { 'p', 0x00, 0x01, 0x00, 0x00, 0x40, 0x00 };
+    
+    std::vector<Request> requests;
+    if (strcmp(name, "A") == 0) {
+        requests.push_back(legacy(poll, sizeof(poll), channels));
+    } else if (strcmp(name, "r") == 0) {
+        requests.push_back(framed(readAll, sizeof(readAll)));
+    } else {
+        requests.push_back(framed(poll, sizeof(poll)));
+        requests.push_back(framed(readAll, sizeof(readAll)));
+        requests.push_back(framed(readPart, sizeof(readPart)));
+        requests.push_back(framed(status, sizeof(status)));
+        requests.push_back(framed(pageRead, sizeof(pageRead)));
+    }
+    return requests;
+}
+
+static uint64_t percentile(const std::vector<uint64_t>& sorted, double fraction) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/**
+ * @brief Run one scenario on a fresh PTY and simulator, print its JSON object
+ * @return false if the PTY could not be set up
+ */
+static bool runScenario(const char* name, double seconds, bool first) {
+    PtySerial serial;
+    if (!serial.open()) {
+        fprintf(stderr, "cannot create a pseudo-terminal\n");
+        return false;
+    }
+    int client = open(serial.getDevicePath(), O_RDWR | O_NOCTTY);
+    if (client < 0 || !ptyMakeRaw(client)) {
+        fprintf(stderr, "cannot open %s\n", serial.getDevicePath());
+        return false;
+    }
+    
+    std::atomic<bool> running(true);
+    ServerStats stats;
+    std::thread server(runServer, &serial, &running, &stats);
+    
+    std::vector<Request> requests = buildScenario(name);
+    std::vector<uint64_t> latencies;
+    latencies.reserve(1 << 20);
+    uint32_t errors = 0;
+    
+    // Warm up (first simulator cycles, page load, caches)
+    for (int i = 0; i < 100; i++) {
+        roundTrip(client, requests[i % requests.size()]);
+    }
+    
+    uint64_t processCpuStart = nowNs(CLOCK_PROCESS_CPUTIME_ID);
+    uint64_t start = nowNs();
+    uint64_t end = start + static_cast<uint64_t>(seconds * 1e9);
+    uint64_t now = start;
+    for (size_t i = 0; now < end; i++) {
+        uint64_t sent = now;
+        if (!roundTrip(client, requests[i % requests.size()])) {
+            errors++;
+            tcflush(client, TCIFLUSH);
+        }
+        now = nowNs();
+        latencies.push_back(now - sent);
+    }
+    double elapsed = (now - start) / 1e9;
+    uint64_t processCpuNs = nowNs(CLOCK_PROCESS_CPUTIME_ID) - processCpuStart;
+    
+    running = false;
+    server.join();
+    close(client);
+    
+    // Server figures include the warm-up; divide by everything it served
+    std::sort(latencies.begin(), latencies.end());
+    double frames = static_cast<double>(latencies.size());
+    double served = (stats.commands > 0) ? stats.commands : 1.0;
+    
+    printf("%s    {\"name\": \"%s\", \"frames\": %zu, \"errors\": %u, \"frames_per_second\": %.0f,\n"
+           "     \"latency_us\": {\"p50\": %.1f, \"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f},\n"
+           "     \"cpu_us_per_frame\": {\"server\": %.2f, \"process\": %.2f},\n"
+           "     \"server_us_per_frame\": {\"processCommands\": %.2f, \"update\": %.2f},\n"
+           "     \"simulator_cycles\": %u}",
+           first ? "" : ",\n", name, latencies.size(), errors, frames / elapsed,
+           percentile(latencies, 0.50) / 1e3, percentile(latencies, 0.99) / 1e3,
+           percentile(latencies, 0.999) / 1e3, latencies.empty() ? 0.0 : latencies.back() / 1e3,
+           stats.cpuNs / 1e3 / served, processCpuNs / 1e3 / frames,
+           stats.processNs / 1e3 / served, stats.updateNs / 1e3 / served,
+           stats.updates);
+    return true;
+}
+
+// bench_pty [-seconds N] [-scenario A|r|mixed]...
+int main(int argc, char** argv) {
+    double seconds = 2.0;
+    std::vector<const char*> scenarios;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-scenario") == 0 && i + 1 < argc) {
+            scenarios.push_back(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-seconds N] [-scenario A|r|mixed]...\n", argv[0]);
+            return 2;
+        }
+    }
+    if (scenarios.empty()) {
+        scenarios.push_back("A");
+        scenarios.push_back("r");
+        scenarios.push_back("mixed");
+    }
+    
+    printf("{\"benchmark\": \"pty\", \"seconds\": %.1f, \"channels_bytes\": %u,\n \"scenarios\": [\n",
+           seconds, EngineSnapshot::getChannelsSize(LAYOUT_LEGACY));
+    for (size_t i = 0; i < scenarios.size(); i++) {
+        if (!runScenario(scenarios[i], seconds, i == 0)) {
+            return 1;
+        }
+    }
+    printf("\n]}\n");
+    return 0;
+}
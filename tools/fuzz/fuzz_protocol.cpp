@@ -0,0 +1,143 @@
+/**
+ * @file fuzz_protocol.cpp
+ * @brief libFuzzer target: arbitrary bytes through SpeeduinoProtocol
+ * 
+ * Input layout:
+ * - Byte 0: Delivery control
+ *   - Bits 0-5: Bytes delivered per processCommands() call, minus 1
+ *   - Bit 6: Advance the clock past SERIAL_TIMEOUT_MS between calls
+ *     (request timeouts, baud rate fallback) instead of 1 ms
+ *   - Bit 7: Handle one command per call (legacy budget)
+ * - Bytes 1..: Serial input, raw and framed requests in any mix
+ * 
+ * Every input runs on a fresh simulator, protocol and tune store with a
+ * manual clock, so a crash reproduces from the input alone. Besides the
+ * sanitizers, the target aborts when the parser stops making progress,
+ * exceeds its per-call budget or the simulator state goes out of range.
+ * 
+ * Built with -DFUZZ_STANDALONE instead of libFuzzer, main() replays the
+ * given files (e.g. the seed corpus) and reports commands per second.
+ * Build commands: tools/README.md
+ */
+
+#include "EngineSimulator.h"
+#include "SpeeduinoProtocol.h"
+#include "PageStore.h"
+#include "HostPlatform.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint64_t commandsHandled = 0;
+
+#define FUZZ_CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            abort(); \
+        } \
+    } while (0)
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size < 1) {
+        return 0;
+    }
+    
+    const uint8_t control = data[0];
+    const size_t chunk = (control & 0x3F) + 1;
+    const uint32_t clockStepUs = (control & 0x40) ? (SERIAL_TIMEOUT_MS + 1) * 1000UL : 1000UL;
+    const uint8_t budget = (control & 0x80) ? 1 : PROTOCOL_MAX_COMMANDS_PER_CALL;
+    
+    ManualTimeProvider clock;
+    HostRandomProvider random;
+    random.seed(12345);
+    MemoryStorage storage;
+    PageStore pages(&storage);
+    EngineSimulator simulator(&clock, &random);
+    MemorySerial serial;
+    SpeeduinoProtocol protocol(&serial, &simulator, &clock, &pages);
+    
+    pages.begin();
+    simulator.initialize();
+    protocol.begin();
+    protocol.setProcessingBudget(budget, 0);
+    serial.setInput(data + 1, size - 1);
+    
+    // Deliver the input piecewise; every call with input pending must
+    // consume at least one byte
+    size_t calls = 0;
+    while (serial.getUnread() > 0) {
+        serial.deliver(chunk);
+        size_t before = serial.getUnread();
+        
+        uint8_t handled = protocol.processCommands();
+        FUZZ_CHECK(handled <= budget);
+        FUZZ_CHECK(serial.getUnread() < before);
+        commandsHandled += handled;
+        
+        clock.advanceUs(clockStepUs);
+        simulator.update();
+        FUZZ_CHECK(++calls <= size);
+    }
+    
+    // Let timeouts, stream records and a pending baud switch play out
+    for (uint8_t i = 0; i < 20; i++) {
+        clock.advanceUs((SERIAL_TIMEOUT_MS + 1) * 1000UL);
+        simulator.update();
+        FUZZ_CHECK(protocol.processCommands() == 0);
+    }
+    
+    const EngineStatus& status = simulator.getSnapshot().status;
+    FUZZ_CHECK(status.response == 'A');
+    FUZZ_CHECK(status.getRPM() <= RPM_MAX);
+    FUZZ_CHECK(!protocol.isBaudRatePending());
+    FUZZ_CHECK(protocol.getBaudRate() == serial.getBaudRate());
+    return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+
+#include <chrono>
+#include <vector>
+
+// Replay inputs without libFuzzer: fuzz_protocol [-rounds N] FILE...
+int main(int argc, char** argv) {
+    int rounds = 100;
+    std::vector<std::vector<uint8_t> > inputs;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-rounds") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+            continue;
+        }
+        FILE* file = fopen(argv[i], "rb");
+        if (file == nullptr) {
+            fprintf(stderr, "cannot open %s\n", argv[i]);
+            return 1;
+        }
+        std::vector<uint8_t> input;
+        int byte;
+        while ((byte = fgetc(file)) != EOF) {
+            input.push_back(static_cast<uint8_t>(byte));
+        }
+        fclose(file);
+        inputs.push_back(input);
+    }
+    
+    uint64_t bytes = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < inputs.size(); i++) {
+            LLVMFuzzerTestOneInput(inputs[i].data(), inputs[i].size());
+            bytes += inputs[i].size();
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    printf("{\"inputs\": %zu, \"rounds\": %d, \"bytes\": %llu, \"commands\": %llu, "
+           "\"seconds\": %.3f, \"commands_per_second\": %.0f}\n",
+           inputs.size(), rounds, (unsigned long long)bytes, (unsigned long long)commandsHandled,
+           seconds, seconds > 0 ? commandsHandled / seconds : 0.0);
+    return 0;
+}
+
+#endif // FUZZ_STANDALONE
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Write the seed corpus for fuzz_protocol (tools/fuzz/corpus/).
+
+Each seed is one client session as TunerStudio and the simulator's own
+extensions drive it: connect handshake, polling, page edits and burns,
+loggers, streaming, layout/delta/baud/self-test commands, plus typical
+line noise (bad CRCs, truncated frames). The first byte of every seed is
+the fuzz target's delivery control byte.
+"""
+
+import os
+import struct
+import zlib
+
+SIGNATURE_EXTENDED = b"speeduino 202311".ljust(20, b"\0")
+
+
+def frame(payload):
+    """Wrap a request in the CRC32 frame of the "new" protocol."""
+    return struct.pack(">H", len(payload)) + payload + struct.pack(">I", zlib.crc32(payload))
+
+
+def ranged(offset, length):
+    return b"r\x00\x30" + struct.pack("<HH", offset, length)
+
+
+def page_read(page, offset, length):
+    return b"p\x00" + bytes([page]) + struct.pack("<HH", offset, length)
+
+
+def page_write(page, offset, data):
+    return b"M\x00" + bytes([page]) + struct.pack("<HH", offset, len(data)) + data
+
+
+def self_test(length):
+    return b"l" + struct.pack("<H", length) + bytes((i * 167 + 13) & 0xFF for i in range(length))
+
+
+SEEDS = {
+    # Legacy TunerStudio connect, then polling
+    "ts_connect_legacy": b"\x00" + b"QSnV" + b"A" * 10,
+    # Framed connect and 'r' polling, delivered one byte at a time
+    "ts_connect_framed": b"\x00" + frame(b"Q") + frame(b"S") + frame(b"n")
+                         + frame(ranged(0, 79)) * 5,
+    # Tune edit: read page 1, change a cell range, burn, read back
+    "ts_page_edit_burn": b"\x07" + frame(page_read(1, 0, 256)) + frame(page_write(1, 16, bytes(range(16))))
+                         + frame(b"b\x00\x01") + frame(page_read(1, 16, 16)),
+    # Legacy page write and burn-all
+    "legacy_page_write": b"\x3F" + page_write(0, 0, b"\x01\x02\x03\x04") + b"B" + page_read(0, 0, 4),
+    # Tooth and composite loggers
+    "loggers": b"\x40" + b"H" + b"A" * 4 + b"T" + b"h" + frame(b"J") + frame(b"O") + frame(b"j") + b"XOx",
+    # Push streaming, legacy and framed
+    "stream": b"\x0F" + b"G\x01\x00\x00\x00\x00" + b"A" + b"g" + frame(b"G\x02\x04\x00\x08\x00") + frame(b"g"),
+    # Extended layout, delta frames with acknowledgements, diagnostics
+    "layout_delta": b"\x03" + b"s" + SIGNATURE_EXTENDED + b"Ae\x00\x00e\x01\x00e\x01\x00"
+                    + frame(b"e\x05\x00") + b"DA" + frame(b"DA"),
+    # Baud switch, confirmed by a self-test at the new rate
+    "baud_selftest": b"\x00" + b"u" + struct.pack("<I", 921600) + self_test(32) + frame(self_test(64)),
+    # Baud switch that is never confirmed (slow clock: falls back)
+    "baud_fallback": b"\x40" + frame(b"u" + struct.pack("<I", 57600)),
+    # Line noise: bad CRC, truncated frame, oversized length, stray bytes
+    "noise": b"\x05" + frame(b"A")[:-1] + b"\x00" + frame(b"Q") + b"\x00\x05ABCDE\x00\x00\x00\x00"
+             + b"\x01\xFF" + b"zz\xFF\xFE" + b"r\x00\x30\xFF\xFF\xFF\xFF" + b"S",
+}
+
+
+def main():
+    directory = os.path.join(os.path.dirname(os.path.abspath(__file__)), "corpus")
+    os.makedirs(directory, exist_ok=True)
+    for name, data in sorted(SEEDS.items()):
+        with open(os.path.join(directory, name + ".bin"), "wb") as seed:
+            seed.write(data)
+        print(f"{name}.bin: {len(data)} bytes")
+
+
+if __name__ == "__main__":
+    main()
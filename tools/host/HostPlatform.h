@@ -0,0 +1,268 @@
+/**
+ * @file HostPlatform.h
+ * @brief Native (Linux/macOS) implementations of the hardware interfaces
+ * 
+ * Lets the simulator core (EngineSimulator, SpeeduinoProtocol, PageStore)
+ * run on a PC for fuzzing and benchmarking, without Arduino headers. See
+ * tools/README.md for the build commands.
+ * 
+ * - HostTimeProvider: Monotonic wall clock
+ * - ManualTimeProvider: Clock that only moves when told to (deterministic runs)
+ * - HostRandomProvider: Seedable LCG (same sequence on every host)
+ * - MemoryStorage: RAM-backed tune storage
+ * - MemorySerial: In-memory serial port fed from a byte buffer
+ */
+
+#ifndef HOST_PLATFORM_H
+#define HOST_PLATFORM_H
+
+#include "ISerialInterface.h"
+#include "ITimeProvider.h"
+#include "IRandomProvider.h"
+#include "INonVolatileStorage.h"
+#include "Config.h"
+#include <string.h>
+#include <time.h>
+
+// ============================================
+// Time Providers
+// ============================================
+
+class HostTimeProvider : public ITimeProvider {
+public:
+    uint32_t millis() override {
+        return static_cast<uint32_t>(nowNs() / 1000000ULL);
+    }
+    
+    uint32_t micros() override {
+        return static_cast<uint32_t>(nowNs() / 1000ULL);
+    }
+    
+    void delay(uint32_t ms) override {
+        sleepNs(static_cast<uint64_t>(ms) * 1000000ULL);
+    }
+    
+    void delayMicroseconds(uint32_t us) override {
+        sleepNs(static_cast<uint64_t>(us) * 1000ULL);
+    }
+    
+private:
+    static uint64_t nowNs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+    }
+    
+    static void sleepNs(uint64_t ns) {
+        struct timespec ts;
+        ts.tv_sec = ns / 1000000000ULL;
+        ts.tv_nsec = ns % 1000000000ULL;
+        nanosleep(&ts, nullptr);
+    }
+};
+
+/**
+ * @brief Clock advanced explicitly (delay() advances it instead of sleeping)
+ */
+class ManualTimeProvider : public ITimeProvider {
+private:
+    uint64_t nowUs;
+    
+public:
+    explicit ManualTimeProvider(uint32_t startMs = 1000) : nowUs(startMs * 1000ULL) {}
+    
+    uint32_t millis() override { return static_cast<uint32_t>(nowUs / 1000ULL); }
+    uint32_t micros() override { return static_cast<uint32_t>(nowUs); }
+    void delay(uint32_t ms) override { nowUs += ms * 1000ULL; }
+    void delayMicroseconds(uint32_t us) override { nowUs += us; }
+    
+    void advanceUs(uint32_t us) { nowUs += us; }
+};
+
+// ============================================
+// Random Provider
+// ============================================
+
+/**
+ * @brief Arduino random() semantics on a 32-bit LCG (portable sequence)
+ */
+class HostRandomProvider : public IRandomProvider {
+private:
+    uint32_t state;
+    
+public:
+    HostRandomProvider() : state(1) {}
+    
+    void seed(uint32_t seed) override {
+        state = seed;
+    }
+    
+    int32_t random(int32_t min, int32_t max) override {
+        if (min >= max) {
+            return min;
+        }
+        return min + random(max - min);
+    }
+    
+    int32_t random(int32_t max) override {
+        if (max <= 0) {
+            return 0;
+        }
+        state = state * 1664525UL + 1013904223UL;
+        return static_cast<int32_t>((state >> 1) % static_cast<uint32_t>(max));
+    }
+};
+
+// ============================================
+// Tune Storage
+// ============================================
+
+class MemoryStorage : public INonVolatileStorage {
+private:
+    uint8_t cells[PAGE_STORAGE_SIZE];
+    
+public:
+    MemoryStorage() {
+        memset(cells, 0xFF, sizeof(cells));
+    }
+    
+    bool begin() override {
+        return true;
+    }
+    
+    uint8_t read(uint16_t address) override {
+        return (address < sizeof(cells)) ? cells[address] : 0xFF;
+    }
+    
+    bool write(uint16_t address, const uint8_t* data, uint16_t length) override {
+        if ((uint32_t)address + length > sizeof(cells)) {
+            return false;
+        }
+        memcpy(&cells[address], data, length);
+        return true;
+    }
+};
+
+// ============================================
+// In-Memory Serial Port
+// ============================================
+
+/**
+ * @brief Serial port reading from a caller's buffer, counting what is sent
+ * 
+ * Input becomes available in steps (deliver()), so requests can be split
+ * across processCommands() calls as on a real UART. Output is counted and,
+ * if a capture buffer is set, copied there until it is full.
+ */
+class MemorySerial : public ISerialInterface {
+private:
+    const uint8_t* input;
+    size_t inputSize;
+    size_t inputPos;
+    size_t arrived;     // Bytes delivered so far
+    
+    uint8_t* capture;
+    size_t captureSize;
+    size_t captured;
+    uint64_t written;
+    
+    bool asyncTx;
+    uint32_t baudRate;
+    
+public:
+    MemorySerial()
+        : input(nullptr), inputSize(0), inputPos(0), arrived(0)
+        , capture(nullptr), captureSize(0), captured(0), written(0)
+        , asyncTx(false), baudRate(0) {}
+    
+    /**
+     * @brief Replace the input (nothing delivered yet)
+     */
+    void setInput(const uint8_t* data, size_t size) {
+        input = data;
+        inputSize = size;
+        inputPos = 0;
+        arrived = 0;
+    }
+    
+    /**
+     * @brief Make the next bytes of the input available
+     * @param count Bytes to deliver (clipped to the input)
+     */
+    void deliver(size_t count) {
+        arrived = (inputSize - arrived < count) ? inputSize : arrived + count;
+    }
+    
+    void setCapture(uint8_t* buffer, size_t size) {
+        capture = buffer;
+        captureSize = size;
+        captured = 0;
+    }
+    
+    size_t getCaptured() const { return captured; }
+    uint64_t getWritten() const { return written; }
+    size_t getUnread() const { return inputSize - inputPos; }
+    size_t getUndelivered() const { return inputSize - arrived; }
+    uint32_t getBaudRate() const { return baudRate; }
+    
+    void begin(uint32_t baud) override {
+        baudRate = baud;
+    }
+    
+    bool setBaudRate(uint32_t baud) override {
+        baudRate = baud;
+        inputPos = arrived;     // Bytes in flight are lost while switching
+        return true;
+    }
+    
+    bool isReady() override {
+        return true;
+    }
+    
+    int available() override {
+        return static_cast<int>(arrived - inputPos);
+    }
+    
+    int read() override {
+        return (inputPos < arrived) ? input[inputPos++] : -1;
+    }
+    
+    size_t readBytes(uint8_t* buffer, size_t length) override {
+        size_t count = 0;
+        while (count < length && inputPos < arrived) {
+            buffer[count++] = input[inputPos++];
+        }
+        return count;
+    }
+    
+    size_t write(uint8_t byte) override {
+        return write(&byte, 1);
+    }
+    
+    size_t write(const uint8_t* buffer, size_t length) override {
+        if (capture != nullptr && captured < captureSize) {
+            size_t chunk = (length < captureSize - captured) ? length : captureSize - captured;
+            memcpy(&capture[captured], buffer, chunk);
+            captured += chunk;
+        }
+        written += length;
+        return length;
+    }
+    
+    void flush() override {}
+    
+    void clear() override {
+        inputPos = arrived;
+    }
+    
+    bool setAsyncTransmit(bool enabled) override {
+        asyncTx = enabled;
+        return true;
+    }
+    
+    bool isAsyncTransmit() const override {
+        return asyncTx;
+    }
+};
+
+#endif // HOST_PLATFORM_H
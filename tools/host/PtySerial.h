@@ -0,0 +1,201 @@
+/**
+ * @file PtySerial.h
+ * @brief ISerialInterface on a Linux/macOS pseudo-terminal
+ * 
+ * The simulator owns the master side; a client (benchmark thread,
+ * TunerStudio, a dash) opens getDevicePath() like a real serial port. The
+ * line is switched to raw mode, and baud rates are accepted but have no
+ * effect on throughput.
+ */
+
+#ifndef PTY_SERIAL_H
+#define PTY_SERIAL_H
+
+#include "ISerialInterface.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <termios.h>
+#include <unistd.h>
+
+/**
+ * @brief Put a tty file descriptor into raw 8N1 mode
+ * @return true on success
+ */
+inline bool ptyMakeRaw(int fd) {
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0) {
+        return false;
+    }
+    cfmakeraw(&tio);
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+class PtySerial : public ISerialInterface {
+private:
+    int fd;                         // Master side, non-blocking
+    uint8_t rxBuffer[4096];
+    size_t rxStart;
+    size_t rxEnd;
+    uint32_t baudRate;
+    
+    /**
+     * @brief Move whatever the kernel holds into rxBuffer
+     */
+    void fill() {
+        if (rxStart == rxEnd) {
+            rxStart = rxEnd = 0;
+        }
+        if (fd < 0 || rxEnd == sizeof(rxBuffer)) {
+            return;
+        }
+        ssize_t count = ::read(fd, &rxBuffer[rxEnd], sizeof(rxBuffer) - rxEnd);
+        if (count > 0) {
+            rxEnd += static_cast<size_t>(count);
+        }
+    }
+    
+public:
+    PtySerial() : fd(-1), rxStart(0), rxEnd(0), baudRate(0) {}
+    
+    ~PtySerial() {
+        close();
+    }
+    
+    /**
+     * @brief Create the pseudo-terminal pair
+     * @return true if getDevicePath() can be opened by a client
+     */
+    bool open() {
+        fd = posix_openpt(O_RDWR | O_NOCTTY);
+        if (fd < 0) {
+            return false;
+        }
+        if (grantpt(fd) != 0 || unlockpt(fd) != 0 || !ptyMakeRaw(fd)) {
+            close();
+            return false;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        return true;
+    }
+    
+    void close() {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    
+    /**
+     * @brief Get the client-side device (e.g. /dev/pts/3)
+     */
+    const char* getDevicePath() const {
+        return (fd >= 0) ? ptsname(fd) : nullptr;
+    }
+    
+    /**
+     * @brief Block until input arrives or the timeout expires
+     * @param timeoutMs Longest wait
+     * @return true if input is available
+     */
+    bool waitReadable(int timeoutMs) {
+        if (rxStart != rxEnd) {
+            return true;
+        }
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        return poll(&pfd, 1, timeoutMs) > 0 && (pfd.revents & POLLIN);
+    }
+    
+    uint32_t getBaudRate() const { return baudRate; }
+    
+    void begin(uint32_t baud) override {
+        baudRate = baud;
+    }
+    
+    bool isReady() override {
+        return fd >= 0;
+    }
+    
+    int available() override {
+        fill();
+        return static_cast<int>(rxEnd - rxStart);
+    }
+    
+    int read() override {
+        if (rxStart == rxEnd) {
+            fill();
+        }
+        return (rxStart != rxEnd) ? rxBuffer[rxStart++] : -1;
+    }
+    
+    size_t readBytes(uint8_t* buffer, size_t length) override {
+        size_t count = 0;
+        while (count < length) {
+            int byte = read();
+            if (byte < 0) {
+                break;
+            }
+            buffer[count++] = static_cast<uint8_t>(byte);
+        }
+        return count;
+    }
+    
+    size_t write(uint8_t byte) override {
+        return write(&byte, 1);
+    }
+    
+    size_t write(const uint8_t* buffer, size_t length) override {
+        // Like a UART driver: block (briefly) while the line is full
+        size_t sent = 0;
+        while (sent < length && fd >= 0) {
+            ssize_t count = ::write(fd, buffer + sent, length - sent);
+            if (count > 0) {
+                sent += static_cast<size_t>(count);
+            } else if (count < 0 && errno != EAGAIN && errno != EINTR) {
+                break;
+            } else {
+                struct pollfd pfd = { fd, POLLOUT, 0 };
+                poll(&pfd, 1, 10);
+            }
+        }
+        return sent;
+    }
+    
+    size_t writeSpans(const SerialSpan* spans, uint8_t count) override {
+        // One writev() per pass; a short write is finished piece by piece
+        struct iovec iov[255];
+        for (uint8_t i = 0; i < count; i++) {
+            iov[i].iov_base = const_cast<uint8_t*>(spans[i].data);
+            iov[i].iov_len = spans[i].length;
+        }
+        ssize_t sent = (fd >= 0) ? ::writev(fd, iov, count) : -1;
+        size_t done = (sent > 0) ? static_cast<size_t>(sent) : 0;
+        size_t written = done;
+        for (uint8_t i = 0; i < count; i++) {
+            if (done >= spans[i].length) {
+                done -= spans[i].length;
+                continue;
+            }
+            written += write(spans[i].data + done, spans[i].length - done);
+            done = 0;
+        }
+        return written;
+    }
+    
+    void flush() override {
+        // write() hands everything to the kernel before returning
+    }
+    
+    void clear() override {
+        rxStart = rxEnd = 0;
+        if (fd >= 0) {
+            tcflush(fd, TCIFLUSH);
+        }
+    }
+};
+
+#endif // PTY_SERIAL_H